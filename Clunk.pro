@@ -13,6 +13,10 @@ unix {
   LIBS += -lpthread
 }
 
+linux {
+  LIBS += -lrt
+}
+
 CONFIG(release, debug|release) {
   message(Release build!)
   DEFINES += NDEBUG
@@ -25,6 +29,7 @@ include(epd.pri)
 include(gitrev.pri)
 
 SOURCES += \
+    src/Bitboard.cpp \
     src/Clunk.cpp \
     src/HashTable.cpp \
     src/Stats.cpp \
@@ -38,6 +43,7 @@ SOURCES += \
     src/senjo/UCIAdapter.cpp
 
 HEADERS += \
+    src/Bitboard.h \
     src/Clunk.h \
     src/Move.h \
     src/Stats.h \
@@ -0,0 +1,245 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2015 Shawn Chidester <zd3nik@gmail.com>, All rights reserved
+//-----------------------------------------------------------------------------
+
+#include "Bitboard.h"
+
+#if defined(CLUNK_PEXT) && !defined(_WIN32)
+#include <cpuid.h>
+#endif
+
+namespace clunk
+{
+
+//-----------------------------------------------------------------------------
+// total number of occupancy subsets over all squares
+//-----------------------------------------------------------------------------
+const int BishopTableSize = 5248;
+const int RookTableSize   = 102400;
+
+//-----------------------------------------------------------------------------
+SliderMagic _bishopMagic[128];
+SliderMagic _rookMagic[128];
+bool        _usePext = false;
+
+uint64_t _bishopAttacks[2][BishopTableSize];
+uint64_t _rookAttacks[2][RookTableSize];
+
+//-----------------------------------------------------------------------------
+// pext done the slow way, for building the tables
+//-----------------------------------------------------------------------------
+static uint64_t SoftPext(const uint64_t bits, uint64_t mask) {
+  uint64_t result = 0;
+  for (uint64_t bit = 1; mask; mask &= (mask - 1), bit <<= 1) {
+    if (bits & mask & ~(mask - 1)) {
+      result |= bit;
+    }
+  }
+  return result;
+}
+
+//-----------------------------------------------------------------------------
+// squares attacked from 'sqr' in the given directions, stopping at (and
+// including) the first occupied square in each direction
+//-----------------------------------------------------------------------------
+static uint64_t SlideBits(const int sqr, const int dirs[4],
+                          const uint64_t occupied)
+{
+  uint64_t bits = 0;
+  for (int i = 0; i < 4; ++i) {
+    for (int to = (sqr + dirs[i]); IS_SQUARE(to); to += dirs[i]) {
+      bits |= SquareBit(to);
+      if (occupied & SquareBit(to)) {
+        break;
+      }
+    }
+  }
+  return bits;
+}
+
+//-----------------------------------------------------------------------------
+// squares that can block a slider on 'sqr', edge squares never matter
+//-----------------------------------------------------------------------------
+static uint64_t BlockerMask(const int sqr, const int dirs[4]) {
+  uint64_t mask = 0;
+  for (int i = 0; i < 4; ++i) {
+    for (int to = (sqr + dirs[i]); IS_SQUARE(to + dirs[i]); to += dirs[i]) {
+      mask |= SquareBit(to);
+    }
+  }
+  return mask;
+}
+
+//-----------------------------------------------------------------------------
+// magic multipliers by bit index, found once with a search of sparse random
+// numbers for ones that map every blocker subset without a bad collision
+//-----------------------------------------------------------------------------
+const uint64_t _BISHOP_MAGIC[64] = {
+  0x10102002004A1420ULL, 0x8020040400584008ULL, 0x10510800811201C8ULL,
+  0x5204042080000088ULL, 0x2204106880000002ULL, 0x1401042004000000ULL,
+  0x0400880410042004ULL, 0x0028208200A02020ULL, 0x1500241990010E00ULL,
+  0x8001200182020A40ULL, 0x40004101030B0000ULL, 0x8002041042000100ULL,
+  0x4010011041020038ULL, 0x0000010421044000ULL, 0x1500210808020A00ULL,
+  0x8000088400880520ULL, 0x0405004010040100ULL, 0x1005823210040108ULL,
+  0x2708008102040011ULL, 0x4048200404009100ULL, 0x0018104101400024ULL,
+  0x0003000601190101ULL, 0x8004803108491000ULL, 0x8014241200820800ULL,
+  0x0006E080100C3040ULL, 0x0501044A11041800ULL, 0x9020300008004045ULL,
+  0x0894080000220040ULL, 0x1001010083104000ULL, 0x5004030040900080ULL,
+  0x000400422C012400ULL, 0x0002128698404812ULL, 0x1010108404900440ULL,
+  0x0928021182084100ULL, 0x2006080409020024ULL, 0x1010202020180080ULL,
+  0xA010008200202200ULL, 0x2098015100019004ULL, 0x0002041440810811ULL,
+  0x802A02020000B098ULL, 0x0009015090004060ULL, 0x4000821082081001ULL,
+  0x0100210040420800ULL, 0x0800004010488A00ULL, 0x2000081104004040ULL,
+  0x4C8E029015000082ULL, 0x0420340322224842ULL, 0x1298260043400210ULL,
+  0x0000822802400008ULL, 0x00008A0101600000ULL, 0x3040003412080021ULL,
+  0x3040290220884800ULL, 0x4A1500401041004AULL, 0x8010200282020781ULL,
+  0x0020203142209091ULL, 0x0070300600902110ULL, 0x0040808800B62048ULL,
+  0x0000810400C44420ULL, 0x00080400440C0441ULL, 0x8340080020840411ULL,
+  0x0000000104208200ULL, 0x0000800810D00080ULL, 0x0400530411080200ULL,
+  0x4040702400932244ULL
+};
+
+const uint64_t _ROOK_MAGIC[64] = {
+  0x1080004008801020ULL, 0x0840092002C03000ULL, 0x1900200010400900ULL,
+  0x0880100008000480ULL, 0x4200100420080200ULL, 0x8100020100080400ULL,
+  0x0200040110886200ULL, 0x0200008040220411ULL, 0x0404800084400220ULL,
+  0x0000401000402000ULL, 0x0086001081220440ULL, 0x0408800800100280ULL,
+  0x000A001201040820ULL, 0x8848800200840080ULL, 0x4001000100040200ULL,
+  0x0442000102105084ULL, 0x9080010020804100ULL, 0x0040404000201009ULL,
+  0x0000808010002009ULL, 0x2200090021D00100ULL, 0x0008008008040080ULL,
+  0x0004004002010040ULL, 0x0011040008015042ULL, 0x00000A0001768104ULL,
+  0x0000800080204009ULL, 0x2010004140002001ULL, 0x9800200280100080ULL,
+  0x1000100080080080ULL, 0x0442000A00049020ULL, 0x2100040080020080ULL,
+  0x0800120400900148ULL, 0x0010040A00128541ULL, 0x2800804000800030ULL,
+  0x1010002000400041ULL, 0x4000200011004100ULL, 0x0610008410800800ULL,
+  0x0400802402800800ULL, 0xC100020080800400ULL, 0x0002000802000401ULL,
+  0x0182085882000401ULL, 0x0220204000808000ULL, 0x2860100040024022ULL,
+  0x0001002004110040ULL, 0x99101042000A0020ULL, 0x0004080004008080ULL,
+  0x0010040002008080ULL, 0x2012004881020004ULL, 0x8300842444820011ULL,
+  0x0088403882010200ULL, 0x0820400080210100ULL, 0x0110910040A00300ULL,
+  0x0801100280080480ULL, 0x0242009008200600ULL, 0x1002000489500200ULL,
+  0x0040800200010080ULL, 0x0091800041000080ULL, 0x0000209300488001ULL,
+  0x04C1002414824001ULL, 0x020020000B001041ULL, 0x7000100004200901ULL,
+  0x8002002004100802ULL, 0x30010002084C0007ULL, 0x0888221800813004ULL,
+  0x4000002840840112ULL
+};
+
+//-----------------------------------------------------------------------------
+static void InitSlider(SliderMagic table[128], const uint64_t magic[64],
+                       const int dirs[4], uint64_t* magicAttacks,
+                       uint64_t* pextAttacks, const int size)
+{
+  const uint64_t* end = (magicAttacks + size);
+  const bool hardPext = PextSupported();
+
+  for (int sqr = A1; sqr <= H8; ++sqr) {
+    if (BAD_SQR(sqr)) {
+      sqr += 7;
+      continue;
+    }
+
+    SliderMagic& m = table[sqr];
+    m.mask = BlockerMask(sqr, dirs);
+    m.magic = magic[BitIndex(sqr)];
+    m.shift = (64 - BitCount(m.mask));
+    m.magicAttacks = magicAttacks;
+    m.pextAttacks = pextAttacks;
+
+    // fill both tables with the attacks produced by every subset of the mask
+    uint64_t occ = 0;
+    do {
+      const uint64_t bits = SlideBits(sqr, dirs, occ);
+      magicAttacks[(occ * m.magic) >> m.shift] = bits;
+      pextAttacks[SoftPext(occ, m.mask)] = bits;
+      assert(!hardPext || (Pext(occ, m.mask) == SoftPext(occ, m.mask)));
+      occ = ((occ - m.mask) & m.mask);
+    } while (occ);
+
+#ifndef NDEBUG
+    // subsets that share a magic slot must produce the same attacks
+    do {
+      assert(magicAttacks[(occ * m.magic) >> m.shift] ==
+             SlideBits(sqr, dirs, occ));
+      occ = ((occ - m.mask) & m.mask);
+    } while (occ);
+#endif
+
+    magicAttacks += (1ULL << BitCount(m.mask));
+    pextAttacks += (1ULL << BitCount(m.mask));
+    assert(magicAttacks <= end);
+  }
+  assert(magicAttacks == end);
+  (void)end;
+  (void)hardPext;
+}
+
+//-----------------------------------------------------------------------------
+bool PextSupported() {
+#if !defined(CLUNK_PEXT)
+  return false;
+#elif defined(_WIN32)
+  int info[4];
+  __cpuid(info, 0);
+  if (info[0] < 7) {
+    return false;
+  }
+  __cpuidex(info, 7, 0);
+  return ((info[1] >> 8) & 1) != 0; // EBX bit 8 = BMI2
+#else
+  unsigned int eax, ebx, ecx, edx;
+  if (__get_cpuid_max(0, NULL) < 7) {
+    return false;
+  }
+  __cpuid_count(7, 0, eax, ebx, ecx, edx);
+  return ((ebx >> 8) & 1) != 0; // EBX bit 8 = BMI2
+#endif
+}
+
+//-----------------------------------------------------------------------------
+// AMD processors before Zen 3 (family 0x19) do pext in microcode, it takes
+// dozens of cycles there and the magic multiply is faster
+//-----------------------------------------------------------------------------
+static bool FastPext() {
+#if !defined(CLUNK_PEXT)
+  return false;
+#elif defined(_WIN32)
+  if (!PextSupported()) {
+    return false;
+  }
+  int info[4];
+  __cpuid(info, 0);
+  const bool amd = ((info[1] == 0x68747541) && // "Auth"
+                    (info[3] == 0x69746E65) && // "enti"
+                    (info[2] == 0x444D4163));  // "cAMD"
+  __cpuid(info, 1);
+  const int family = (((info[0] >> 8) & 0xF) + ((info[0] >> 20) & 0xFF));
+  return (!amd || (family >= 0x19));
+#else
+  if (!PextSupported()) {
+    return false;
+  }
+  unsigned int eax, ebx, ecx, edx;
+  __cpuid(0, eax, ebx, ecx, edx);
+  const bool amd = ((ebx == 0x68747541) && // "Auth"
+                    (edx == 0x69746E65) && // "enti"
+                    (ecx == 0x444D4163));  // "cAMD"
+  __cpuid(1, eax, ebx, ecx, edx);
+  const unsigned int family = (((eax >> 8) & 0xF) + ((eax >> 20) & 0xFF));
+  return (!amd || (family >= 0x19));
+#endif
+}
+
+//-----------------------------------------------------------------------------
+void InitSliderAttacks() {
+  const int bishopDirs[4] = { SouthWest, SouthEast, NorthWest, NorthEast };
+  const int rookDirs[4]   = { South, West, East, North };
+
+  InitSlider(_bishopMagic, _BISHOP_MAGIC, bishopDirs,
+             _bishopAttacks[0], _bishopAttacks[1], BishopTableSize);
+  InitSlider(_rookMagic, _ROOK_MAGIC, rookDirs,
+             _rookAttacks[0], _rookAttacks[1], RookTableSize);
+
+  _usePext = FastPext();
+}
+
+} // namespace clunk
@@ -0,0 +1,158 @@
+//-----------------------------------------------------------------------------
+// Copyright (c) 2015 Shawn Chidester <zd3nik@gmail.com>, All rights reserved
+//-----------------------------------------------------------------------------
+
+#ifndef CLUNK_BITBOARD_H
+#define CLUNK_BITBOARD_H
+
+#include "senjo/Platform.h"
+#include "Defs.h"
+
+#ifdef _WIN32
+#include <intrin.h>
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define CLUNK_PEXT
+#endif
+
+namespace clunk
+{
+
+//-----------------------------------------------------------------------------
+// bit 0 is A1, bit 7 is H1, bit 63 is H8
+//-----------------------------------------------------------------------------
+const uint64_t FileA = 0x0101010101010101ULL;
+
+//-----------------------------------------------------------------------------
+// bit index of a 0x88 square and back again
+//-----------------------------------------------------------------------------
+inline int BitIndex(const int sqr) {
+  assert(IS_SQUARE(sqr));
+  return (((sqr >> 1) & 0x38) | (sqr & 7));
+}
+
+//-----------------------------------------------------------------------------
+inline int BitSquare(const int idx) {
+  assert((idx >= 0) & (idx < 64));
+  return (((idx & 0x38) << 1) | (idx & 7));
+}
+
+//-----------------------------------------------------------------------------
+inline uint64_t SquareBit(const int sqr) {
+  return (1ULL << BitIndex(sqr));
+}
+
+//-----------------------------------------------------------------------------
+inline uint64_t FileBits(const int x) {
+  assert((x >= 0) & (x < 8));
+  return (FileA << x);
+}
+
+//-----------------------------------------------------------------------------
+// all squares on the ranks in front of rank 'y' from color's point of view
+//-----------------------------------------------------------------------------
+template<Color color>
+inline uint64_t RanksAhead(const int y) {
+  assert((y >= 0) & (y < 8));
+  return color ? ((1ULL << (8 * y)) - 1) : ((~0ULL << (8 * y)) << 8);
+}
+
+//-----------------------------------------------------------------------------
+inline int BitCount(const uint64_t bits) {
+#ifdef _WIN32
+  return static_cast<int>(__popcnt64(bits));
+#else
+  return __builtin_popcountll(bits);
+#endif
+}
+
+//-----------------------------------------------------------------------------
+inline int LowBitIndex(const uint64_t bits) {
+  assert(bits);
+#ifdef _WIN32
+  unsigned long idx;
+  _BitScanForward64(&idx, bits);
+  return static_cast<int>(idx);
+#else
+  return __builtin_ctzll(bits);
+#endif
+}
+
+//-----------------------------------------------------------------------------
+// remove the lowest bit from 'bits' and return its 0x88 square
+//-----------------------------------------------------------------------------
+inline int PopSquare(uint64_t& bits) {
+  const int idx = LowBitIndex(bits);
+  bits &= (bits - 1);
+  return BitSquare(idx);
+}
+
+//-----------------------------------------------------------------------------
+// slider attacks are looked up by the occupied squares that matter to them,
+// either with a magic multiply or with the BMI2 pext instruction, whichever
+// this processor does best.  both tables hold the same attack sets.
+// the choice is made once by InitSliderAttacks() and never changes after
+// that, so every engine instance and search thread can read it freely.
+//-----------------------------------------------------------------------------
+struct SliderMagic
+{
+  uint64_t  mask;         // occupied squares that can block this slider
+  uint64_t  magic;
+  int       shift;
+  uint64_t* magicAttacks; // indexed by ((occupied & mask) * magic) >> shift
+  uint64_t* pextAttacks;  // indexed by pext(occupied, mask)
+};
+
+//-----------------------------------------------------------------------------
+extern SliderMagic _bishopMagic[128];
+extern SliderMagic _rookMagic[128];
+extern bool        _usePext;
+
+//-----------------------------------------------------------------------------
+void InitSliderAttacks();
+bool PextSupported();
+
+//-----------------------------------------------------------------------------
+inline uint64_t Pext(const uint64_t bits, const uint64_t mask) {
+#if !defined(CLUNK_PEXT)
+  (void)bits;
+  (void)mask;
+  assert(false);
+  return 0;
+#elif defined(_WIN32)
+  return _pext_u64(bits, mask);
+#else
+  uint64_t result;
+  __asm__("pextq %2, %1, %0" : "=r" (result) : "r" (bits), "r" (mask));
+  return result;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+inline uint64_t SliderAttacks(const SliderMagic& m, const uint64_t occupied) {
+  return _usePext
+      ? m.pextAttacks[Pext(occupied, m.mask)]
+      : m.magicAttacks[((occupied & m.mask) * m.magic) >> m.shift];
+}
+
+//-----------------------------------------------------------------------------
+inline uint64_t BishopAttacks(const int sqr, const uint64_t occupied) {
+  assert(IS_SQUARE(sqr));
+  return SliderAttacks(_bishopMagic[sqr], occupied);
+}
+
+//-----------------------------------------------------------------------------
+inline uint64_t RookAttacks(const int sqr, const uint64_t occupied) {
+  assert(IS_SQUARE(sqr));
+  return SliderAttacks(_rookMagic[sqr], occupied);
+}
+
+//-----------------------------------------------------------------------------
+inline uint64_t QueenAttacks(const int sqr, const uint64_t occupied) {
+  return (BishopAttacks(sqr, occupied) | RookAttacks(sqr, occupied));
+}
+
+} // namespace clunk
+
+#endif // CLUNK_BITBOARD_H
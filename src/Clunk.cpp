@@ -3,6 +3,7 @@
 //-----------------------------------------------------------------------------
 
 #include "Clunk.h"
+#include "Bitboard.h"
 #include "HashTable.h"
 #include "Stats.h"
 #include "senjo/Output.h"
@@ -115,63 +116,57 @@ const uint64_t _CROSS_DIRS = 0x00FF00FFFF00FF00ULL;
 char     _dir[128][128] = {0};
 char     _dist[128][128] = {0};
 char     _knightDir[128][128] = {0};
-char     _kingDir[128] = {0};
-Piece*   _board[128] = {0};
-Piece    _piece[PieceListSize];
-int      _seenIndex = 0;
-int      _pcount[12] = {0};
-int      _material[2] = {0};
-uint64_t _atk[128] = {0};
-uint64_t _seen[MaxPlies] = {0};
 uint64_t _pawnCaps[128] = {0};
 uint64_t _knightMoves[128] = {0};
 uint64_t _bishopRook[128] = {0};
 uint64_t _queenKing[128] = {0};
-uint8_t  _seenFilter[SeenFilterMask + 1] = {0};
+uint64_t _pawnBits[128] = {0};
+uint64_t _knightBits[128] = {0};
+uint64_t _kingBits[128] = {0};
 
-#ifndef NDEBUG
-uint64_t _seenStack[8000] = {0};
-uint64_t* _seenStackTop = _seenStack;
-#endif
+//-----------------------------------------------------------------------------
+// extra _stop flag used to halt helper threads when the main thread is done
+//-----------------------------------------------------------------------------
+const int HelperStop = 0x100;
+
+//-----------------------------------------------------------------------------
+// nodes need at least this much remaining depth to be split between threads
+//-----------------------------------------------------------------------------
+const int MinSplitDepth = 4;
+
+//-----------------------------------------------------------------------------
+// with more than one thread the node limit is checked against the total of
+// all threads, but only when a thread's own count is a multiple of this + 1
+//-----------------------------------------------------------------------------
+const uint64_t NodeLimitMask = 0xFFF;
 
 //-----------------------------------------------------------------------------
-Piece* _EMPTY              = _piece; // _piece[0]
-const Piece* _KING[2]      = { (_piece + WhiteKingOffset),
-                               (_piece + BlackKingOffset) };
-const Piece* _FIRST_SLIDER = (_piece + BishopOffset);
-const Piece* _FIRST_ROOK   = (_piece + RookOffset);
+// longer move lists are put in order this many moves at a time, the next
+// batch is only sorted if the search gets that far
+//-----------------------------------------------------------------------------
+const int SortedMoves = 16;
 
 //-----------------------------------------------------------------------------
-int         _stop = 0;
-int         _depth = 0;
-int         _seldepth = 0;
-int         _movenum = 0;
-int         _drawScore[2] = {0};
-uint64_t    _startTime = 0;
-bool        _debug = false;
-char        _hist[TwelveBits + 1] = {0};
-std::string _currmove;
-Stats       _stats;
-Stats       _totalStats;
+// milliseconds reserved on every move for communication lag
+//-----------------------------------------------------------------------------
+const int DefaultMoveOverhead = 30;
+const int MaxMoveOverhead = 5000;
 
 //-----------------------------------------------------------------------------
-TranspositionTable<PawnEntry> _pawnTT;
-TranspositionTable<HashEntry> _tt;
+// hash table sizes in megabytes, the pawn hash size is per search thread
+//-----------------------------------------------------------------------------
+const int DefaultHashSize = 512;
+const int MaxHashSize = 131072;
+const int DefaultPawnHashSize = 2;
+const int MaxPawnHashSize = 1024;
 
 //-----------------------------------------------------------------------------
-void InitSearch(const Color colorToMove, const uint64_t startTime) {
-  _startTime = startTime;
-  _stop     &= senjo::ChessEngine::FullStop;
-  _depth     = 0;
-  _seldepth  = 0;
-  _movenum   = 0;
-
-  _currmove.clear();
-  _stats.Clear();
-  _tt.ResetCounters();
-
-  _drawScore[colorToMove] = 0; // TODO -_contempt;
-  _drawScore[!colorToMove] = 0; // TODO _contempt;
+// used by threads waiting on other threads, spin a while before sleeping
+//-----------------------------------------------------------------------------
+inline void Backoff(int& spins) {
+  if (++spins > 1000) {
+    senjo::MillisecondSleep(1);
+  }
 }
 
 //-----------------------------------------------------------------------------
@@ -278,170 +273,10 @@ inline int ValueOf(const int pc) {
 }
 
 //-----------------------------------------------------------------------------
-inline void AddPiece(const int type, const int sqr) {
-  assert(IS_SQUARE(sqr));
-  Piece* pc;
-  switch (type) {
-  case (White|Pawn):
-    assert(_pcount[White|Pawn] < 8);
-    pc = (_piece + PawnOffset + _pcount[White|Pawn]++);
-    assert(pc < (_piece + BlackPawnOffset));
-    break;
-  case (Black|Pawn):
-    assert(_pcount[Black|Pawn] < 8);
-    pc = (_piece + BlackPawnOffset + _pcount[Black|Pawn]++);
-    assert(pc < (_piece + KnightOffset));
-    break;
-  case (White|Knight):
-    assert(_pcount[White|Knight] < 10);
-    pc = (_piece + KnightOffset + _pcount[White|Knight]++);
-    assert(pc < (_piece + BlackKnightOffset));
-    break;
-  case (Black|Knight):
-    assert(_pcount[Black|Knight] < 10);
-    pc = (_piece + BlackKnightOffset + _pcount[Black|Knight]++);
-    assert(pc < (_piece + BishopOffset));
-    break;
-  case (White|Bishop):
-    assert(_pcount[White|Bishop] < 10);
-    assert(_pcount[White] < 13);
-    pc = (_piece + BishopOffset + _pcount[White|Bishop]++);
-    assert(pc < (_piece + BlackBishopOffset));
-    _pcount[White]++;
-    break;
-  case (Black|Bishop):
-    assert(_pcount[Black|Bishop] < 10);
-    assert(_pcount[Black] < 13);
-    pc = (_piece + BlackBishopOffset + _pcount[Black|Bishop]++);
-    assert(pc < (_piece + RookOffset));
-    _pcount[Black]++;
-    break;
-  case (White|Rook):
-    assert(_pcount[White|Rook] < 10);
-    assert(_pcount[White] < 13);
-    pc = (_piece + RookOffset + _pcount[White|Rook]++);
-    assert(pc < (_piece + BlackRookOffset));
-    _pcount[White]++;
-    break;
-  case (Black|Rook):
-    assert(_pcount[Black|Rook] < 10);
-    assert(_pcount[Black] < 13);
-    pc = (_piece + BlackRookOffset + _pcount[Black|Rook]++);
-    assert(pc < (_piece + QueenOffset));
-    _pcount[Black]++;
-    break;
-  case (White|Queen):
-    assert(_pcount[White|Queen] < 9);
-    assert(_pcount[White] < 13);
-    pc = (_piece + QueenOffset + _pcount[White|Queen]++);
-    assert(pc < (_piece + BlackQueenOffset));
-    _pcount[White]++;
-    break;
-  case (Black|Queen):
-    assert(_pcount[Black|Queen] < 9);
-    assert(_pcount[Black] < 13);
-    pc = (_piece + BlackQueenOffset + _pcount[Black|Queen]++);
-    assert(pc < (_piece + PieceListSize));
-    _pcount[Black]++;
-    break;
-  case (White|King):
-    pc = const_cast<Piece*>(_KING[White]);
-    assert(!pc->type & !pc->sqr); // only allow this once
-    break;
-  case (Black|King):
-    pc = const_cast<Piece*>(_KING[Black]);
-    assert(!pc->type & !pc->sqr); // only allow this once
-    break;
-  default:
-    assert(false);
-    pc = NULL;
-  }
-  assert(pc && (pc != _EMPTY));
-  pc->type = type;
-  pc->sqr = sqr;
-  _board[sqr] = pc;
-}
-
+// piece values for static exchange evaluation, the king can't be traded
 //-----------------------------------------------------------------------------
-inline void RemovePiece(const int type, const int sqr) {
-  assert((type >= Pawn) & (type < King));
-  assert(IS_SQUARE(sqr));
-  Piece* pc = _board[sqr];
-  assert(pc && (pc != _EMPTY));
-  assert(pc->type == type);
-  assert(pc->sqr == sqr);
-  switch (type) {
-  case (White|Pawn):
-    assert((_pcount[type] > 0) & (_pcount[type] <= 8));
-    assert(pc >= (_piece + PawnOffset));
-    assert(pc < (_piece + PawnOffset + _pcount[type]));
-    *pc = _piece[PawnOffset + --_pcount[White|Pawn]];
-    break;
-  case (Black|Pawn):
-    assert((_pcount[type] > 0) & (_pcount[type] <= 8));
-    assert(pc >= (_piece + BlackPawnOffset));
-    assert(pc < (_piece + BlackPawnOffset + _pcount[type]));
-    *pc = _piece[BlackPawnOffset + --_pcount[Black|Pawn]];
-    break;
-  case (White|Knight):
-    assert((_pcount[type] > 0) & (_pcount[type] <= 10));
-    assert(pc >= (_piece + KnightOffset));
-    assert(pc < (_piece + KnightOffset + _pcount[type]));
-    *pc = _piece[KnightOffset + --_pcount[White|Knight]];
-    break;
-  case (Black|Knight):
-    assert((_pcount[type] > 0) & (_pcount[type] <= 10));
-    assert(pc >= (_piece + BlackKnightOffset));
-    assert(pc < (_piece + BlackKnightOffset + _pcount[type]));
-    *pc = _piece[BlackKnightOffset + --_pcount[Black|Knight]];
-    break;
-  case (White|Bishop):
-    assert((_pcount[type] > 0) & (_pcount[type] <= 10));
-    assert(pc >= (_piece + BishopOffset));
-    assert(pc < (_piece + BishopOffset + _pcount[type]));
-    *pc = _piece[BishopOffset + --_pcount[White|Bishop]];
-    --_pcount[White];
-    break;
-  case (Black|Bishop):
-    assert((_pcount[type] > 0) & (_pcount[type] <= 10));
-    assert(pc >= (_piece + BlackBishopOffset));
-    assert(pc < (_piece + BlackBishopOffset + _pcount[type]));
-    *pc = _piece[BlackBishopOffset + --_pcount[Black|Bishop]];
-    --_pcount[Black];
-    break;
-  case (White|Rook):
-    assert((_pcount[type] > 0) & (_pcount[type] <= 10));
-    assert(pc >= (_piece + RookOffset));
-    assert(pc < (_piece + RookOffset + _pcount[type]));
-    *pc = _piece[RookOffset + --_pcount[White|Rook]];
-    --_pcount[White];
-    break;
-  case (Black|Rook):
-    assert((_pcount[type] > 0) & (_pcount[type] <= 10));
-    assert(pc >= (_piece + BlackRookOffset));
-    assert(pc < (_piece + BlackRookOffset + _pcount[type]));
-    *pc = _piece[BlackRookOffset + --_pcount[Black|Rook]];
-    --_pcount[Black];
-    break;
-  case (White|Queen):
-    assert((_pcount[type] > 0) & (_pcount[type] <= 9));
-    assert(pc >= (_piece + QueenOffset));
-    assert(pc < (_piece + QueenOffset + _pcount[type]));
-    *pc = _piece[QueenOffset + --_pcount[White|Queen]];
-    --_pcount[White];
-    break;
-  case (Black|Queen):
-    assert((_pcount[type] > 0) & (_pcount[type] <= 9));
-    assert(pc >= (_piece + BlackQueenOffset));
-    assert(pc < (_piece + BlackQueenOffset + _pcount[type]));
-    *pc = _piece[BlackQueenOffset + --_pcount[Black|Queen]];
-    --_pcount[Black];
-    break;
-  default:
-    assert(false);
-  }
-  _board[pc->sqr] = pc;
-  _board[sqr] = _EMPTY;
+inline int SeeValue(const int pc) {
+  return ((pc & ~1) == King) ? Infinity : ValueOf(pc);
 }
 
 //-----------------------------------------------------------------------------
@@ -472,21 +307,25 @@ template<Color color>
 void InitPawnMoves(const int from) {
   assert(IS_SQUARE(from));
   uint64_t mvs = 0ULL;
+  uint64_t bits = 0ULL;
   int shift = 0;
   int to = (from + (color ? SouthWest : NorthWest));
   if (IS_SQUARE(to)) {
     assert(shift <= 56);
     mvs |= (uint64_t(to + 1) << shift);
+    bits |= SquareBit(to);
     shift += 8;
   }
   to = (from + (color ? SouthEast : NorthEast));
   if (IS_SQUARE(to)) {
     assert(shift <= 56);
     mvs |= (uint64_t(to + 1) << shift);
+    bits |= SquareBit(to);
     shift += 8;
   }
   assert(VerifyMoveMap(from, mvs));
   _pawnCaps[from + (color * 8)] = mvs;
+  _pawnBits[from + (color * 8)] = bits;
 }
 
 //-----------------------------------------------------------------------------
@@ -497,17 +336,20 @@ void InitKnightMoves(const int from) {
     KnightMove5, KnightMove6, KnightMove7, KnightMove8
   };
   uint64_t mvs = 0ULL;
+  uint64_t bits = 0ULL;
   int shift = 0;
   for (int i = 0; i < 8; ++i) {
     const int to = (from + DIRECTION[i]);
     if (IS_SQUARE(to)) {
       assert(shift <= 56);
       mvs |= (uint64_t(to + 1) << shift);
+      bits |= SquareBit(to);
       shift += 8;
     }
   }
   assert(VerifyMoveMap(from, mvs));
   _knightMoves[from] = mvs;
+  _knightBits[from] = bits;
 }
 
 //-----------------------------------------------------------------------------
@@ -591,6 +433,7 @@ void InitKingMoves(const int from) {
     East, NorthWest, North, NorthEast
   };
   uint64_t mvs = 0ULL;
+  uint64_t bits = 0ULL;
   int shift = 0;
   for (int i = 0; i < 8; ++i) {
     const int to = (from + dir[i]);
@@ -598,11 +441,13 @@ void InitKingMoves(const int from) {
       assert(Direction(from, to) == dir[i]);
       assert(shift <= 56);
       mvs |= (uint64_t(to + 1) << shift);
+      bits |= SquareBit(to);
       shift += 8;
     }
   }
   assert(VerifyMoveMap(from, mvs));
   _queenKing[from + 8] = mvs;
+  _kingBits[from] = bits;
 }
 
 //-----------------------------------------------------------------------------
@@ -611,6 +456,9 @@ void InitMoveMaps() {
   memset(_knightMoves, 0, sizeof(_knightMoves));
   memset(_bishopRook, 0, sizeof(_bishopRook));
   memset(_queenKing, 0, sizeof(_queenKing));
+  memset(_pawnBits, 0, sizeof(_pawnBits));
+  memset(_knightBits, 0, sizeof(_knightBits));
+  memset(_kingBits, 0, sizeof(_kingBits));
   for (int sqr = A1; sqr <= H8; ++sqr) {
     if (BAD_SQR(sqr)) {
       sqr += 7;
@@ -636,522 +484,922 @@ inline int DirShift(const int dir) {
 }
 
 //-----------------------------------------------------------------------------
-template<Color color>
-void ClearKingDirs(const int from) {
-  assert(IS_SQUARE(from));
-  for (uint64_t mvs = _queenKing[from]; mvs; mvs >>= 8) {
-    assert(mvs & 0xFF);
-    const int end = ((mvs & 0xFF) - 1);
-    const int dir = Direction(from, end);
-    assert(IS_DIR(dir));
-    for (int to = (from + dir);; to += dir) {
-      assert(IS_SQUARE(to));
-      assert(Direction(from, to) == dir);
-      if (_kingDir[to + (color * 8)]) {
-        _kingDir[to + (color * 8)] = 0;
-      }
-      else {
-        break;
-      }
-      if (to == end) {
-        break;
-      }
-    }
-  }
+const char* NextWord(const char* p) {
+  while (p && *p && isspace(*p)) ++p;
+  return p;
 }
 
 //-----------------------------------------------------------------------------
-template<Color color>
-void SetKingDirs(const int from) {
-  assert(IS_SQUARE(from));
-  for (uint64_t mvs = _queenKing[from]; mvs; mvs >>= 8) {
-    assert(mvs & 0xFF);
-    const int end = ((mvs & 0xFF) - 1);
-    const int dir = Direction(from, end);
-    assert(IS_DIR(dir));
-    for (int to = (from + dir);; to += dir) {
-      assert(IS_SQUARE(to));
-      assert(Direction(from, to) == dir);
-      assert(!_kingDir[to + (color * 8)]);
-      _kingDir[to + (color * 8)] = -dir;
-      if ((to == end) || (_board[to] != _EMPTY)) {
-        break;
-      }
-    }
-  }
+const char* NextSpace(const char* p) {
+  while (p && *p && !isspace(*p)) ++p;
+  return p;
 }
 
 //-----------------------------------------------------------------------------
-template<Color color>
-void UpdateKingDirs(const int from, const int to) {
-  assert(IS_SQUARE(from));
-  assert(IS_SQUARE(to));
-  assert(from != to);
-  assert(_board[to] != _EMPTY);
-  int dir = _kingDir[from + (color * 8)];
-  if (dir && (_board[from] == _EMPTY)) {
-    assert(IS_DIR(dir));
-    assert(Direction(from, _KING[color]->sqr) == dir);
-    if (Direction(from, to) != dir) {
-      for (int sqr = (from - dir); IS_SQUARE(sqr); sqr -= dir) {
-        assert(Direction(from, sqr) == -dir);
-        _kingDir[sqr + (color * 8)] = dir;
-        if (sqr == to) {
-          return;
+struct SplitPoint;
+
+//-----------------------------------------------------------------------------
+struct Position
+{
+  //---------------------------------------------------------------------------
+  // board state, every search thread has its own copy
+  //---------------------------------------------------------------------------
+  Piece*   board[128];
+  Piece    piece[PieceListSize];
+  char     kingDir[128];
+  int      seenIndex;
+  int      pcount[12];
+  int      material[2];
+  uint64_t atk[128];
+  uint64_t bits[14]; // squares of each piece type, bits[color] = all of color
+  uint64_t seen[MaxPlies];
+  uint8_t  seenFilter[SeenFilterMask + 1];
+
+#ifndef NDEBUG
+  uint64_t  seenStack[8000];
+  uint64_t* seenStackTop;
+#endif
+
+  //---------------------------------------------------------------------------
+  // pointers into piece[], these never change
+  //---------------------------------------------------------------------------
+  Piece*       empty; // piece[0]
+  const Piece* king[2];
+  const Piece* firstSlider;
+  const Piece* firstRook;
+
+  //---------------------------------------------------------------------------
+  // search data that is private to each search thread
+  //---------------------------------------------------------------------------
+  int         seldepth;
+  char        hist[TwelveBits + 1];
+  Stats       stats;
+  SplitPoint* split; // innermost split point this thread is working under
+  TranspositionTable<PawnEntry> pawnTT;
+
+  //---------------------------------------------------------------------------
+  Position()
+    : empty(piece),
+      firstSlider(piece + BishopOffset),
+      firstRook(piece + RookOffset),
+      seldepth(0),
+      split(NULL)
+  {
+    king[White] = (piece + WhiteKingOffset);
+    king[Black] = (piece + BlackKingOffset);
+    memset(hist, 0, sizeof(hist));
+#ifndef NDEBUG
+    seenStackTop = seenStack;
+#endif
+    Clear();
+  }
+
+  //---------------------------------------------------------------------------
+  void Clear() {
+    seenIndex = 0;
+    memset(kingDir, 0, sizeof(kingDir));
+    memset(board, 0, sizeof(board));
+    memset(piece, 0, sizeof(piece));
+    memset(pcount, 0, sizeof(pcount));
+    memset(material, 0, sizeof(material));
+    memset(atk, 0, sizeof(atk));
+    memset(bits, 0, sizeof(bits));
+    memset(seen, 0, sizeof(seen));
+    memset(seenFilter, 0, sizeof(seenFilter));
+    board[None] = empty;
+  }
+
+  //---------------------------------------------------------------------------
+  void CopyBoard(const Position& other) {
+    memcpy(piece, other.piece, sizeof(piece));
+    for (int sqr = 0; sqr < 128; ++sqr) {
+      board[sqr] = other.board[sqr]
+          ? (piece + (other.board[sqr] - other.piece))
+          : NULL;
+    }
+    memcpy(kingDir, other.kingDir, sizeof(kingDir));
+    memcpy(pcount, other.pcount, sizeof(pcount));
+    memcpy(material, other.material, sizeof(material));
+    memcpy(atk, other.atk, sizeof(atk));
+    memcpy(bits, other.bits, sizeof(bits));
+    memcpy(seen, other.seen, sizeof(seen));
+    memcpy(seenFilter, other.seenFilter, sizeof(seenFilter));
+    seenIndex = other.seenIndex;
+#ifndef NDEBUG
+    const size_t count = (other.seenStackTop - other.seenStack);
+    memcpy(seenStack, other.seenStack, (count * sizeof(uint64_t)));
+    seenStackTop = (seenStack + count);
+#endif
+  }
+
+  //---------------------------------------------------------------------------
+  inline void AddPiece(const int type, const int sqr) {
+    assert(IS_SQUARE(sqr));
+    Piece* pc;
+    switch (type) {
+    case (White|Pawn):
+      assert(pcount[White|Pawn] < 8);
+      pc = (piece + PawnOffset + pcount[White|Pawn]++);
+      assert(pc < (piece + BlackPawnOffset));
+      break;
+    case (Black|Pawn):
+      assert(pcount[Black|Pawn] < 8);
+      pc = (piece + BlackPawnOffset + pcount[Black|Pawn]++);
+      assert(pc < (piece + KnightOffset));
+      break;
+    case (White|Knight):
+      assert(pcount[White|Knight] < 10);
+      pc = (piece + KnightOffset + pcount[White|Knight]++);
+      assert(pc < (piece + BlackKnightOffset));
+      break;
+    case (Black|Knight):
+      assert(pcount[Black|Knight] < 10);
+      pc = (piece + BlackKnightOffset + pcount[Black|Knight]++);
+      assert(pc < (piece + BishopOffset));
+      break;
+    case (White|Bishop):
+      assert(pcount[White|Bishop] < 10);
+      assert(pcount[White] < 13);
+      pc = (piece + BishopOffset + pcount[White|Bishop]++);
+      assert(pc < (piece + BlackBishopOffset));
+      pcount[White]++;
+      break;
+    case (Black|Bishop):
+      assert(pcount[Black|Bishop] < 10);
+      assert(pcount[Black] < 13);
+      pc = (piece + BlackBishopOffset + pcount[Black|Bishop]++);
+      assert(pc < (piece + RookOffset));
+      pcount[Black]++;
+      break;
+    case (White|Rook):
+      assert(pcount[White|Rook] < 10);
+      assert(pcount[White] < 13);
+      pc = (piece + RookOffset + pcount[White|Rook]++);
+      assert(pc < (piece + BlackRookOffset));
+      pcount[White]++;
+      break;
+    case (Black|Rook):
+      assert(pcount[Black|Rook] < 10);
+      assert(pcount[Black] < 13);
+      pc = (piece + BlackRookOffset + pcount[Black|Rook]++);
+      assert(pc < (piece + QueenOffset));
+      pcount[Black]++;
+      break;
+    case (White|Queen):
+      assert(pcount[White|Queen] < 9);
+      assert(pcount[White] < 13);
+      pc = (piece + QueenOffset + pcount[White|Queen]++);
+      assert(pc < (piece + BlackQueenOffset));
+      pcount[White]++;
+      break;
+    case (Black|Queen):
+      assert(pcount[Black|Queen] < 9);
+      assert(pcount[Black] < 13);
+      pc = (piece + BlackQueenOffset + pcount[Black|Queen]++);
+      assert(pc < (piece + PieceListSize));
+      pcount[Black]++;
+      break;
+    case (White|King):
+      pc = const_cast<Piece*>(king[White]);
+      assert(!pc->type & !pc->sqr); // only allow this once
+      break;
+    case (Black|King):
+      pc = const_cast<Piece*>(king[Black]);
+      assert(!pc->type & !pc->sqr); // only allow this once
+      break;
+    default:
+      assert(false);
+      pc = NULL;
+    }
+    assert(pc && (pc != empty));
+    assert(!(bits[type] & SquareBit(sqr)));
+    assert(!(bits[COLOR(type)] & SquareBit(sqr)));
+    pc->type = type;
+    pc->sqr = sqr;
+    board[sqr] = pc;
+    bits[type] |= SquareBit(sqr);
+    bits[COLOR(type)] |= SquareBit(sqr);
+  }
+
+  //---------------------------------------------------------------------------
+  inline void RemovePiece(const int type, const int sqr) {
+    assert((type >= Pawn) & (type < King));
+    assert(IS_SQUARE(sqr));
+    Piece* pc = board[sqr];
+    assert(pc && (pc != empty));
+    assert(pc->type == type);
+    assert(pc->sqr == sqr);
+    switch (type) {
+    case (White|Pawn):
+      assert((pcount[type] > 0) & (pcount[type] <= 8));
+      assert(pc >= (piece + PawnOffset));
+      assert(pc < (piece + PawnOffset + pcount[type]));
+      *pc = piece[PawnOffset + --pcount[White|Pawn]];
+      break;
+    case (Black|Pawn):
+      assert((pcount[type] > 0) & (pcount[type] <= 8));
+      assert(pc >= (piece + BlackPawnOffset));
+      assert(pc < (piece + BlackPawnOffset + pcount[type]));
+      *pc = piece[BlackPawnOffset + --pcount[Black|Pawn]];
+      break;
+    case (White|Knight):
+      assert((pcount[type] > 0) & (pcount[type] <= 10));
+      assert(pc >= (piece + KnightOffset));
+      assert(pc < (piece + KnightOffset + pcount[type]));
+      *pc = piece[KnightOffset + --pcount[White|Knight]];
+      break;
+    case (Black|Knight):
+      assert((pcount[type] > 0) & (pcount[type] <= 10));
+      assert(pc >= (piece + BlackKnightOffset));
+      assert(pc < (piece + BlackKnightOffset + pcount[type]));
+      *pc = piece[BlackKnightOffset + --pcount[Black|Knight]];
+      break;
+    case (White|Bishop):
+      assert((pcount[type] > 0) & (pcount[type] <= 10));
+      assert(pc >= (piece + BishopOffset));
+      assert(pc < (piece + BishopOffset + pcount[type]));
+      *pc = piece[BishopOffset + --pcount[White|Bishop]];
+      --pcount[White];
+      break;
+    case (Black|Bishop):
+      assert((pcount[type] > 0) & (pcount[type] <= 10));
+      assert(pc >= (piece + BlackBishopOffset));
+      assert(pc < (piece + BlackBishopOffset + pcount[type]));
+      *pc = piece[BlackBishopOffset + --pcount[Black|Bishop]];
+      --pcount[Black];
+      break;
+    case (White|Rook):
+      assert((pcount[type] > 0) & (pcount[type] <= 10));
+      assert(pc >= (piece + RookOffset));
+      assert(pc < (piece + RookOffset + pcount[type]));
+      *pc = piece[RookOffset + --pcount[White|Rook]];
+      --pcount[White];
+      break;
+    case (Black|Rook):
+      assert((pcount[type] > 0) & (pcount[type] <= 10));
+      assert(pc >= (piece + BlackRookOffset));
+      assert(pc < (piece + BlackRookOffset + pcount[type]));
+      *pc = piece[BlackRookOffset + --pcount[Black|Rook]];
+      --pcount[Black];
+      break;
+    case (White|Queen):
+      assert((pcount[type] > 0) & (pcount[type] <= 9));
+      assert(pc >= (piece + QueenOffset));
+      assert(pc < (piece + QueenOffset + pcount[type]));
+      *pc = piece[QueenOffset + --pcount[White|Queen]];
+      --pcount[White];
+      break;
+    case (Black|Queen):
+      assert((pcount[type] > 0) & (pcount[type] <= 9));
+      assert(pc >= (piece + BlackQueenOffset));
+      assert(pc < (piece + BlackQueenOffset + pcount[type]));
+      *pc = piece[BlackQueenOffset + --pcount[Black|Queen]];
+      --pcount[Black];
+      break;
+    default:
+      assert(false);
+    }
+    board[pc->sqr] = pc;
+    board[sqr] = empty;
+    assert(bits[type] & SquareBit(sqr));
+    bits[type] &= ~SquareBit(sqr);
+    bits[COLOR(type)] &= ~SquareBit(sqr);
+  }
+
+  //---------------------------------------------------------------------------
+  inline void MovePieceBits(const int type, const int from, const int to) {
+    assert(IS_PTYPE(type));
+    assert(bits[type] & SquareBit(from));
+    assert(!(bits[COLOR(type)] & SquareBit(to)));
+    const uint64_t mask = (SquareBit(from) | SquareBit(to));
+    bits[type] ^= mask;
+    bits[COLOR(type)] ^= mask;
+  }
+
+  //---------------------------------------------------------------------------
+  template<Color color>
+  void ClearKingDirs(const int from) {
+    assert(IS_SQUARE(from));
+    for (uint64_t mvs = _queenKing[from]; mvs; mvs >>= 8) {
+      assert(mvs & 0xFF);
+      const int end = ((mvs & 0xFF) - 1);
+      const int dir = Direction(from, end);
+      assert(IS_DIR(dir));
+      for (int to = (from + dir);; to += dir) {
+        assert(IS_SQUARE(to));
+        assert(Direction(from, to) == dir);
+        if (kingDir[to + (color * 8)]) {
+          kingDir[to + (color * 8)] = 0;
+        }
+        else {
+          break;
         }
-        if (_board[sqr] != _EMPTY) {
+        if (to == end) {
           break;
         }
       }
     }
   }
-  if ((dir = _kingDir[to + (color * 8)])) {
-    assert(IS_DIR(dir));
-    assert(Direction(to, _KING[color]->sqr) == dir);
-    for (int sqr = (to - dir); IS_SQUARE(sqr) && _kingDir[sqr + (color * 8)];
-         sqr -= dir)
-    {
-      assert(Direction(to, sqr) == -dir);
-      _kingDir[sqr + (color * 8)] = 0;
+
+  //---------------------------------------------------------------------------
+  template<Color color>
+  void SetKingDirs(const int from) {
+    assert(IS_SQUARE(from));
+    for (uint64_t mvs = _queenKing[from]; mvs; mvs >>= 8) {
+      assert(mvs & 0xFF);
+      const int end = ((mvs & 0xFF) - 1);
+      const int dir = Direction(from, end);
+      assert(IS_DIR(dir));
+      for (int to = (from + dir);; to += dir) {
+        assert(IS_SQUARE(to));
+        assert(Direction(from, to) == dir);
+        assert(!kingDir[to + (color * 8)]);
+        kingDir[to + (color * 8)] = -dir;
+        if ((to == end) || (board[to] != empty)) {
+          break;
+        }
+      }
     }
   }
-}
-
-//-----------------------------------------------------------------------------
-inline void AddAttack(const int from, const int to, const int dir) {
-  assert(IS_SQUARE(from));
-  assert(IS_SQUARE(to));
-  assert(from != to);
-  assert(_board[from] >= _FIRST_SLIDER);
-  assert(IS_SLIDER(_board[from]->type));
-  assert(_board[from]->sqr == from);
-  assert(Direction(from, to) == dir);
-  assert(!(_atk[to] & (0xFFULL << DirShift(dir))) ||
-         ((_atk[to] & (0xFFULL << DirShift(dir))) ==
-          (uint64_t(from + 1) << DirShift(dir))));
-  _atk[to] |= (uint64_t(from + 1) << DirShift(dir));
-}
 
-//-----------------------------------------------------------------------------
-inline void AddSlide(const int from, const int to, const int dir) {
-  assert(IS_SQUARE(from));
-  assert(IS_SQUARE(to));
-  assert(from != to);
-  assert(_board[from] >= _FIRST_SLIDER);
-  assert(IS_SLIDER(_board[from]->type));
-  assert(_board[from]->sqr == from);
-  assert(Direction(from, to) == dir);
-  assert(!(_atk[from + 8] & (0xFFULL << DirShift(dir))) ||
-         ((_atk[from + 8] & (0xFFULL << DirShift(dir))) ==
-          (uint64_t(to + 1) << DirShift(dir))));
-  _atk[from + 8] |= (uint64_t(to + 1) << DirShift(dir));
-}
+  //---------------------------------------------------------------------------
+  template<Color color>
+  void UpdateKingDirs(const int from, const int to) {
+    assert(IS_SQUARE(from));
+    assert(IS_SQUARE(to));
+    assert(from != to);
+    assert(board[to] != empty);
+    int dir = kingDir[from + (color * 8)];
+    if (dir && (board[from] == empty)) {
+      assert(IS_DIR(dir));
+      assert(Direction(from, king[color]->sqr) == dir);
+      if (Direction(from, to) != dir) {
+        for (int sqr = (from - dir); IS_SQUARE(sqr); sqr -= dir) {
+          assert(Direction(from, sqr) == -dir);
+          kingDir[sqr + (color * 8)] = dir;
+          if (sqr == to) {
+            return;
+          }
+          if (board[sqr] != empty) {
+            break;
+          }
+        }
+      }
+    }
+    if ((dir = kingDir[to + (color * 8)])) {
+      assert(IS_DIR(dir));
+      assert(Direction(to, king[color]->sqr) == dir);
+      for (int sqr = (to - dir); IS_SQUARE(sqr) && kingDir[sqr + (color * 8)];
+           sqr -= dir)
+      {
+        assert(Direction(to, sqr) == -dir);
+        kingDir[sqr + (color * 8)] = 0;
+      }
+    }
+  }
 
-//-----------------------------------------------------------------------------
-inline void SetSlide(const int from, const int to, const int dir) {
-  assert(IS_SQUARE(from));
-  assert(IS_SQUARE(to));
-  assert(from != to);
-  assert(_board[from] >= _FIRST_SLIDER);
-  assert(IS_SLIDER(_board[from]->type));
-  assert(_board[from]->sqr == from);
-  assert(Direction(from, to) == dir);
-  const int shift = DirShift(dir);
-  _atk[from + 8] = ((_atk[from + 8] & ~(0xFFULL << shift)) |
-      (uint64_t(to + 1) << shift));
-}
+  //---------------------------------------------------------------------------
+  inline void AddAttack(const int from, const int to, const int dir) {
+    assert(IS_SQUARE(from));
+    assert(IS_SQUARE(to));
+    assert(from != to);
+    assert(board[from] >= firstSlider);
+    assert(IS_SLIDER(board[from]->type));
+    assert(board[from]->sqr == from);
+    assert(Direction(from, to) == dir);
+    assert(!(atk[to] & (0xFFULL << DirShift(dir))) ||
+           ((atk[to] & (0xFFULL << DirShift(dir))) ==
+            (uint64_t(from + 1) << DirShift(dir))));
+    atk[to] |= (uint64_t(from + 1) << DirShift(dir));
+  }
 
-//-----------------------------------------------------------------------------
-inline void ClearAttack(const int to, const int dir) {
-  assert(IS_SQUARE(to));
-  _atk[to] &= ~(0xFFULL << DirShift(dir));
-}
+  //---------------------------------------------------------------------------
+  inline void AddSlide(const int from, const int to, const int dir) {
+    assert(IS_SQUARE(from));
+    assert(IS_SQUARE(to));
+    assert(from != to);
+    assert(board[from] >= firstSlider);
+    assert(IS_SLIDER(board[from]->type));
+    assert(board[from]->sqr == from);
+    assert(Direction(from, to) == dir);
+    assert(!(atk[from + 8] & (0xFFULL << DirShift(dir))) ||
+           ((atk[from + 8] & (0xFFULL << DirShift(dir))) ==
+            (uint64_t(to + 1) << DirShift(dir))));
+    atk[from + 8] |= (uint64_t(to + 1) << DirShift(dir));
+  }
 
-//-----------------------------------------------------------------------------
-inline void ClearSlide(const int from, const int dir) {
-  assert(IS_SQUARE(from));
-  assert(_board[from] >= _FIRST_SLIDER);
-  assert(IS_SLIDER(_board[from]->type));
-  assert(_board[from]->sqr == from);
-  _atk[from + 8] &= ~(0xFFULL << DirShift(dir));
-}
+  //---------------------------------------------------------------------------
+  inline void SetSlide(const int from, const int to, const int dir) {
+    assert(IS_SQUARE(from));
+    assert(IS_SQUARE(to));
+    assert(from != to);
+    assert(board[from] >= firstSlider);
+    assert(IS_SLIDER(board[from]->type));
+    assert(board[from]->sqr == from);
+    assert(Direction(from, to) == dir);
+    const int shift = DirShift(dir);
+    atk[from + 8] = ((atk[from + 8] & ~(0xFFULL << shift)) |
+        (uint64_t(to + 1) << shift));
+  }
 
-//-----------------------------------------------------------------------------
-void AddAttacksFrom(const int pc, const int from) {
-  assert(IS_SLIDER(pc));
-  assert(IS_SQUARE(from));
-  assert(_board[from] >= _FIRST_SLIDER);
-  assert(_board[from]->type == pc);
-  assert(_board[from]->sqr == from);
-  uint64_t mvs = (pc < Rook)  ? _bishopRook[from] :
-                 (pc < Queen) ? _bishopRook[from + 8]
-                              : _queenKing[from];
-  for (; mvs; mvs >>= 8) {
-    assert(mvs & 0xFF);
-    const int end = ((mvs & 0xFF) - 1);
-    const int dir = Direction(from, end);
-    assert(IS_DIR(dir));
-    for (int to = (from + dir);; to += dir) {
-      assert(IS_SQUARE(to));
-      assert(Direction(from, to) == dir);
-      AddAttack(from, to, dir);
-      if ((to == end) || (_board[to] != _EMPTY)) {
-        AddSlide(from, to, dir);
-        break;
-      }
-    }
+  //---------------------------------------------------------------------------
+  inline void ClearAttack(const int to, const int dir) {
+    assert(IS_SQUARE(to));
+    atk[to] &= ~(0xFFULL << DirShift(dir));
   }
-}
 
-//-----------------------------------------------------------------------------
-void ClearAttacksFrom(const int pc, const int from) {
-  assert(IS_SLIDER(pc));
-  assert(IS_SQUARE(from));
-  assert(_board[from] >= _FIRST_SLIDER);
-  assert(_board[from]->type == pc);
-  assert(_board[from]->sqr == from);
-  uint64_t mvs = (pc < Rook)  ? _bishopRook[from] :
-                 (pc < Queen) ? _bishopRook[from + 8]
-                              : _queenKing[from];
-  for (; mvs; mvs >>= 8) {
-    assert(mvs & 0xFF);
-    const int end = ((mvs & 0xFF) - 1);
-    const int dir = Direction(from, end);
-    assert(IS_DIR(dir));
-    ClearSlide(from, dir);
-    for (int to = (from + dir);; to += dir) {
-      assert(IS_SQUARE(to));
-      assert(Direction(from, to) == dir);
-      ClearAttack(to, dir);
-      if ((to == end) || (_board[to] != _EMPTY)) {
-        break;
-      }
-    }
+  //---------------------------------------------------------------------------
+  inline void ClearSlide(const int from, const int dir) {
+    assert(IS_SQUARE(from));
+    assert(board[from] >= firstSlider);
+    assert(IS_SLIDER(board[from]->type));
+    assert(board[from]->sqr == from);
+    atk[from + 8] &= ~(0xFFULL << DirShift(dir));
   }
-}
 
-//-----------------------------------------------------------------------------
-void TruncateAttacks(const int to, const int stop) {
-  assert(IS_SQUARE(to));
-  for (uint64_t tmp = _atk[to]; tmp; tmp >>= 8) {
-    if (tmp & 0xFF) {
-      const int from = static_cast<int>((tmp & 0xFF) - 1);
-      assert(IS_SQUARE(from));
-      assert(_board[from] >= _FIRST_SLIDER);
-      assert(IS_SLIDER(_board[from]->type));
-      assert(_board[from]->sqr == from);
-      const int dir = Direction(from, to);
-      SetSlide(from, to, dir);
-      for (int ato = (to + dir); IS_SQUARE(ato); ato += dir) {
-        assert(Direction(from, ato) == dir);
-        ClearAttack(ato, dir);
-        if ((ato == stop) || (_board[ato] != _EMPTY)) {
+  //---------------------------------------------------------------------------
+  void AddAttacksFrom(const int pc, const int from) {
+    assert(IS_SLIDER(pc));
+    assert(IS_SQUARE(from));
+    assert(board[from] >= firstSlider);
+    assert(board[from]->type == pc);
+    assert(board[from]->sqr == from);
+    uint64_t mvs = (pc < Rook)  ? _bishopRook[from] :
+                   (pc < Queen) ? _bishopRook[from + 8]
+                                : _queenKing[from];
+    for (; mvs; mvs >>= 8) {
+      assert(mvs & 0xFF);
+      const int end = ((mvs & 0xFF) - 1);
+      const int dir = Direction(from, end);
+      assert(IS_DIR(dir));
+      for (int to = (from + dir);; to += dir) {
+        assert(IS_SQUARE(to));
+        assert(Direction(from, to) == dir);
+        AddAttack(from, to, dir);
+        if ((to == end) || (board[to] != empty)) {
+          AddSlide(from, to, dir);
           break;
         }
       }
     }
   }
-}
 
-//-----------------------------------------------------------------------------
-void ExtendAttacks(const int to) {
-  assert(IS_SQUARE(to));
-  assert(_board[to] == _EMPTY);
-  for (uint64_t tmp = _atk[to]; tmp; tmp >>= 8) {
-    if (tmp & 0xFF) {
-      const int from = static_cast<int>((tmp & 0xFF) - 1);
-      assert(IS_SQUARE(from));
-      assert(_board[from] >= _FIRST_SLIDER);
-      assert(IS_SLIDER(_board[from]->type));
-      assert(_board[from]->sqr == from);
-      const int dir = Direction(from, to);
+  //---------------------------------------------------------------------------
+  void ClearAttacksFrom(const int pc, const int from) {
+    assert(IS_SLIDER(pc));
+    assert(IS_SQUARE(from));
+    assert(board[from] >= firstSlider);
+    assert(board[from]->type == pc);
+    assert(board[from]->sqr == from);
+    uint64_t mvs = (pc < Rook)  ? _bishopRook[from] :
+                   (pc < Queen) ? _bishopRook[from + 8]
+                                : _queenKing[from];
+    for (; mvs; mvs >>= 8) {
+      assert(mvs & 0xFF);
+      const int end = ((mvs & 0xFF) - 1);
+      const int dir = Direction(from, end);
       assert(IS_DIR(dir));
-      int end = to;
-      for (int ato = (to + dir); IS_SQUARE(ato); ato += dir) {
-        assert(Direction(from, ato) == dir);
-        AddAttack(from, (end = ato), dir);
-        if (_board[ato] != _EMPTY) {
+      ClearSlide(from, dir);
+      for (int to = (from + dir);; to += dir) {
+        assert(IS_SQUARE(to));
+        assert(Direction(from, to) == dir);
+        ClearAttack(to, dir);
+        if ((to == end) || (board[to] != empty)) {
           break;
         }
       }
-      if (end != to) {
-        SetSlide(from, end, dir);
+    }
+  }
+
+  //---------------------------------------------------------------------------
+  void TruncateAttacks(const int to, const int stop) {
+    assert(IS_SQUARE(to));
+    for (uint64_t tmp = atk[to]; tmp; tmp >>= 8) {
+      if (tmp & 0xFF) {
+        const int from = static_cast<int>((tmp & 0xFF) - 1);
+        assert(IS_SQUARE(from));
+        assert(board[from] >= firstSlider);
+        assert(IS_SLIDER(board[from]->type));
+        assert(board[from]->sqr == from);
+        const int dir = Direction(from, to);
+        SetSlide(from, to, dir);
+        for (int ato = (to + dir); IS_SQUARE(ato); ato += dir) {
+          assert(Direction(from, ato) == dir);
+          ClearAttack(ato, dir);
+          if ((ato == stop) || (board[ato] != empty)) {
+            break;
+          }
+        }
       }
     }
   }
-}
 
-//-----------------------------------------------------------------------------
-template<Color color>
-bool AttackedBy(const int sqr) {
-  assert(IS_SQUARE(sqr));
-  if (_pcount[color]) {
-    assert(_pcount[color] > 0);
-    for (uint64_t mvs = _atk[sqr]; mvs; mvs >>= 8) {
-      if (mvs & 0xFF) {
-        assert(IS_SQUARE((mvs & 0xFF) - 1));
-        assert(IS_DIR(Direction(((mvs & 0xFF) - 1), sqr)));
-        assert(_board[(mvs & 0xFF) - 1] >= _FIRST_SLIDER);
-        assert(_board[(mvs & 0xFF) - 1]->sqr == ((mvs & 0xFF) - 1));
-        assert(IS_SLIDER(_board[(mvs & 0xFF) - 1]->type));
-        if (COLOR(_board[(mvs & 0xFF) - 1]->type) == color) {
-          return true;
+  //---------------------------------------------------------------------------
+  void ExtendAttacks(const int to) {
+    assert(IS_SQUARE(to));
+    assert(board[to] == empty);
+    for (uint64_t tmp = atk[to]; tmp; tmp >>= 8) {
+      if (tmp & 0xFF) {
+        const int from = static_cast<int>((tmp & 0xFF) - 1);
+        assert(IS_SQUARE(from));
+        assert(board[from] >= firstSlider);
+        assert(IS_SLIDER(board[from]->type));
+        assert(board[from]->sqr == from);
+        const int dir = Direction(from, to);
+        assert(IS_DIR(dir));
+        int end = to;
+        for (int ato = (to + dir); IS_SQUARE(ato); ato += dir) {
+          assert(Direction(from, ato) == dir);
+          AddAttack(from, (end = ato), dir);
+          if (board[ato] != empty) {
+            break;
+          }
+        }
+        if (end != to) {
+          SetSlide(from, end, dir);
         }
       }
     }
   }
-  if (_pcount[color|Knight]) {
-    assert(_pcount[color|Knight] > 0);
-    for (uint64_t mvs = _knightMoves[sqr]; mvs; mvs >>= 8) {
-      assert(mvs & 0xFF);
-      assert(IS_SQUARE((mvs & 0xFF) - 1));
-      assert(int((mvs & 0xFF) - 1) != sqr);
-      if (_board[(mvs & 0xFF) - 1]->type == (color|Knight)) {
-        assert(_board[(mvs & 0xFF) - 1]->sqr == ((mvs & 0xFF) - 1));
+
+  //---------------------------------------------------------------------------
+  template<Color color>
+  bool AttackedBy(const int sqr) {
+    assert(IS_SQUARE(sqr));
+    if (pcount[color]) {
+      assert(pcount[color] > 0);
+      const uint64_t occupied = (bits[White] | bits[Black]);
+      if ((BishopAttacks(sqr, occupied) &
+           (bits[color|Bishop] | bits[color|Queen])) |
+          (RookAttacks(sqr, occupied) &
+           (bits[color|Rook] | bits[color|Queen])))
+      {
         return true;
       }
     }
+    return ((_knightBits[sqr] & bits[color|Knight]) |
+            (_kingBits[sqr] & bits[color|King]) |
+            (_pawnBits[sqr + (8 * !color)] & bits[color|Pawn])) != 0;
   }
-  for (uint64_t mvs = _queenKing[sqr + 8]; mvs; mvs >>= 8) {
-    assert(mvs & 0xFF);
-    const int from = ((mvs & 0xFF) - 1);
-    assert(IS_DIR(Direction(sqr, from)));
-    if (_board[from] == _KING[color]) {
-      assert(_board[from]->type == (color|King));
-      assert(_board[from]->sqr == from);
-      return true;
-    }
-    if (_board[from]->type == (color|Pawn)) {
-      assert(_board[from]->sqr == from);
-      if (color) {
-        switch (Direction(sqr, from)) {
-        case NorthWest: case NorthEast:
-          return true;
+
+  //---------------------------------------------------------------------------
+  bool VerifyAttacksTo(const int to, const bool do_assert, char kdir[128]) {
+    uint64_t attacks = 0;
+    const bool isKing = (board[to]->type >= King);
+    const int idx = (8 * COLOR(board[to]->type));
+    if (isKing) {
+      assert(!kingDir[to + idx]);
+    }
+    for (uint64_t mvs = _queenKing[to]; mvs; mvs >>= 8) {
+      assert(mvs & 0xFF);
+      const int end = ((mvs & 0xFF) - 1);
+      const int dir = Direction(end, to);
+      assert(IS_DIR(dir));
+      for (int from = (to - dir);; from -= dir) {
+        assert(IS_SQUARE(from));
+        assert(Direction(from, to) == dir);
+        if (isKing) {
+          kdir[from + idx] = dir;
         }
-      }
-      else {
-        switch (Direction(sqr, from)) {
-        case SouthWest: case SouthEast:
-          return true;
+        if (board[from] >= firstSlider) {
+          const int pc = board[from]->type;
+          assert(IS_SLIDER(pc));
+          assert(board[from]->sqr == from);
+          if ((IS_DIAG(dir) && ((Black|pc) != (Black|Rook))) ||
+              (IS_CROSS(dir) && ((Black|pc) != (Black|Bishop))))
+          {
+            attacks |= (uint64_t(from + 1) << DirShift(dir));
+          }
+          break;
+        }
+        if ((from == end) || (board[from] != empty)) {
+          break;
         }
       }
     }
+    if (do_assert) {
+      assert(attacks == atk[to]);
+    }
+    return (attacks == atk[to]);
   }
-  return false;
-}
 
-//-----------------------------------------------------------------------------
-bool VerifyAttacksTo(const int to, const bool do_assert, char kdir[128]) {
-  uint64_t atk = 0;
-  const bool king = (_board[to]->type >= King);
-  const int idx = (8 * COLOR(_board[to]->type));
-  if (king) {
-    assert(!_kingDir[to + idx]);
-  }
-  for (uint64_t mvs = _queenKing[to]; mvs; mvs >>= 8) {
-    assert(mvs & 0xFF);
-    const int end = ((mvs & 0xFF) - 1);
-    const int dir = Direction(end, to);
-    assert(IS_DIR(dir));
-    for (int from = (to - dir);; from -= dir) {
-      assert(IS_SQUARE(from));
-      assert(Direction(from, to) == dir);
-      if (king) {
-        kdir[from + idx] = dir;
-      }
-      if (_board[from] >= _FIRST_SLIDER) {
-        const int pc = _board[from]->type;
-        assert(IS_SLIDER(pc));
-        assert(_board[from]->sqr == from);
-        if ((IS_DIAG(dir) && ((Black|pc) != (Black|Rook))) ||
-            (IS_CROSS(dir) && ((Black|pc) != (Black|Bishop))))
-        {
-          atk |= (uint64_t(from + 1) << DirShift(dir));
+  //---------------------------------------------------------------------------
+  bool VerifySlide(uint64_t mvs, const int from, const bool do_assert) {
+    uint64_t slide = 0;
+    while (mvs) {
+      assert(mvs & 0xFF);
+      const int end = ((mvs & 0xFF) - 1);
+      const int dir = Direction(from, end);
+      assert(IS_DIR(dir));
+      assert(!(slide & (0xFFULL << DirShift(dir))));
+      for (int to = (from + dir);; to += dir) {
+        assert(IS_SQUARE(to));
+        assert(Direction(from, to) == dir);
+        if ((to == end) || (board[to] != empty)) {
+          slide |= (uint64_t(to + 1) << DirShift(dir));
+          break;
         }
-        break;
-      }
-      if ((from == end) || (_board[from] != _EMPTY)) {
-        break;
       }
+      assert(slide & (0xFFULL << DirShift(dir)));
+      mvs >>= 8;
     }
+    if (do_assert) {
+      assert(slide == atk[from + 8]);
+    }
+    return (slide == atk[from + 8]);
   }
-  if (do_assert) {
-    assert(atk == _atk[to]);
-  }
-  return (atk == _atk[to]);
-}
 
-//-----------------------------------------------------------------------------
-bool VerifySlide(uint64_t mvs, const int from, const bool do_assert) {
-  uint64_t slide = 0;
-  while (mvs) {
-    assert(mvs & 0xFF);
-    const int end = ((mvs & 0xFF) - 1);
-    const int dir = Direction(from, end);
-    assert(IS_DIR(dir));
-    assert(!(slide & (0xFFULL << DirShift(dir))));
-    for (int to = (from + dir);; to += dir) {
-      assert(IS_SQUARE(to));
-      assert(Direction(from, to) == dir);
-      if ((to == end) || (_board[to] != _EMPTY)) {
-        slide |= (uint64_t(to + 1) << DirShift(dir));
-        break;
+  //---------------------------------------------------------------------------
+  bool VerifyBits(const bool do_assert) {
+    uint64_t tmp[14] = {0};
+    for (int sqr = A1; sqr <= H8; ++sqr) {
+      if (BAD_SQR(sqr)) {
+        sqr += 7;
+      }
+      else if (board[sqr]->type) {
+        tmp[board[sqr]->type] |= SquareBit(sqr);
+        tmp[COLOR(board[sqr]->type)] |= SquareBit(sqr);
       }
     }
-    assert(slide & (0xFFULL << DirShift(dir)));
-    mvs >>= 8;
-  }
-  if (do_assert) {
-    assert(slide == _atk[from + 8]);
+    if (memcmp(tmp, bits, sizeof(bits))) {
+      if (do_assert) {
+        assert(false);
+      }
+      return false;
+    }
+    return true;
   }
-  return (slide == _atk[from + 8]);
-}
 
-//-----------------------------------------------------------------------------
-bool VerifyAttacks(const bool do_assert) {
-  char kdir[128] = {0};
-  for (int sqr = A1; sqr <= H8; ++sqr) {
-    if (BAD_SQR(sqr)) {
-      sqr += 7;
+  //---------------------------------------------------------------------------
+  bool VerifyAttacks(const bool do_assert) {
+    if (!VerifyBits(do_assert)) {
+      return false;
     }
-    else {
-      if (!VerifyAttacksTo(sqr, do_assert, kdir)) {
-        return false;
+    char kdir[128] = {0};
+    for (int sqr = A1; sqr <= H8; ++sqr) {
+      if (BAD_SQR(sqr)) {
+        sqr += 7;
       }
-      switch (Black|_board[sqr]->type) {
-      case (Black|Bishop):
-        if (!VerifySlide(_bishopRook[sqr], sqr, do_assert)) {
-          return false;
-        }
-        break;
-      case (Black|Rook):
-        if (!VerifySlide(_bishopRook[sqr + 8], sqr, do_assert)) {
+      else {
+        if (!VerifyAttacksTo(sqr, do_assert, kdir)) {
           return false;
         }
-        break;
-      case (Black|Queen):
-        if (!VerifySlide(_queenKing[sqr], sqr, do_assert)) {
-          return false;
+        switch (Black|board[sqr]->type) {
+        case (Black|Bishop):
+          if (!VerifySlide(_bishopRook[sqr], sqr, do_assert)) {
+            return false;
+          }
+          break;
+        case (Black|Rook):
+          if (!VerifySlide(_bishopRook[sqr + 8], sqr, do_assert)) {
+            return false;
+          }
+          break;
+        case (Black|Queen):
+          if (!VerifySlide(_queenKing[sqr], sqr, do_assert)) {
+            return false;
+          }
+          break;
         }
-        break;
       }
     }
-  }
-  if (memcmp(kdir, _kingDir, sizeof(kdir))) {
-    if (do_assert) {
-      assert(false);
+    if (memcmp(kdir, kingDir, sizeof(kdir))) {
+      if (do_assert) {
+        assert(false);
+      }
+      return false;
     }
-    return false;
+    return true;
   }
-  return true;
-}
 
-//-----------------------------------------------------------------------------
-template<Color color>
-bool EpPinned(const int from, const int cap) {
-  assert(_KING[color]->type == (color|King));
-  assert(IS_SQUARE(_KING[color]->sqr));
-  assert(IS_SQUARE(from));
-  assert(IS_SQUARE(cap));
-  assert(from != cap);
-  assert(from != _KING[color]->sqr);
-  assert(YC(from) == YC(cap));
-  assert(YC(from) == (color ? 3 : 4));
-  assert(Distance(from, cap) == 1);
-  assert(_board[from] != _EMPTY);
-  assert(_board[cap] != _EMPTY);
-  assert(_board[from]->type == (color|Pawn));
-  assert(_board[cap]->type == ((!color)|Pawn));
-  if (!_pcount[!color] || (YC(from) != YC(_KING[color]->sqr))) {
-    return false;
-  }
-  int left = std::min<int>(from, cap);
-  int right = std::max<int>(from, cap);
-  if (_KING[color]->sqr < left) {
-    right = ((_atk[right] >> DirShift(West)) & 0xFF);
-    assert(!right || (IS_SQUARE(right - 1) && (YC(right - 1) == YC(from))));
-    assert(!right || (_board[right - 1] >= _FIRST_SLIDER));
-    if (right-- && (_board[right] >= _FIRST_ROOK) &&
-        (COLOR(_board[right]->type) != color))
-    {
-      assert(_board[right]->type >= Rook);
-      assert(_board[right]->type < King);
-      assert(_board[right]->sqr == right);
-      while (--left > _KING[color]->sqr) {
-        assert(IS_SQUARE(left));
-        assert(Direction(right, left) == West);
-        if (_board[left] != _EMPTY) {
-          assert(left != _KING[color]->sqr);
-          return false;
+  //---------------------------------------------------------------------------
+  template<Color color>
+  bool EpPinned(const int from, const int cap) {
+    assert(king[color]->type == (color|King));
+    assert(IS_SQUARE(king[color]->sqr));
+    assert(IS_SQUARE(from));
+    assert(IS_SQUARE(cap));
+    assert(from != cap);
+    assert(from != king[color]->sqr);
+    assert(YC(from) == YC(cap));
+    assert(YC(from) == (color ? 3 : 4));
+    assert(Distance(from, cap) == 1);
+    assert(board[from] != empty);
+    assert(board[cap] != empty);
+    assert(board[from]->type == (color|Pawn));
+    assert(board[cap]->type == ((!color)|Pawn));
+    if (!pcount[!color] || (YC(from) != YC(king[color]->sqr))) {
+      return false;
+    }
+    int left = std::min<int>(from, cap);
+    int right = std::max<int>(from, cap);
+    if (king[color]->sqr < left) {
+      right = ((atk[right] >> DirShift(West)) & 0xFF);
+      assert(!right || (IS_SQUARE(right - 1) && (YC(right - 1) == YC(from))));
+      assert(!right || (board[right - 1] >= firstSlider));
+      if (right-- && (board[right] >= firstRook) &&
+          (COLOR(board[right]->type) != color))
+      {
+        assert(board[right]->type >= Rook);
+        assert(board[right]->type < King);
+        assert(board[right]->sqr == right);
+        while (--left > king[color]->sqr) {
+          assert(IS_SQUARE(left));
+          assert(Direction(right, left) == West);
+          if (board[left] != empty) {
+            assert(left != king[color]->sqr);
+            return false;
+          }
         }
+        assert(left == king[color]->sqr);
+        return true;
       }
-      assert(left == _KING[color]->sqr);
-      return true;
     }
-  }
-  else {
-    assert(_KING[color]->sqr > right);
-    left = ((_atk[left] >> DirShift(East)) & 0xFF);
-    assert(!left || (IS_SQUARE(left - 1) && (YC(left - 1) == YC(from))));
-    assert(!left || (_board[left - 1] >= _FIRST_ROOK));
-    if (left-- && (_board[left] >= _FIRST_ROOK) &&
-        (COLOR(_board[left]->type) != color))
-    {
-      assert(_board[left]->type >= Rook);
-      assert(_board[left]->type < King);
-      assert(_board[left]->sqr == left);
-      while (++right < _KING[color]->sqr) {
-        assert(IS_SQUARE(right));
-        assert(Direction(left, right) == East);
-        if (_board[right] != _EMPTY) {
-          assert(right != _KING[color]->sqr);
-          return false;
+    else {
+      assert(king[color]->sqr > right);
+      left = ((atk[left] >> DirShift(East)) & 0xFF);
+      assert(!left || (IS_SQUARE(left - 1) && (YC(left - 1) == YC(from))));
+      assert(!left || (board[left - 1] >= firstRook));
+      if (left-- && (board[left] >= firstRook) &&
+          (COLOR(board[left]->type) != color))
+      {
+        assert(board[left]->type >= Rook);
+        assert(board[left]->type < King);
+        assert(board[left]->sqr == left);
+        while (++right < king[color]->sqr) {
+          assert(IS_SQUARE(right));
+          assert(Direction(left, right) == East);
+          if (board[right] != empty) {
+            assert(right != king[color]->sqr);
+            return false;
+          }
         }
+        assert(right == king[color]->sqr);
+        return true;
       }
-      assert(right == _KING[color]->sqr);
-      return true;
     }
+    return false;
   }
-  return false;
-}
 
-//-----------------------------------------------------------------------------
-const char* NextWord(const char* p) {
-  while (p && *p && isspace(*p)) ++p;
-  return p;
-}
+  //---------------------------------------------------------------------------
+  inline void IncHistory(const Move& move, const int depth) {
+    assert(move.IsValid());
+    assert((depth >= 0) & (depth <= MaxPlies));
+    const int idx = move.TypeToIndex();
+    const int val = (hist[idx] + depth + 2);
+    hist[idx] = static_cast<char>(std::min<int>(val, 16));
+  }
 
-//-----------------------------------------------------------------------------
-const char* NextSpace(const char* p) {
-  while (p && *p && !isspace(*p)) ++p;
-  return p;
-}
+  //---------------------------------------------------------------------------
+  inline void DecHistory(const Move& move) {
+    const int idx = move.TypeToIndex();
+    const int val = (hist[idx] - 1);
+    hist[idx] = static_cast<char>(std::max<int>(val, -2));
+  }
+
+  //---------------------------------------------------------------------------
+  inline double EndGame(const Color color) {
+    return (static_cast<double>(StartMaterial-material[!color])/StartMaterial);
+  }
+
+  //---------------------------------------------------------------------------
+  inline double MidGame(const Color color) {
+    return (static_cast<double>(material[!color]) / StartMaterial);
+  }
+};
 
 //-----------------------------------------------------------------------------
-inline void IncHistory(const Move& move, const int depth) {
-  assert(move.IsValid());
-  assert((depth >= 0) & (depth <= MaxPlies));
-  const int idx = move.TypeToIndex();
-  const int val = (_hist[idx] + depth + 2);
-  _hist[idx] = static_cast<char>(std::min<int>(val, 16));
-}
+struct Node;
+struct SearchThread;
 
 //-----------------------------------------------------------------------------
-inline void DecHistory(const Move& move) {
-  const int idx = move.TypeToIndex();
-  const int val = (_hist[idx] - 1);
-  _hist[idx] = static_cast<char>(std::max<int>(val, -2));
-}
+// a node whose remaining moves are searched by more than one thread, it lives
+// on the owning thread's stack until all of its helpers are done with it
+//-----------------------------------------------------------------------------
+struct SplitPoint
+{
+  SplitPoint*   parent;    // split point the owner was working under
+  Node*         node;      // owner's node, holds the move list and pv
+  Move          firstMove; // already searched by the owner
+  bool          pvNode;
+  int           depth;
+  int           alpha;
+  int           beta;
+  int           best;
+  int           pvDepth;
+  volatile int  workers;   // threads still searching moves of this node
+  volatile bool cutoff;
+  senjo::Mutex  lock;
+};
 
 //-----------------------------------------------------------------------------
-inline double EndGame(const Color color) {
-  return (static_cast<double>(StartMaterial-_material[!color])/StartMaterial);
-}
+// a line of moves from the root whose leaves are counted by one perft thread
+//-----------------------------------------------------------------------------
+struct PerftJob
+{
+  int      root;    // index of the root move this count belongs to
+  int      moves;   // number of moves in line[]
+  int      depth;   // remaining depth after line[]
+  bool     qperft;
+  Move     line[2];
+  uint64_t count;
+};
 
 //-----------------------------------------------------------------------------
-inline double MidGame(const Color color) {
-  return (static_cast<double>(_material[!color]) / StartMaterial);
-}
+// search state shared by all search threads of one engine instance
+//-----------------------------------------------------------------------------
+struct SearchContext
+{
+  //---------------------------------------------------------------------------
+  SearchContext()
+    : stop(0),
+      depth(0),
+      movenum(0),
+      threadCount(1),
+      idleThreads(0),
+      startTime(0),
+      softTime(0),
+      hardTime(0),
+      timePct(100),
+      moveOverhead(DefaultMoveOverhead),
+      pondering(false),
+      canPonder(false),
+      debug(false),
+      ybw(false),
+      perftNext(0),
+      perftHashSize(0),
+      hashSize(DefaultHashSize),
+      pawnHashSize(DefaultPawnHashSize),
+      nodeLimit(0),
+      resizeDone(false)
+  {
+    drawScore[White] = 0;
+    drawScore[Black] = 0;
+  }
+
+  //---------------------------------------------------------------------------
+  ~SearchContext() {
+    resizeThread.Join();
+    SetThreadCount(0);
+  }
+
+  //---------------------------------------------------------------------------
+  // these need the complete SearchThread type, defined after it
+  //---------------------------------------------------------------------------
+  void InitSearch(const Color colorToMove, const uint64_t searchStart);
+  void SetTimeLimits(const int movestogo, const uint64_t movetime,
+                     const uint64_t clock, const uint64_t inc,
+                     const int defaultMovesToGo);
+  uint64_t SoftLimit() const {
+    return std::min<uint64_t>(hardTime, ((softTime * timePct) / 100));
+  }
+  void SetThreadCount(const int count);
+  void StartHelpers();
+  void StopHelpers();
+  int AssignHelpers(SplitPoint& sp, const Position& pos);
+  void RunPerftJobs();
+  void ResizeHash(const size_t mbytes);
+  bool ApplyResize();
+  void CancelResize();
+  bool InitHash();
+  void PrintHashSize() const;
+  uint64_t NodeCount() const;
+  Stats ThreadStats() const;
+  static void ResizeWorker(void* param);
+
+  volatile int stop;
+  int          depth;
+  int          movenum;
+  int          drawScore[2];
+  int          threadCount;
+  volatile int idleThreads; // helpers waiting to join a split point
+  uint64_t     startTime;
+  uint64_t     softTime; // msecs, don't start another iteration after this
+  uint64_t     hardTime; // msecs, search is stopped after this
+  int          timePct; // soft time adjustment based on search stability
+  int          moveOverhead;
+  volatile bool pondering; // ignore time limits until ponderhit
+  bool         canPonder; // value of the UCI Ponder option
+  bool         debug;
+  bool         ybw; // split nodes between threads rather than lazy smp
+  senjo::Mutex splitLock; // also guards perftNext
+  size_t       perftNext;
+  size_t       perftHashSize; // 0 = don't hash perft subtree counts
+  size_t       hashSize; // transposition table size in megabytes
+  size_t       pawnHashSize; // pawn table size of each thread in megabytes
+  std::string  hashShare; // name of a shared memory table, empty = private
+  uint64_t     nodeLimit; // nodes all threads may search, 0 = no limit
+  std::vector<PerftJob> perftJobs;
+  TranspositionTable<PerftEntry> perftTT;
+  std::string currmove;
+  Stats       totalStats;
+  TranspositionTable<HashCluster> tt;
+  TranspositionTable<HashCluster> nextTT; // allocated by resizeThread
+  senjo::Thread resizeThread;
+  senjo::Mutex  resizeLock; // guards resizeThread and nextTT
+  volatile bool resizeDone; // nextTT is ready to be swapped in
+  std::vector<SearchThread*> threads; // threads[0] is the main thread
+};
 
 //-----------------------------------------------------------------------------
 struct Node
@@ -1159,6 +1407,8 @@ struct Node
   //---------------------------------------------------------------------------
   // unchanging
   //---------------------------------------------------------------------------
+  SearchContext* ctx;
+  Position* pos;
   Node* parent;
   Node* child;
   int ply;
@@ -1189,8 +1439,21 @@ struct Node
   //---------------------------------------------------------------------------
   // updated by move generation and search
   //---------------------------------------------------------------------------
+  enum MoveStage {
+    HashMoveStage,  // nothing generated yet
+    CaptureStage,
+    Killer1Stage,
+    Killer2Stage,
+    QuietStage,
+    RemainingStage, // whatever is left in the move list
+    BadCaptureStage
+  };
   int moveIndex;
   int moveCount;
+  int sortIndex;
+  int stage;
+  int badIndex;
+  int badCount;
   Move moves[MaxMoves];
 
   //---------------------------------------------------------------------------
@@ -1202,10 +1465,126 @@ struct Node
 //  Move counter[128][128];
   Move pv[MaxPlies];
 
+  //---------------------------------------------------------------------------
+  void CopyState(const Node& other) {
+    state       = other.state;
+    ep          = other.ep;
+    rcount      = other.rcount;
+    mcount      = other.mcount;
+    pawnKey     = other.pawnKey;
+    pieceKey    = other.pieceKey;
+    positionKey = other.positionKey;
+    lastMove    = other.lastMove;
+    checks      = other.checks;
+    standPat    = other.standPat;
+  }
+
+  //---------------------------------------------------------------------------
+  // true if the search has been stopped or a split point this thread is
+  // working under has already failed high
+  //---------------------------------------------------------------------------
+  bool Aborted() const {
+    if (ctx->stop) {
+      return true;
+    }
+    for (const SplitPoint* sp = pos->split; sp; sp = sp->parent) {
+      if (sp->cutoff) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  //---------------------------------------------------------------------------
+  bool NodeLimitReached() const {
+    if (ctx->nodeLimit) {
+      const uint64_t nodes = (pos->stats.snodes + pos->stats.qnodes);
+      if ((ctx->threads.size() > 1)
+          ? (!(nodes & NodeLimitMask) && (ctx->NodeCount() >= ctx->nodeLimit))
+          : (nodes >= ctx->nodeLimit))
+      {
+        ctx->stop |= senjo::ChessEngine::Timeout;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  //---------------------------------------------------------------------------
+  static int DraftBucket(const int draft) {
+    return std::min<int>(draft, (Stats::DraftBuckets - 1));
+  }
+
+  //---------------------------------------------------------------------------
+  // transposition table key, changes for every position when the table is
+  // invalidated by ClearSearchData()
+  //---------------------------------------------------------------------------
+  uint64_t TTKey() const {
+    return (positionKey ^ ctx->tt.Salt());
+  }
+
+  //---------------------------------------------------------------------------
+  // the entry for this position, or the entry to replace if there isn't one
+  // 'stored' gets a private copy of the entry, read only the copy because
+  // other threads may be writing the shared entry at the same time
+  //---------------------------------------------------------------------------
+  HashEntry* ProbeTT(HashEntry& stored) {
+    const uint64_t key = TTKey();
+    HashEntry* entry = ctx->tt.Get(key)->Find(key, ctx->tt.Age());
+    stored = *entry;
+    if (stored.Key() == key) {
+      ctx->tt.IncHits();
+      pos->stats.ttDraftHits[DraftBucket(stored.Depth())]++;
+    }
+    return entry;
+  }
+
+  //---------------------------------------------------------------------------
+  // hash moves are played without generating moves, so make sure they're
+  // at least pseudo-legal (this only fails in release builds)
+  // checkmates, stalemates, and quiescence fail lows have no move
+  //---------------------------------------------------------------------------
+  template<Color color>
+  bool HashMoveOK(const HashEntry& stored) const {
+    if (!stored.MoveBits()) {
+      return true;
+    }
+    Move move;
+    move.Init(stored.MoveBits(), 0);
+    return !ValidateMove<color>(move);
+  }
+
+  //---------------------------------------------------------------------------
+  void StoreEntry(HashEntry* entry, const Move& move, const int eval,
+                  const int draft, const int primaryFlag, const int otherFlags)
+  {
+    const uint64_t key = TTKey();
+    if (entry->Key() && (entry->Key() != key)) {
+      pos->stats.ttOverwrites[DraftBucket(entry->Depth())]++;
+    }
+    entry->Set(key, move, eval, ply, draft, primaryFlag, otherFlags,
+               ctx->tt.Age());
+  }
+
+  //---------------------------------------------------------------------------
+  // quiescence results are stored at draft 0, and only over other draft 0
+  // entries or entries left by an earlier search (an older age, including
+  // the ones orphaned by Invalidate) so they never push live main search
+  // results out of the table
+  //---------------------------------------------------------------------------
+  void StoreQEntry(HashEntry* entry, const Move& move, const int eval,
+                   const int primaryFlag)
+  {
+    if (!entry->Depth() | (entry->Age() != ctx->tt.Age())) {
+      StoreEntry(entry, move, eval, 0, primaryFlag, 0);
+      pos->stats.qttStores++;
+    }
+  }
+
   //---------------------------------------------------------------------------
   bool InSeenStack() const {
 #ifndef NDEBUG
-    for (uint64_t* top = _seenStackTop; (top-- > _seenStack); ) {
+    for (uint64_t* top = pos->seenStackTop; (top-- > pos->seenStack); ) {
       if (positionKey == *top) {
         return true;
       }
@@ -1216,12 +1595,12 @@ struct Node
 
   //---------------------------------------------------------------------------
   bool HasRepeated() const {
-    if ((rcount > 1) & (_seenFilter[positionKey & SeenFilterMask] != 0)) {
-      for (int n = rcount, i = _seenIndex; n--;) {
+    if ((rcount > 1) & (pos->seenFilter[positionKey & SeenFilterMask] != 0)) {
+      for (int n = rcount, i = pos->seenIndex; n--;) {
         assert((i >= 0) & (i < MaxPlies));
         i += ((MaxPlies * !i) - 1);
         assert((i >= 0) & (i < MaxPlies));
-        if (_seen[i] == positionKey) {
+        if (pos->seen[i] == positionKey) {
           assert(InSeenStack());
           return true;
         }
@@ -1243,7 +1622,7 @@ struct Node
         killer[0] = move;
       }
       if (!checks) {
-        IncHistory(move, depth);
+        pos->IncHistory(move, depth);
       }
     }
 //    if (lastMove) {
@@ -1270,13 +1649,13 @@ struct Node
     if (do_eval) {
       Evaluate();
     }
-    const int mat = (_material[White] - _material[Black]);
+    const int mat = (pos->material[White] - pos->material[Black]);
     const int eval = (COLOR(state) ? -standPat : standPat);
     senjo::Output out(senjo::Output::NoPrefix);
     out << '\n';
     for (int y = 7; y >= 0; --y) {
       for (int x = 0; x < 8; ++x) {
-        switch (_board[SQR(x,y)]->type) {
+        switch (pos->board[SQR(x,y)]->type) {
         case (White|Pawn):   out << " P"; break;
         case (White|Knight): out << " N"; break;
         case (White|Bishop): out << " B"; break;
@@ -1329,7 +1708,7 @@ struct Node
     }
 
 #ifndef NDEBUG
-    if (_debug && do_eval) {
+    if (ctx->debug && do_eval) {
       out << '\n';
       out << "            \tWhite\tBlack\tSum\n";
       for (int type = 0; type < ScoreTypeCount; type += 2) {
@@ -1354,7 +1733,7 @@ struct Node
     int empty = 0;
     for (int y = 7; y >= 0; --y) {
       for (int x = 0; x < 8; ++x) {
-        const int type = _board[SQR(x,y)]->type;
+        const int type = pos->board[SQR(x,y)]->type;
         if (type && empty) {
           *p++ = ('0' + empty);
           empty = 0;
@@ -1413,89 +1792,50 @@ struct Node
   template<Color color>
   void FindCheckers() {
     assert(COLOR(state) == color);
-    assert(_KING[color]);
-    assert(_KING[color]->type == (color|King));
+    assert(pos->king[color]);
+    assert(pos->king[color]->type == (color|King));
 
-    const int sqr = _KING[color]->sqr;
+    const int sqr = pos->king[color]->sqr;
     assert(IS_SQUARE(sqr));
-    assert(_board[sqr] == _KING[color]);
+    assert(pos->board[sqr] == pos->king[color]);
 
     checks = 0;
 
-    if (_pcount[!color]) {
-      assert(_pcount[!color] > 0);
-      for (uint64_t mvs = _atk[sqr]; mvs; mvs >>= 8) {
-        if (mvs & 0xFF) {
-          assert(IS_SQUARE((mvs & 0xFF) - 1));
-          assert(IS_DIR(Direction(((mvs & 0xFF) - 1), sqr)));
-          assert(_board[(mvs & 0xFF) - 1] >= _FIRST_SLIDER);
-          assert(_board[(mvs & 0xFF) - 1]->sqr == ((mvs & 0xFF) - 1));
-          assert(IS_SLIDER(_board[(mvs & 0xFF) - 1]->type));
-          if (COLOR(_board[(mvs & 0xFF) - 1]->type) != color) {
-            assert(!(checks & 0xFF00));
-            checks = ((checks << 8) | (mvs & 0xFF));
-          }
-        }
-      }
-    }
-
-    if (_pcount[(!color)|Knight]) {
-      assert(_pcount[(!color)|Knight] > 0);
-      for (uint64_t mvs = _knightMoves[sqr]; mvs; mvs >>= 8) {
-        assert(mvs & 0xFF);
-        assert(IS_SQUARE((mvs & 0xFF) - 1));
-        assert(int((mvs & 0xFF) - 1) != sqr);
-        if (_board[(mvs & 0xFF) - 1]->type == ((!color)|Knight)) {
-          assert(_board[(mvs & 0xFF) - 1]->sqr == ((mvs & 0xFF) - 1));
-          assert(!(checks & 0xFF00));
-          checks = ((checks << 8) | (mvs & 0xFF));
-        }
-      }
-    }
-
-    for (uint64_t mvs = _queenKing[sqr + 8]; mvs; mvs >>= 8) {
-      assert(mvs & 0xFF);
-      const int from = ((mvs & 0xFF) - 1);
-      assert(IS_DIR(Direction(sqr, from)));
-      if (_board[from] == _KING[!color]) {
-        assert(_board[from]->type == ((!color)|King));
-        assert(_board[from]->sqr == from);
-        assert(!(checks & 0xFF00));
-        checks = ((checks << 8) | (mvs & 0xFF));
-      }
-      else if (_board[from]->type == ((!color)|Pawn)) {
-        assert(_board[from]->sqr == from);
-        if (color) {
-          switch (Direction(from, sqr)) {
-          case NorthWest: case NorthEast:
-            assert(!(checks & 0xFF00));
-            checks = ((checks << 8) | (mvs & 0xFF));
-            break;
-          }
-        }
-        else {
-          switch (Direction(from, sqr)) {
-          case SouthWest: case SouthEast:
-            assert(!(checks & 0xFF00));
-            checks = ((checks << 8) | (mvs & 0xFF));
-            break;
-          }
-        }
-      }
+    uint64_t bits = ((_knightBits[sqr] & pos->bits[(!color)|Knight]) |
+                     (_kingBits[sqr] & pos->bits[(!color)|King]) |
+                     (_pawnBits[sqr + (8 * color)] & pos->bits[(!color)|Pawn]));
+    if (pos->pcount[!color]) {
+      assert(pos->pcount[!color] > 0);
+      const uint64_t occupied = (pos->bits[White] | pos->bits[Black]);
+      bits |= ((BishopAttacks(sqr, occupied) &
+                (pos->bits[(!color)|Bishop] | pos->bits[(!color)|Queen])) |
+               (RookAttacks(sqr, occupied) &
+                (pos->bits[(!color)|Rook] | pos->bits[(!color)|Queen])));
+    }
+    while (bits) {
+      const int from = PopSquare(bits);
+      assert(pos->board[from]->type != ((!color)|Knight) ||
+             IsKnightMove(from, sqr));
+      assert(!IS_SLIDER(pos->board[from]->type) ||
+             (pos->atk[sqr] & (uint64_t(from + 1) <<
+                               DirShift(Direction(from, sqr)))));
+      assert(pos->board[from]->sqr == from);
+      assert(!(checks & 0xFF00));
+      checks = ((checks << 8) | (from + 1));
     }
   }
 
   //---------------------------------------------------------------------------
   inline int GetPinDir(const Color color, const int from) {
     assert(IS_SQUARE(from));
-    const int kdir = _kingDir[from + (color * 8)];
-    if ((kdir != 0) & (_atk[from] != 0ULL)) {
-      const int tmp = ((_atk[from] >> DirShift(kdir)) & 0xFF);
+    const int kdir = pos->kingDir[from + (color * 8)];
+    if ((kdir != 0) & (pos->atk[from] != 0ULL)) {
+      const int tmp = ((pos->atk[from] >> DirShift(kdir)) & 0xFF);
       if (tmp) {
         assert(IS_SQUARE(tmp - 1));
-        assert(_board[tmp - 1] >= _FIRST_SLIDER);
-        assert(IS_SLIDER(_board[tmp - 1]->type));
-        if (COLOR(_board[tmp - 1]->type) != color) {
+        assert(pos->board[tmp - 1] >= pos->firstSlider);
+        assert(IS_SLIDER(pos->board[tmp - 1]->type));
+        if (COLOR(pos->board[tmp - 1]->type) != color) {
           return abs(kdir);
         }
       }
@@ -1526,14 +1866,14 @@ struct Node
   //---------------------------------------------------------------------------
   inline int GetDiscoverDir(const Color color, const int from) {
     assert(IS_SQUARE(from));
-    const int kdir = _kingDir[from + (8 * !color)];
-    if ((kdir != 0) & (_atk[from] != 0ULL)) {
-      const int tmp = ((_atk[from] >> DirShift(kdir)) & 0xFF);
+    const int kdir = pos->kingDir[from + (8 * !color)];
+    if ((kdir != 0) & (pos->atk[from] != 0ULL)) {
+      const int tmp = ((pos->atk[from] >> DirShift(kdir)) & 0xFF);
       if (tmp) {
         assert(IS_SQUARE(tmp - 1));
-        assert(_board[tmp - 1] >= _FIRST_SLIDER);
-        assert(IS_SLIDER(_board[tmp - 1]->type));
-        if (COLOR(_board[tmp - 1]->type) == color) {
+        assert(pos->board[tmp - 1] >= pos->firstSlider);
+        assert(IS_SLIDER(pos->board[tmp - 1]->type));
+        if (COLOR(pos->board[tmp - 1]->type) == color) {
           return abs(kdir);
         }
       }
@@ -1555,24 +1895,16 @@ struct Node
 
   //---------------------------------------------------------------------------
   template<Color color, bool qsearch>
-  void GetPawnMoves(const int from, const int depth) {
+  void GetPawnCaptures(const int from, const int depth) {
     assert(!checks);
     assert(IS_SQUARE(from));
-    assert(_board[from] != _EMPTY);
-    assert(_board[from]->type == (color|Pawn));
-    assert(_board[from]->sqr == from);
+    assert(pos->board[from] != pos->empty);
+    assert(pos->board[from]->type == (color|Pawn));
+    assert(pos->board[from]->sqr == from);
     const int pinDir = GetPinDir(color, from);
     int score;
     int to;
 
-    int kdir = 0;
-    if (qsearch & (!depth)) {
-      kdir = GetDiscoverDir(color, from);
-      if (abs(kdir) == North) {
-        kdir = 0;
-      }
-    }
-
     for (uint64_t mvs = _pawnCaps[from + (color * 8)]; mvs; mvs >>= 8) {
       assert(mvs & 0xFF);
       to = ((mvs & 0xFF) - 1);
@@ -1581,11 +1913,11 @@ struct Node
       if (pinDir && (abs(Direction(from, to)) != pinDir)) {
         continue;
       }
-      const int cap = _board[to]->type;
-      assert(cap || (_board[to] == _EMPTY));
+      const int cap = pos->board[to]->type;
+      assert(cap || (pos->board[to] == pos->empty));
       if (!cap) {
         if ((ep != None) && (to == ep) &&
-            !EpPinned<color>(from, (ep + (color ? North : South))))
+            !pos->EpPinned<color>(from, (ep + (color ? North : South))))
         {
           AddMove(PawnCap, from, to, PawnValue);
         }
@@ -1605,78 +1937,136 @@ struct Node
         }
       }
     }
-    if (!qsearch || ((!depth) | (YC(from) == (color ? 1 : 6)))) {
+
+    // promotions go with the captures
+    if (YC(from) == (color ? 1 : 6)) {
       to = (from + (color ? South : North));
       if (pinDir && (abs(Direction(from, to)) != pinDir)) {
         return;
       }
-      if (_board[to] == _EMPTY) {
-        if (YC(to) == (color ? 0 : 7)) {
-          AddMove(PawnMove, from, to, QueenValue,  0, (color|Queen));
-          if (!qsearch || !depth) {
-            AddMove(PawnMove, from, to, RookValue,   0, (color|Rook));
-            AddMove(PawnMove, from, to, BishopValue, 0, (color|Bishop));
-            AddMove(PawnMove, from, to, KnightValue, 0, (color|Knight));
-          }
+      if (pos->board[to] == pos->empty) {
+        AddMove(PawnMove, from, to, QueenValue,  0, (color|Queen));
+        if (!qsearch || !depth) {
+          AddMove(PawnMove, from, to, RookValue,   0, (color|Rook));
+          AddMove(PawnMove, from, to, BishopValue, 0, (color|Bishop));
+          AddMove(PawnMove, from, to, KnightValue, 0, (color|Knight));
         }
-        else {
-          if (qsearch) {
-            assert(!depth);
-            if (kdir |
-                ((to + (color ? SouthWest : NorthWest)) == _KING[!color]->sqr) |
-                ((to + (color ? SouthEast : NorthEast)) == _KING[!color]->sqr))
-            {
-              score = (_PAWN_SQR[to + (8 * color)] -
-                       _PAWN_SQR[from + (8 * color)] + 25);
-              AddMove(PawnMove, from, to, score);
-            }
-          }
-          else {
+      }
+    }
+  }
+
+  //---------------------------------------------------------------------------
+  // non-promoting pushes, qsearch only wants the ones that give check
+  //---------------------------------------------------------------------------
+  template<Color color, bool qsearch>
+  void GetPawnQuiets(const int from) {
+    assert(!checks);
+    assert(IS_SQUARE(from));
+    assert(pos->board[from] != pos->empty);
+    assert(pos->board[from]->type == (color|Pawn));
+    assert(pos->board[from]->sqr == from);
+    if (YC(from) == (color ? 1 : 6)) {
+      return;
+    }
+
+    int to = (from + (color ? South : North));
+    if (pos->board[to] != pos->empty) {
+      return;
+    }
+    const int pinDir = GetPinDir(color, from);
+    if (pinDir && (abs(Direction(from, to)) != pinDir)) {
+      return;
+    }
+
+    int kdir = 0;
+    if (qsearch) {
+      kdir = GetDiscoverDir(color, from);
+      if (abs(kdir) == North) {
+        kdir = 0;
+      }
+    }
+
+    int score;
+    if (qsearch) {
+      const int king = pos->king[!color]->sqr;
+      if (kdir |
+          ((to + (color ? SouthWest : NorthWest)) == king) |
+          ((to + (color ? SouthEast : NorthEast)) == king))
+      {
+        score = (_PAWN_SQR[to + (8 * color)] -
+                 _PAWN_SQR[from + (8 * color)] + 25);
+        AddMove(PawnMove, from, to, score);
+      }
+    }
+    else {
+      score = (_PAWN_SQR[to + (8 * color)] -
+               _PAWN_SQR[from + (8 * color)] + 5);
+      AddMove(PawnMove, from, to, score);
+    }
+    if (YC(from) == (color ? 6 : 1)) {
+      to += (color ? South : North);
+      assert(IS_SQUARE(to));
+      if (pos->board[to] == pos->empty) {
+        if (qsearch) {
+          const int king = pos->king[!color]->sqr;
+          if (kdir |
+              ((to + (color ? SouthWest : NorthWest)) == king) |
+              ((to + (color ? SouthEast : NorthEast)) == king))
+          {
             score = (_PAWN_SQR[to + (8 * color)] -
-                     _PAWN_SQR[from + (8 * color)] + 5);
-            AddMove(PawnMove, from, to, score);
-          }
-          if (YC(from) == (color ? 6 : 1)) {
-            to += (color ? South : North);
-            assert(IS_SQUARE(to));
-            if (_board[to] == _EMPTY) {
-              if (qsearch) {
-                assert(!depth);
-                if (kdir |
-                    ((to + (color ? SouthWest : NorthWest)) == _KING[!color]->sqr) |
-                    ((to + (color ? SouthEast : NorthEast)) == _KING[!color]->sqr))
-                {
-                  score = (_PAWN_SQR[to + (8 * color)] -
-                           _PAWN_SQR[from + (8 * color)] + 30);
-                  AddMove(PawnLung, from, to, score);
-                }
-              }
-              else {
-                score = (_PAWN_SQR[to + (8 * color)] -
-                         _PAWN_SQR[from + (8 * color)] + 10);
-                AddMove(PawnLung, from, to, score);
-              }
-            }
+                     _PAWN_SQR[from + (8 * color)] + 30);
+            AddMove(PawnLung, from, to, score);
           }
         }
+        else {
+          score = (_PAWN_SQR[to + (8 * color)] -
+                   _PAWN_SQR[from + (8 * color)] + 10);
+          AddMove(PawnLung, from, to, score);
+        }
+      }
+    }
+  }
+
+  //---------------------------------------------------------------------------
+  void GetKnightCaptures(const Color color, const int from) {
+    assert(!checks);
+    assert(IS_SQUARE(from));
+    assert(pos->board[from] != pos->empty);
+    assert(pos->board[from]->type == (color|Knight));
+    assert(pos->board[from]->sqr == from);
+    if (GetPinDir(color, from)) {
+      return;
+    }
+
+    int score;
+    for (uint64_t mvs = _knightMoves[from]; mvs; mvs >>= 8) {
+      assert(mvs & 0xFF);
+      const int to = ((mvs & 0xFF) - 1);
+      assert(IS_SQUARE(to));
+      assert(to != from);
+      const int cap = pos->board[to]->type;
+      assert(cap || (pos->board[to] == pos->empty));
+      if (cap && (COLOR(cap) != color)) {
+        score = (ValueOf(cap) + _SQR[to] - _SQR[from] - (8 * KnightMove));
+        AddMove(KnightMove, from, to, score, cap);
       }
     }
   }
 
   //---------------------------------------------------------------------------
   template<bool qsearch>
-  void GetKnightMoves(const Color color, const int from, const int depth) {
+  void GetKnightQuiets(const Color color, const int from) {
     assert(!checks);
     assert(IS_SQUARE(from));
-    assert(_board[from] != _EMPTY);
-    assert(_board[from]->type == (color|Knight));
-    assert(_board[from]->sqr == from);
+    assert(pos->board[from] != pos->empty);
+    assert(pos->board[from]->type == (color|Knight));
+    assert(pos->board[from]->sqr == from);
     if (GetPinDir(color, from)) {
       return;
     }
 
     int kdir = 0;
-    if (qsearch && !depth) {
+    if (qsearch) {
       kdir = GetDiscoverDir(color, from);
     }
 
@@ -1686,11 +2076,9 @@ struct Node
       const int to = ((mvs & 0xFF) - 1);
       assert(IS_SQUARE(to));
       assert(to != from);
-      const int cap = _board[to]->type;
-      assert(cap || (_board[to] == _EMPTY));
-      if (!cap) {
+      if (pos->board[to] == pos->empty) {
         if (qsearch) {
-          if (!depth && (kdir | IsKnightMove(_KING[!color]->sqr, to))) {
+          if (kdir | IsKnightMove(pos->king[!color]->sqr, to)) {
             score = (_SQR[to] - _SQR[from] + 20);
             AddMove(KnightMove, from, to, score);
           }
@@ -1700,93 +2088,62 @@ struct Node
           AddMove(KnightMove, from, to, score);
         }
       }
-      else if (COLOR(cap) != color) {
-        score = (ValueOf(cap) + _SQR[to] - _SQR[from] - (8 * KnightMove));
-        AddMove(KnightMove, from, to, score, cap);
-      }
     }
   }
-
   //---------------------------------------------------------------------------
   void GetSliderCaptures(const Color color, const MoveType type,
-                         uint64_t mvs, const int from)
+                         uint64_t targets, const int from)
   {
     assert(!checks);
     assert(IS_SQUARE(from));
-    assert(_board[from] != _EMPTY);
-    assert(_board[from]->type == (color|type));
-    assert(_board[from]->sqr == from);
+    assert(pos->board[from] != pos->empty);
+    assert(pos->board[from]->type == (color|type));
+    assert(pos->board[from]->sqr == from);
+    assert(!(targets & ~pos->bits[!color]));
     const int pinDir = GetPinDir(color, from);
     int score;
-    while (mvs) {
-      if (mvs & 0xFF) {
-        const int to = ((mvs & 0xFF) - 1);
-        const int dir = (Direction(from, to));
-        assert(IS_DIR(dir));
-        if (!pinDir || (abs(dir) == pinDir)) {
-          const int cap = _board[to]->type;
-          assert(cap || (_board[to] == _EMPTY));
-          if ((cap != 0) & (COLOR(cap) != color)) {
-            score = (ValueOf(cap) - Distance(from, to) - (8 * type));
-            AddMove(type, from, to, score, cap);
-          }
-        }
+    while (targets) {
+      const int to = PopSquare(targets);
+      assert(IS_DIR(Direction(from, to)));
+      if (!pinDir || (abs(Direction(from, to)) == pinDir)) {
+        const int cap = pos->board[to]->type;
+        assert(IS_CAP(cap) & (COLOR(cap) != color));
+        score = (ValueOf(cap) - Distance(from, to) - (8 * type));
+        AddMove(type, from, to, score, cap);
       }
-      mvs >>= 8;
     }
   }
 
   //---------------------------------------------------------------------------
-  void GetSliderMoves(const Color color, const MoveType type,
-                      uint64_t mvs, const int from)
+  void GetSliderQuiets(const Color color, const MoveType type,
+                       uint64_t targets, const int from)
   {
     assert(!checks);
     assert(IS_SQUARE(from));
-    assert(_board[from] != _EMPTY);
-    assert(_board[from]->type == (color|type));
-    assert(_board[from]->sqr == from);
+    assert(pos->board[from] != pos->empty);
+    assert(pos->board[from]->type == (color|type));
+    assert(pos->board[from]->sqr == from);
+    assert(!(targets & (pos->bits[White] | pos->bits[Black])));
     const int pinDir = GetPinDir(color, from);
     int score;
-    while (mvs) {
-      assert(mvs & 0xFF);
-      const int end = ((mvs & 0xFF) - 1);
-      const int dir = (Direction(from, end));
-      assert(IS_DIR(dir));
-      if (!pinDir || (abs(dir) == pinDir)) {
-        for (int to = (from + dir);; to += dir) {
-          assert(IS_SQUARE(to));
-          assert(Direction(from, to) == dir);
-          const int cap = _board[to]->type;
-          assert(cap || (_board[to] == _EMPTY));
-          if (!cap) {
-            score = (_SQR[to] - _SQR[from]);
-            AddMove(type, from, to, score);
-          }
-          else {
-            if (COLOR(cap) != color) {
-              score = (ValueOf(cap) - Distance(from, to) - (8 * type));
-              AddMove(type, from, to, score, cap);
-            }
-            break;
-          }
-          if (to == end) {
-            break;
-          }
-        }
+    while (targets) {
+      const int to = PopSquare(targets);
+      assert(IS_DIR(Direction(from, to)));
+      if (!pinDir || (abs(Direction(from, to)) == pinDir)) {
+        score = (_SQR[to] - _SQR[from]);
+        AddMove(type, from, to, score);
       }
-      mvs >>= 8;
     }
   }
-
   //---------------------------------------------------------------------------
   void GetSliderDiscovers(const Color color, const MoveType type,
                           uint64_t mvs, const int from)
   {
     assert(!checks);
     assert(IS_SQUARE(from));
-    assert(_board[from] != _EMPTY);
-    assert(_board[from]->type == (color|type));
-    assert(_board[from]->sqr == from);
+    assert(pos->board[from] != pos->empty);
+    assert(pos->board[from]->type == (color|type));
+    assert(pos->board[from]->sqr == from);
     const int pinDir = GetPinDir(color, from);
     while (mvs) {
       assert(mvs & 0xFF);
@@ -1797,12 +2154,11 @@ struct Node
         for (int to = (from + dir);; to += dir) {
           assert(IS_SQUARE(to));
           assert(Direction(from, to) == dir);
-          const int cap = _board[to]->type;
-          assert(cap || (_board[to] == _EMPTY));
+          const int cap = pos->board[to]->type;
+          assert(cap || (pos->board[to] == pos->empty));
           if (!cap) {
-            if ((type == BishopMove) ? !IS_DIAG(_kingDir[to + (8 * !color)])
-                                     : !IS_CROSS(_kingDir[to + (8 * !color)]))
-            {
+            const int kdir = pos->kingDir[to + (8 * !color)];
+            if ((type == BishopMove) ? !IS_DIAG(kdir) : !IS_CROSS(kdir)) {
               const int score = (_SQR[to] - _SQR[from] + 10);
               AddMove(type, from, to, score);
             }
@@ -1822,9 +2178,9 @@ struct Node
   //---------------------------------------------------------------------------
   template<Color color>
   void GetSliderChecks() {
-    const int king = _KING[!color]->sqr;
+    const int king = pos->king[!color]->sqr;
     assert(IS_SQUARE(king));
-    assert(_board[king] == _KING[!color]);
+    assert(pos->board[king] == pos->king[!color]);
 
     int score;
     int pinDir;
@@ -1836,16 +2192,16 @@ struct Node
       for (int to = (king + dir);; to += dir) {
         assert(IS_SQUARE(to));
         assert(Direction(king, to) == dir);
-        for (uint64_t tmp = _atk[to]; tmp; tmp >>= 8) {
+        for (uint64_t tmp = pos->atk[to]; tmp; tmp >>= 8) {
           if (tmp & 0xFF) {
             const int from = ((tmp & 0xFF) - 1);
             assert(IS_SQUARE(from));
-            assert(_board[from] >= _FIRST_SLIDER);
-            assert(IS_SLIDER(_board[from]->type));
-            switch (_board[from]->type) {
+            assert(pos->board[from] >= pos->firstSlider);
+            assert(IS_SLIDER(pos->board[from]->type));
+            switch (pos->board[from]->type) {
             case (color|Bishop):
               assert(IS_DIAG(Direction(from, to)));
-              if (_board[to] == _EMPTY) {
+              if (pos->board[to] == pos->empty) {
                 if (IS_DIAG(dir)) {
                   pinDir = GetPinDir(color, from);
                   if (!pinDir || (abs(Direction(from, to)) == pinDir)) {
@@ -1855,14 +2211,14 @@ struct Node
                 }
               }
               else if ((Direction(to, from) == dir) &
-                       (_board[to]->type == (color|Rook)))
+                       (pos->board[to]->type == (color|Rook)))
               {
                 GetSliderDiscovers(color, RookMove, _bishopRook[to + 8], to);
               }
               break;
             case (color|Rook):
               assert(IS_CROSS(Direction(from, to)));
-              if (_board[to] == _EMPTY) {
+              if (pos->board[to] == pos->empty) {
                 if (IS_CROSS(dir)) {
                   pinDir = GetPinDir(color, from);
                   if (!pinDir || (abs(Direction(from, to)) == pinDir)) {
@@ -1872,14 +2228,14 @@ struct Node
                 }
               }
               else if ((Direction(to, from) == dir) &
-                       (_board[to]->type == (color|Bishop)))
+                       (pos->board[to]->type == (color|Bishop)))
               {
                 GetSliderDiscovers(color, BishopMove, _bishopRook[to], to);
               }
               break;
             case (color|Queen):
               assert(IS_DIR(Direction(from, to)));
-              if (_board[to] == _EMPTY) {
+              if (pos->board[to] == pos->empty) {
                 pinDir = GetPinDir(color, from);
                 if (!pinDir || (abs(Direction(from, to)) == pinDir)) {
                   score = (_SQR[to] - _SQR[from]);
@@ -1887,7 +2243,7 @@ struct Node
                 }
               }
               else if (Direction(to, from) == dir) {
-                switch (_board[to]->type) {
+                switch (pos->board[to]->type) {
                 case (color|Bishop):
                   if (IS_CROSS(dir)) {
                     GetSliderDiscovers(color, BishopMove, _bishopRook[to], to);
@@ -1904,26 +2260,53 @@ struct Node
             }
           }
         }
-        if ((to == end) | (_board[to] != _EMPTY)) {
+        if ((to == end) | (pos->board[to] != pos->empty)) {
           break;
         }
       }
     }
   }
 
+  //---------------------------------------------------------------------------
+  template<Color color>
+  void GetKingCaptures() {
+    assert(!checks);
+    assert(pos->king[color]->type == (color|King));
+
+    const int from = pos->king[color]->sqr;
+    assert(IS_SQUARE(from));
+    assert(pos->board[from] == pos->king[color]);
+
+    int score;
+    for (uint64_t mvs = _queenKing[from + 8]; mvs; mvs >>= 8) {
+      assert(mvs & 0xFF);
+      const int to = ((mvs & 0xFF) - 1);
+      assert(Distance(from, to) == 1);
+      assert(IS_DIR(Direction(from, to)));
+      const int cap = pos->board[to]->type;
+      assert(cap || (pos->board[to] == pos->empty));
+      if (cap && (COLOR(cap) != color) && !pos->AttackedBy<!color>(to)) {
+        score = (ValueOf(cap) + _SQR[to] - _SQR[from] - 80);
+        AddMove(KingMove, from, to, score, cap);
+      }
+    }
+  }
+
+  //---------------------------------------------------------------------------
+  // qsearch only wants king moves that uncover a check
   //---------------------------------------------------------------------------
   template<Color color, bool qsearch>
-  void GetKingMoves(const int depth) {
+  void GetKingQuiets() {
     assert(!checks);
-    assert(_KING[color]->type == (color|King));
+    assert(pos->king[color]->type == (color|King));
 
-    const int from = _KING[color]->sqr;
+    const int from = pos->king[color]->sqr;
     assert(IS_SQUARE(from));
-    assert(_board[from] == _KING[color]);
+    assert(pos->board[from] == pos->king[color]);
 
     int kdir = 0;
-    if (qsearch & (!depth)) {
-      kdir = GetDiscoverDir(color, from);
+    if (qsearch && !(kdir = GetDiscoverDir(color, from))) {
+      return;
     }
 
     int score;
@@ -1932,75 +2315,63 @@ struct Node
       const int to = ((mvs & 0xFF) - 1);
       assert(Distance(from, to) == 1);
       assert(IS_DIR(Direction(from, to)));
+      if (pos->board[to] != pos->empty) {
+        continue;
+      }
       if (qsearch) {
-        const int cap = _board[to]->type;
-        assert(cap || (_board[to] == _EMPTY));
-        if (cap) {
-          if ((COLOR(cap) != color) && !AttackedBy<!color>(to)) {
-            score = (ValueOf(cap) + _SQR[to] - _SQR[from] - 80);
-            AddMove(KingMove, from, to, score, cap);
-          }
-        }
-        else if (kdir && (kdir != abs(Direction(from, to)))) {
-          if (!AttackedBy<!color>(to)) {
-            score = (_SQR[to] - _SQR[from] - 10);
-            AddMove(KingMove, from, to, score);
-          }
+        if ((kdir != abs(Direction(from, to))) &&
+            !pos->AttackedBy<!color>(to))
+        {
+          score = (_SQR[to] - _SQR[from] - 10);
+          AddMove(KingMove, from, to, score);
         }
       }
-      else if (!AttackedBy<!color>(to)) {
-        const int cap = _board[to]->type;
-        assert(cap || (_board[to] == _EMPTY));
-        if (!cap) {
-          score = (_SQR[to] - _SQR[from] - 20);
-          AddMove(KingMove, from, to, score);
-          if ((to == (color ? F8 : F1)) &&
-              (state & (color ? BlackShort : WhiteShort)) &&
-              (_board[color ? G8 : G1] == _EMPTY) &&
-              !AttackedBy<!color>(color ? G8 : G1))
-          {
-            assert(from == (color ? E8 : E1));
-            assert(_board[color ? H8 : H1]->type == (color|Rook));
-            AddMove(CastleShort, from, (color ? G8 : G1), 50);
-          }
-          else if ((to == (color ? D8 : D1)) &&
-                   (state & (color ? BlackLong : WhiteLong)) &&
-                   (_board[color ? C8 : C1] == _EMPTY) &&
-                   (_board[color ? B8 : B1] == _EMPTY) &&
-                   !AttackedBy<!color>(color ? C8 : C1))
-          {
-            assert(from == (color ? E8 : E1));
-            assert(_board[color ? A8 : A1]->type == (color|Rook));
-            AddMove(CastleLong, from, (color ? C8 : C1), 50);
-          }
+      else if (!pos->AttackedBy<!color>(to)) {
+        score = (_SQR[to] - _SQR[from] - 20);
+        AddMove(KingMove, from, to, score);
+        if ((to == (color ? F8 : F1)) &&
+            (state & (color ? BlackShort : WhiteShort)) &&
+            (pos->board[color ? G8 : G1] == pos->empty) &&
+            !pos->AttackedBy<!color>(color ? G8 : G1))
+        {
+          assert(from == (color ? E8 : E1));
+          assert(pos->board[color ? H8 : H1]->type == (color|Rook));
+          AddMove(CastleShort, from, (color ? G8 : G1), 50);
         }
-        else if (COLOR(cap) != color) {
-          score = (ValueOf(cap) + _SQR[to] - _SQR[from] - 80);
-          AddMove(KingMove, from, to, score, cap);
+        else if ((to == (color ? D8 : D1)) &&
+                 (state & (color ? BlackLong : WhiteLong)) &&
+                 (pos->board[color ? C8 : C1] == pos->empty) &&
+                 (pos->board[color ? B8 : B1] == pos->empty) &&
+                 !pos->AttackedBy<!color>(color ? C8 : C1))
+        {
+          assert(from == (color ? E8 : E1));
+          assert(pos->board[color ? A8 : A1]->type == (color|Rook));
+          AddMove(CastleLong, from, (color ? C8 : C1), 50);
         }
       }
     }
   }
-
   //---------------------------------------------------------------------------
   template<Color color>
   void GetKingEscapes() {
-    assert(_KING[color]->type == (color|King));
+    assert(pos->king[color]->type == (color|King));
 
-    const int from = _KING[color]->sqr;
+    const int from = pos->king[color]->sqr;
     assert(IS_SQUARE(from));
-    assert(_board[from] == _KING[color]);
+    assert(pos->board[from] == pos->king[color]);
 
     const int sqr1 = ((checks & 0xFF) - 1);
     const int sqr2 = (((checks >> 8) & 0xFF) - 1);
     assert(sqr1 != sqr2);
     assert(IS_SQUARE(sqr1) & IS_SQUARE(sqr2));
-    assert(IS_CAP(_board[sqr1]->type) && (COLOR(_board[sqr1]->type) != color));
-    assert(IS_CAP(_board[sqr2]->type) && (COLOR(_board[sqr2]->type) != color));
+    assert(IS_CAP(pos->board[sqr1]->type) &&
+           (COLOR(pos->board[sqr1]->type) != color));
+    assert(IS_CAP(pos->board[sqr2]->type) &&
+           (COLOR(pos->board[sqr2]->type) != color));
 
-    const int dir1 = ((_board[sqr1]->type >= Bishop)
+    const int dir1 = ((pos->board[sqr1]->type >= Bishop)
                       ? abs(Direction(from, sqr1)) : 0);
-    const int dir2 = ((_board[sqr2]->type >= Bishop)
+    const int dir2 = ((pos->board[sqr2]->type >= Bishop)
                       ? abs(Direction(from, sqr2)) : 0);
     assert((!dir1 || IS_DIR(dir1)) && (!dir2 || IS_DIR(dir2)));
 
@@ -2013,9 +2384,9 @@ struct Node
       if (((dir == dir1) & (to != sqr1)) | ((dir == dir2) & (to != sqr2))) {
         continue;
       }
-      if (!AttackedBy<!color>(to)) {
-        const int cap = _board[to]->type;
-        assert(cap || (_board[to] == _EMPTY));
+      if (!pos->AttackedBy<!color>(to)) {
+        const int cap = pos->board[to]->type;
+        assert(cap || (pos->board[to] == pos->empty));
         if (!cap) {
           const int score = (_SQR[to] - _SQR[from]);
           AddMove(KingMove, from, to, score);
@@ -2038,21 +2409,21 @@ struct Node
     int to = (checks - 1);
     assert(IS_SQUARE(to));
 
-    int cap = _board[to]->type;
+    int cap = pos->board[to]->type;
     assert(IS_CAP(cap) & (COLOR(cap) != color));
     const bool slider = (cap >= Bishop);
 
     int score;
     uint64_t mvs;
-    if (_pcount[color|Pawn]) {
-      assert(_pcount[color|Pawn] > 0);
+    if (pos->pcount[color|Pawn]) {
+      assert(pos->pcount[color|Pawn] > 0);
       if ((cap == ((!color)|Pawn)) & (ep == (to + (color ? South : North)))) {
         if (XC(ep) > 0) {
           from = (ep + (color ? NorthWest : SouthWest));
-          if (_board[from]->type == (color|Pawn)) {
+          if (pos->board[from]->type == (color|Pawn)) {
             const int pinDir = GetPinDir(color, from);
             if ((!pinDir || (abs(Direction(from, to)) == pinDir)) &&
-                !EpPinned<color>(from, to))
+                !pos->EpPinned<color>(from, to))
             {
               AddMove(PawnCap, from, ep, PawnValue);
             }
@@ -2060,10 +2431,10 @@ struct Node
         }
         if (XC(ep) < 7) {
           from = (ep + (color ? NorthEast : SouthEast));
-          if (_board[from]->type == (color|Pawn)) {
+          if (pos->board[from]->type == (color|Pawn)) {
             const int pinDir = GetPinDir(color, from);
             if ((!pinDir || (abs(Direction(from, to)) == pinDir)) &&
-                !EpPinned<color>(from, to))
+                !pos->EpPinned<color>(from, to))
             {
               AddMove(PawnCap, from, ep, PawnValue);
             }
@@ -2076,7 +2447,7 @@ struct Node
         assert(IS_SQUARE(from));
         assert(Distance(from, to) == 1);
         assert(IS_DIAG(Direction(to, from)));
-        if (_board[from]->type == (color|Pawn)) {
+        if (pos->board[from]->type == (color|Pawn)) {
           const int pinDir = GetPinDir(color, from);
           if (!pinDir || (abs(Direction(from, to)) == pinDir)) {
             score = ValueOf(cap);
@@ -2095,7 +2466,7 @@ struct Node
       }
     }
 
-    const int king = _KING[color]->sqr;
+    const int king = pos->king[color]->sqr;
     assert(IS_SQUARE(king));
 
     const int dir = Direction(to, king);
@@ -2103,12 +2474,12 @@ struct Node
 
     do {
       assert(IS_SQUARE(to));
-      assert(cap == _board[to]->type);
+      assert(cap == pos->board[to]->type);
 
-      if (!cap && _pcount[color|Pawn]) {
+      if (!cap && pos->pcount[color|Pawn]) {
         from = (to + (color ? North : South));
         if (IS_SQUARE(from)) {
-          if (_board[from]->type == (color|Pawn)) {
+          if (pos->board[from]->type == (color|Pawn)) {
             const int pinDir = GetPinDir(color, from);
             if (!pinDir || (abs(Direction(from, to)) == pinDir)) {
               if (YC(to) == (color ? 0 : 7)) {
@@ -2124,10 +2495,10 @@ struct Node
               }
             }
           }
-          else if (!_board[from]->type && (YC(to) == (color ? 4 : 3))) {
+          else if (!pos->board[from]->type && (YC(to) == (color ? 4 : 3))) {
             from += (color ? North : South);
             assert(IS_SQUARE(from));
-            if (_board[from]->type == (color|Pawn)) {
+            if (pos->board[from]->type == (color|Pawn)) {
               const int pinDir = GetPinDir(color, from);
               if (!pinDir || (abs(Direction(from, to)) == pinDir)) {
                 score = (_PAWN_SQR[to + (8 * color)] -
@@ -2139,14 +2510,14 @@ struct Node
         }
       }
 
-      if (_pcount[color|Knight]) {
-        assert(_pcount[color|Knight] > 0);
+      if (pos->pcount[color|Knight]) {
+        assert(pos->pcount[color|Knight] > 0);
         for (mvs = _knightMoves[to]; mvs; mvs >>= 8) {
           assert(mvs & 0xFF);
           from = ((mvs & 0xFF) - 1);
           assert(IS_SQUARE(from));
           assert(from != to);
-          if ((_board[from]->type == (color|Knight)) &&
+          if ((pos->board[from]->type == (color|Knight)) &&
               !GetPinDir(color, from))
           {
             score = (ValueOf(cap) + _SQR[to] - _SQR[from] - (8 * KnightMove));
@@ -2155,15 +2526,15 @@ struct Node
         }
       }
 
-      if (_pcount[color]) {
-        assert(_pcount[color] > 0);
-        for (mvs = _atk[to]; mvs; mvs >>= 8) {
+      if (pos->pcount[color]) {
+        assert(pos->pcount[color] > 0);
+        for (mvs = pos->atk[to]; mvs; mvs >>= 8) {
           if (mvs & 0xFF) {
             from = ((mvs & 0xFF) - 1);
             assert(IS_SQUARE(from));
             assert(IS_DIR(Direction(from, to)));
-            assert(_board[from] >= _FIRST_SLIDER);
-            const int type = _board[from]->type;
+            assert(pos->board[from] >= pos->firstSlider);
+            const int type = pos->board[from]->type;
             assert(IS_SLIDER(type));
             if (COLOR(type) == color) {
               const int pinDir = GetPinDir(color, from);
@@ -2195,12 +2566,12 @@ struct Node
       {
         continue;
       }
-      if (AttackedBy<!color>(to)) {
+      if (pos->AttackedBy<!color>(to)) {
         continue;
       }
 
-      cap = _board[to]->type;
-      assert(cap || (_board[to] == _EMPTY));
+      cap = pos->board[to]->type;
+      assert(cap || (pos->board[to] == pos->empty));
       if (!cap) {
         score = (_SQR[to] - _SQR[king] - 20);
         AddMove(KingMove, king, to, score);
@@ -2212,34 +2583,136 @@ struct Node
     }
   }
 
+  //---------------------------------------------------------------------------
+  // captures and promotions (only queen promotions in qsearch below depth 0)
+  //---------------------------------------------------------------------------
+  template<Color color, bool qsearch>
+  void GetCaptures(const int depth) {
+    assert(!checks);
+    const uint64_t occupied = (pos->bits[White] | pos->bits[Black]);
+    const uint64_t targets = pos->bits[!color];
+    int from;
+    for (int i = pos->pcount[color|Pawn]; i--; ) {
+      assert(i >= 0);
+      from = pos->piece[(color ? BlackPawnOffset : PawnOffset) + i].sqr;
+      GetPawnCaptures<color, qsearch>(from, depth);
+    }
+
+    for (int i = pos->pcount[color|Knight]; i--; ) {
+      assert(i >= 0);
+      from = pos->piece[(color ? BlackKnightOffset : KnightOffset) + i].sqr;
+      GetKnightCaptures(color, from);
+    }
+
+    for (int i = pos->pcount[color|Bishop]; i--; ) {
+      assert(i >= 0);
+      from = pos->piece[(color ? BlackBishopOffset : BishopOffset) + i].sqr;
+      GetSliderCaptures(color, BishopMove,
+                        (BishopAttacks(from, occupied) & targets), from);
+    }
+
+    for (int i = pos->pcount[color|Rook]; i--; ) {
+      assert(i >= 0);
+      from = pos->piece[(color ? BlackRookOffset : RookOffset) + i].sqr;
+      GetSliderCaptures(color, RookMove,
+                        (RookAttacks(from, occupied) & targets), from);
+    }
+
+    for (int i = pos->pcount[color|Queen]; i--; ) {
+      assert(i >= 0);
+      from = pos->piece[(color ? BlackQueenOffset : QueenOffset) + i].sqr;
+      GetSliderCaptures(color, QueenMove,
+                        (QueenAttacks(from, occupied) & targets), from);
+    }
+
+    GetKingCaptures<color>();
+  }
+
+  //---------------------------------------------------------------------------
+  // all other moves, or just the checking ones for qsearch
+  //---------------------------------------------------------------------------
+  template<Color color, bool qsearch>
+  void GetQuiets() {
+    assert(!checks);
+    const uint64_t empty = ~(pos->bits[White] | pos->bits[Black]);
+    int from;
+    for (int i = pos->pcount[color|Pawn]; i--; ) {
+      assert(i >= 0);
+      from = pos->piece[(color ? BlackPawnOffset : PawnOffset) + i].sqr;
+      GetPawnQuiets<color, qsearch>(from);
+    }
+
+    for (int i = pos->pcount[color|Knight]; i--; ) {
+      assert(i >= 0);
+      from = pos->piece[(color ? BlackKnightOffset : KnightOffset) + i].sqr;
+      GetKnightQuiets<qsearch>(color, from);
+    }
+
+    if (qsearch) {
+      if (pos->pcount[color]) {
+        GetSliderChecks<color>();
+      }
+    }
+    else {
+      for (int i = pos->pcount[color|Bishop]; i--; ) {
+        assert(i >= 0);
+        from = pos->piece[(color ? BlackBishopOffset : BishopOffset) + i].sqr;
+        GetSliderQuiets(color, BishopMove,
+                        (BishopAttacks(from, ~empty) & empty), from);
+      }
+
+      for (int i = pos->pcount[color|Rook]; i--; ) {
+        assert(i >= 0);
+        from = pos->piece[(color ? BlackRookOffset : RookOffset) + i].sqr;
+        GetSliderQuiets(color, RookMove,
+                        (RookAttacks(from, ~empty) & empty), from);
+      }
+
+      for (int i = pos->pcount[color|Queen]; i--; ) {
+        assert(i >= 0);
+        from = pos->piece[(color ? BlackQueenOffset : QueenOffset) + i].sqr;
+        GetSliderQuiets(color, QueenMove,
+                        (QueenAttacks(from, ~empty) & empty), from);
+      }
+    }
+
+    GetKingQuiets<color, qsearch>();
+  }
+
   //---------------------------------------------------------------------------
   template<Color color, bool qsearch>
   void GenerateMoves(const int depth) {
-    assert(!_piece[0].type);
-    assert(_piece[WhiteKingOffset].type == (White|King));
-    assert(_piece[BlackKingOffset].type == (Black|King));
-    assert(_KING[White]->type == (White|King));
-    assert(_KING[Black]->type == (Black|King));
-    assert(IS_SQUARE(_KING[White]->sqr));
-    assert(IS_SQUARE(_KING[White]->sqr));
-    assert(_board[_KING[White]->sqr] == _KING[White]);
-    assert(_board[_KING[Black]->sqr] == _KING[Black]);
-    assert((_pcount[White] >= 0) & (_pcount[White] <= 13));
-    assert((_pcount[Black] >= 0) & (_pcount[Black] <= 13));
-    assert(_pcount[White] == (_pcount[White|Bishop] + _pcount[White|Rook] +
-                              _pcount[White|Queen]));
-    assert(_pcount[Black] == (_pcount[Black|Bishop] + _pcount[Black|Rook] +
-                              _pcount[Black|Queen]));
-    assert((_pcount[White|Pawn] >= 0) & (_pcount[White|Pawn] <= 8));
-    assert((_pcount[Black|Pawn] >= 0) & (_pcount[Black|Pawn] <= 8));
-    assert((_pcount[White|Knight] >= 0) & (_pcount[White|Knight] <= 10));
-    assert((_pcount[Black|Knight] >= 0) & (_pcount[Black|Knight] <= 10));
-    assert((_pcount[White|Bishop] >= 0) & (_pcount[White|Bishop] <= 10));
-    assert((_pcount[Black|Bishop] >= 0) & (_pcount[Black|Bishop] <= 10));
-    assert((_pcount[White|Rook] >= 0) & (_pcount[White|Rook] <= 10));
-    assert((_pcount[Black|Rook] >= 0) & (_pcount[Black|Rook] <= 10));
-    assert((_pcount[White|Queen] >= 0) & (_pcount[White|Queen] <= 9));
-    assert((_pcount[Black|Queen] >= 0) & (_pcount[Black|Queen] <= 9));
+    assert(!pos->piece[0].type);
+    assert(pos->piece[WhiteKingOffset].type == (White|King));
+    assert(pos->piece[BlackKingOffset].type == (Black|King));
+    assert(pos->king[White]->type == (White|King));
+    assert(pos->king[Black]->type == (Black|King));
+    assert(IS_SQUARE(pos->king[White]->sqr));
+    assert(IS_SQUARE(pos->king[White]->sqr));
+    assert(pos->board[pos->king[White]->sqr] == pos->king[White]);
+    assert(pos->board[pos->king[Black]->sqr] == pos->king[Black]);
+    assert((pos->pcount[White] >= 0) & (pos->pcount[White] <= 13));
+    assert((pos->pcount[Black] >= 0) & (pos->pcount[Black] <= 13));
+    assert(pos->pcount[White] == (pos->pcount[White|Bishop] +
+                                  pos->pcount[White|Rook] +
+                                  pos->pcount[White|Queen]));
+    assert(pos->pcount[Black] == (pos->pcount[Black|Bishop] +
+                                  pos->pcount[Black|Rook] +
+                                  pos->pcount[Black|Queen]));
+    assert((pos->pcount[White|Pawn] >= 0) & (pos->pcount[White|Pawn] <= 8));
+    assert((pos->pcount[Black|Pawn] >= 0) & (pos->pcount[Black|Pawn] <= 8));
+    assert((pos->pcount[White|Knight] >= 0) &
+           (pos->pcount[White|Knight] <= 10));
+    assert((pos->pcount[Black|Knight] >= 0) &
+           (pos->pcount[Black|Knight] <= 10));
+    assert((pos->pcount[White|Bishop] >= 0) &
+           (pos->pcount[White|Bishop] <= 10));
+    assert((pos->pcount[Black|Bishop] >= 0) &
+           (pos->pcount[Black|Bishop] <= 10));
+    assert((pos->pcount[White|Rook] >= 0) & (pos->pcount[White|Rook] <= 10));
+    assert((pos->pcount[Black|Rook] >= 0) & (pos->pcount[Black|Rook] <= 10));
+    assert((pos->pcount[White|Queen] >= 0) & (pos->pcount[White|Queen] <= 9));
+    assert((pos->pcount[Black|Queen] >= 0) & (pos->pcount[Black|Queen] <= 9));
 
     moveCount = moveIndex = 0;
 
@@ -2257,88 +2730,335 @@ struct Node
       return;
     }
 
-    int from;
-    for (int i = _pcount[color|Pawn]; i--; ) {
-      assert(i >= 0);
-      from = _piece[(color ? BlackPawnOffset : PawnOffset) + i].sqr;
-      GetPawnMoves<color, qsearch>(from, depth);
+    GetCaptures<color, qsearch>(depth);
+    if (!qsearch || !depth) {
+      GetQuiets<color, qsearch>();
     }
+    assert(!DuplicateMoveCount());
+  }
 
-    for (int i = _pcount[color|Knight]; i--; ) {
-      assert(i >= 0);
-      from = _piece[(color ? BlackKnightOffset : KnightOffset) + i].sqr;
-      GetKnightMoves<qsearch>(color, from, depth);
+  //---------------------------------------------------------------------------
+  inline void ScootMoveToFront(int idx) {
+    assert((idx >= 0) & (idx < moveCount));
+    while (idx-- > 0) {
+      moves[idx].SwapWith(moves[idx + 1]);
     }
+  }
 
-    for (int i = _pcount[color|Bishop]; i--; ) {
-      assert(i >= 0);
-      from = _piece[(color ? BlackBishopOffset : BishopOffset) + i].sqr;
-      if (qsearch) {
-        GetSliderCaptures(color, BishopMove, _atk[from + 8], from);
+  //---------------------------------------------------------------------------
+  // most cutoffs come from the first move, so only bring the best of the
+  // new moves [first, moveCount) to the front, GetNextMove() sorts the rest
+  // the first time it gets past that move
+  //---------------------------------------------------------------------------
+  void SortMoves(const int first) {
+    assert((first >= 0) & (first <= moveCount));
+    int best = first;
+    for (int i = (first + 1); i < moveCount; ++i) {
+      if (moves[i].GetScore() > moves[best].GetScore()) {
+        best = i;
       }
-      else {
-        GetSliderMoves(color, BishopMove, _bishopRook[from], from);
+    }
+    if (best != first) {
+      moves[first].SwapWith(moves[best]);
+    }
+    sortIndex = (first + 1);
+  }
+
+  //---------------------------------------------------------------------------
+  // short lists get an insertion sort, longer ones a heap based partial sort
+  // of the best SortedMoves, GetNextMove() comes back for the rest (which the
+  // heap has left in no particular order) when it gets to them
+  //---------------------------------------------------------------------------
+  void SortRemainingMoves() {
+    assert((sortIndex >= 0) & (sortIndex < moveCount));
+    const int first = sortIndex;
+    if ((moveCount - first) > SortedMoves) {
+      sortIndex = (first + SortedMoves);
+      std::partial_sort((moves + first), (moves + sortIndex),
+                        (moves + moveCount), Move::ScoreCompare);
+      return;
+    }
+    sortIndex = moveCount;
+    for (int i = (first + 1); i < moveCount; ++i) {
+      const Move move(moves[i]);
+      int n = i;
+      for (; (n > first) && (moves[n - 1].GetScore() < move.GetScore()); --n) {
+        moves[n] = moves[n - 1];
       }
+      moves[n] = move;
     }
+  }
 
-    for (int i = _pcount[color|Rook]; i--; ) {
-      assert(i >= 0);
-      from = _piece[(color ? BlackRookOffset : RookOffset) + i].sqr;
-      if (qsearch) {
-        GetSliderCaptures(color, RookMove, _atk[from + 8], from);
+  //---------------------------------------------------------------------------
+  // SortMoves() must be called on each batch of new moves first
+  //---------------------------------------------------------------------------
+  inline Move* GetNextMove() {
+    assert(moveIndex >= 0);
+    assert((moveCount >= 0) & (moveCount < MaxMoves));
+    if (moveIndex >= moveCount) {
+      return NULL;
+    }
+    if (moveIndex == sortIndex) {
+      SortRemainingMoves();
+    }
+    return (moves + moveIndex++);
+  }
+
+  //---------------------------------------------------------------------------
+  // static exchange evaluation of a capture, the least valuable attacker
+  // recaptures each time, and whenever an attacker leaves its square the
+  // slider (if any) behind it is picked up from that square's atk[] entry
+  //---------------------------------------------------------------------------
+  template<Color color>
+  int StaticExchange(const Move& move) {
+    assert(move.Cap());
+    const int from = move.From();
+    const int to   = move.To();
+    assert(pos->board[from]->type);
+    assert(COLOR(pos->board[from]->type) == color);
+
+    int sqrs[2][16];
+    int count[2] = {0, 0};
+    uint64_t mvs;
+    int sqr;
+
+    for (mvs = _pawnCaps[to + 8]; mvs; mvs >>= 8) {
+      sqr = ((mvs & 0xFF) - 1);
+      if ((sqr != from) && (pos->board[sqr]->type == (White|Pawn))) {
+        sqrs[White][count[White]++] = sqr;
+      }
+    }
+    for (mvs = _pawnCaps[to]; mvs; mvs >>= 8) {
+      sqr = ((mvs & 0xFF) - 1);
+      if ((sqr != from) && (pos->board[sqr]->type == (Black|Pawn))) {
+        sqrs[Black][count[Black]++] = sqr;
+      }
+    }
+    for (mvs = _knightMoves[to]; mvs; mvs >>= 8) {
+      sqr = ((mvs & 0xFF) - 1);
+      if ((sqr != from) && ((pos->board[sqr]->type & ~1) == Knight)) {
+        const int c = COLOR(pos->board[sqr]->type);
+        sqrs[c][count[c]++] = sqr;
+      }
+    }
+    for (mvs = pos->atk[to]; mvs; mvs >>= 8) {
+      if (mvs & 0xFF) {
+        sqr = ((mvs & 0xFF) - 1);
+        if (sqr != from) {
+          const int c = COLOR(pos->board[sqr]->type);
+          sqrs[c][count[c]++] = sqr;
+        }
+      }
+    }
+    for (int c = White; c <= Black; ++c) {
+      sqr = pos->king[c]->sqr;
+      if ((sqr != from) && (Distance(sqr, to) == 1)) {
+        sqrs[c][count[c]++] = sqr;
+      }
+    }
+
+    int gain[32];
+    int depth = 0;
+    int side  = color;
+    int value = SeeValue(pos->board[from]->type);
+    sqr = from;
+    gain[0] = ValueOf(move.Cap());
+    while (true) {
+      assert((depth + 1) < 32);
+      depth++;
+      gain[depth] = (value - gain[depth - 1]);
+      if (std::max<int>(-gain[depth - 1], gain[depth]) < 0) {
+        break;
       }
-      else {
-        GetSliderMoves(color, RookMove, _bishopRook[from + 8], from);
+
+      // uncover the slider behind the piece that just captured
+      if ((pos->board[sqr]->type & ~1) != Knight) {
+        const int dir = Direction(sqr, to);
+        assert(IS_DIR(dir));
+        const int xray = ((pos->atk[sqr] >> DirShift(dir)) & 0xFF);
+        if (xray) {
+          const int c = COLOR(pos->board[xray - 1]->type);
+          assert(count[c] < 16);
+          sqrs[c][count[c]++] = (xray - 1);
+        }
       }
-    }
 
-    for (int i = _pcount[color|Queen]; i--; ) {
-      assert(i >= 0);
-      from = _piece[(color ? BlackQueenOffset : QueenOffset) + i].sqr;
-      if (qsearch) {
-        GetSliderCaptures(color, QueenMove, _atk[from + 8], from);
+      // least valuable attacker of the other side captures next
+      side = !side;
+      if (!count[side]) {
+        break;
       }
-      else {
-        GetSliderMoves(color, QueenMove, _queenKing[from], from);
+      int best = 0;
+      value = SeeValue(pos->board[sqrs[side][0]]->type);
+      for (int i = 1; i < count[side]; ++i) {
+        const int val = SeeValue(pos->board[sqrs[side][i]]->type);
+        if (val < value) {
+          value = val;
+          best = i;
+        }
       }
+      sqr = sqrs[side][best];
+      sqrs[side][best] = sqrs[side][--count[side]];
     }
 
-    if (qsearch && _pcount[color] && !depth) {
-      GetSliderChecks<color>();
+    while (--depth) {
+      gain[depth - 1] = -std::max<int>(-gain[depth - 1], gain[depth]);
     }
-
-    GetKingMoves<color, qsearch>(depth);
-    assert(!DuplicateMoveCount());
+    return gain[0];
   }
 
   //---------------------------------------------------------------------------
-  inline void ScootMoveToFront(int idx) {
-    assert((idx >= 0) & (idx < moveCount));
-    while (idx-- > 0) {
-      moves[idx].SwapWith(moves[idx + 1]);
+  // captures that lose material according to StaticExchange()
+  //---------------------------------------------------------------------------
+  template<Color color>
+  bool BadCapture(const Move& move) {
+    assert(move.Cap());
+    const int pc = pos->board[move.From()]->type;
+    if (move.Promo() || ((pc & ~1) == King) ||
+        (ValueOf(move.Cap()) >= ValueOf(pc)))
+    {
+      return false;
     }
+    return (StaticExchange<color>(move) < 0);
   }
 
   //---------------------------------------------------------------------------
-  inline Move* GetNextMove() {
-    assert(moveIndex >= 0);
-    assert((moveCount >= 0) & (moveCount < MaxMoves));
-
-    if (moveIndex >= moveCount) {
-      return NULL;
+  // killers come from sibling positions, so only play one if GetQuiets()
+  // would have generated it here
+  //---------------------------------------------------------------------------
+  template<Color color>
+  bool KillerOK(const Move& move) {
+    assert(!checks);
+    if (!move) {
+      return false;
     }
-
-    Move* best = (moves + moveIndex);
-    for (int i = (moveIndex + 1); i < moveCount; ++i) {
-      if (moves[i].GetScore() > best->GetScore()) {
-        best = (moves + i);
-      }
+    assert(!move.IsCapOrPromo());
+    const int from = move.From();
+    const int to   = move.To();
+    if (pos->board[to] != pos->empty) {
+      return false;
     }
-    if (best != (moves + moveIndex)) {
-      moves[moveIndex].SwapWith(*best);
+    switch (move.Type()) {
+    case PawnMove:
+      if (pos->board[from]->type != (color|Pawn)) {
+        return false;
+      }
+      break;
+    case PawnLung:
+      if ((pos->board[from]->type != (color|Pawn)) ||
+          (pos->board[from + (color ? South : North)] != pos->empty))
+      {
+        return false;
+      }
+      break;
+    case KnightMove:
+      return ((pos->board[from]->type == (color|Knight)) &&
+              !GetPinDir(color, from));
+    case BishopMove:
+    case RookMove:
+    case QueenMove:
+      if (pos->board[from]->type != (color|move.Type())) {
+        return false;
+      }
+      for (int dir = Direction(from, to), sqr = (from + dir); sqr != to;
+           sqr += dir)
+      {
+        if (pos->board[sqr] != pos->empty) {
+          return false;
+        }
+      }
+      break;
+    case KingMove:
+      return ((pos->board[from] == pos->king[color]) &&
+              !pos->AttackedBy<!color>(to));
+    case CastleShort:
+      return ((state & (color ? BlackShort : WhiteShort)) &&
+              (pos->board[color ? F8 : F1] == pos->empty) &&
+              !pos->AttackedBy<!color>(color ? F8 : F1) &&
+              !pos->AttackedBy<!color>(color ? G8 : G1));
+    case CastleLong:
+      return ((state & (color ? BlackLong : WhiteLong)) &&
+              (pos->board[color ? D8 : D1] == pos->empty) &&
+              (pos->board[color ? B8 : B1] == pos->empty) &&
+              !pos->AttackedBy<!color>(color ? D8 : D1) &&
+              !pos->AttackedBy<!color>(color ? C8 : C1));
+    default:
+      return false;
     }
+    const int pinDir = GetPinDir(color, from);
+    return (!pinDir || (abs(Direction(from, to)) == pinDir));
+  }
 
-    return (moves + moveIndex++);
+  //---------------------------------------------------------------------------
+  // Search() move picker, generates captures and promotions after the hash
+  // move, then tries the killers, and only generates the quiet moves if
+  // none of those fail high, losing captures are kept at the front of the
+  // list and searched last
+  //---------------------------------------------------------------------------
+  template<Color color>
+  Move* GetNextStagedMove() {
+    Move* move;
+    switch (stage) {
+    case HashMoveStage:
+      assert(!checks);
+      assert(!badCount);
+      moveCount = moveIndex = 0;
+      GetCaptures<color, false>(0);
+      SortMoves(0);
+      stage = CaptureStage;
+      // fall through
+    case CaptureStage:
+      while ((move = GetNextMove())) {
+        if (!move->Cap() || !BadCapture<color>(*move)) {
+          return move;
+        }
+        pos->stats.seeDefers++;
+        moves[badCount++].SwapWith(*move);
+      }
+      stage = Killer1Stage;
+      // fall through
+    case Killer1Stage:
+    case Killer2Stage:
+      while (stage <= Killer2Stage) {
+        const Move& killerMove = killer[stage++ - Killer1Stage];
+        if (KillerOK<color>(killerMove)) {
+          assert(ValidateMove<color>(killerMove) == 0);
+          assert(moveCount < MaxMoves);
+          moves[moveCount] = killerMove;
+          moveIndex = ++moveCount;
+          return (moves + moveIndex - 1);
+        }
+      }
+      // fall through
+    case QuietStage:
+      {
+        // leave out the killers, they've already been searched
+        const int first = moveCount;
+        GetQuiets<color, false>();
+        for (int i = first; i < moveCount; ) {
+          if (IsKiller(moves[i])) {
+            assert(KillerOK<color>(moves[i]));
+            moves[i] = moves[--moveCount];
+          }
+          else {
+            i++;
+          }
+        }
+        SortMoves(first);
+      }
+      stage = RemainingStage;
+      // fall through
+    case RemainingStage:
+      if ((move = GetNextMove())) {
+        return move;
+      }
+      stage = BadCaptureStage;
+      // fall through
+    case BadCaptureStage:
+      return (badIndex < badCount) ? (moves + badIndex++) : NULL;
+    }
+    assert(false);
+    return NULL;
   }
 
   //---------------------------------------------------------------------------
@@ -2368,8 +3088,8 @@ struct Node
     const int cap   = move.Cap();
     const int promo = move.Promo();
 
-    Piece* moved = _board[from];
-    VASSERT(moved && (moved != _EMPTY));
+    Piece* moved = pos->board[from];
+    VASSERT(moved && (moved != pos->empty));
     VASSERT(moved->type);
     VASSERT(moved->sqr == from);
 
@@ -2379,7 +3099,7 @@ struct Node
     switch (move.Type()) {
     case PawnMove:
       VASSERT(pc == (color|Pawn));
-      VASSERT(_board[to] == _EMPTY);
+      VASSERT(pos->board[to] == pos->empty);
       VASSERT(!cap);
       VASSERT((YC(from) != 0) & (YC(from) != 7));
       VASSERT(Distance(from, to) == 1);
@@ -2398,8 +3118,8 @@ struct Node
       VASSERT(YC(from) == (color ? 6 : 1));
       VASSERT(Distance(from, to) == 2);
       VASSERT(Direction(from, to) == (color ? South : North));
-      VASSERT(_board[to] == _EMPTY);
-      VASSERT(_board[to + (color ? North : South)] == _EMPTY);
+      VASSERT(pos->board[to] == pos->empty);
+      VASSERT(pos->board[to + (color ? North : South)] == pos->empty);
       VASSERT(!cap);
       VASSERT(!promo);
       break;
@@ -2411,25 +3131,25 @@ struct Node
         VASSERT(COLOR(promo) == color);
         VASSERT(YC(to) == (color ? 0 : 7));
         VASSERT(cap);
-        VASSERT(_board[to] != _EMPTY);
-        VASSERT(cap == _board[to]->type);
-        VASSERT(_board[to]->sqr == to);
+        VASSERT(pos->board[to] != pos->empty);
+        VASSERT(cap == pos->board[to]->type);
+        VASSERT(pos->board[to]->sqr == to);
       }
       else {
         VASSERT((YC(from) != 0) & (YC(from) != 7));
         VASSERT(YC(to) != (color ? 0 : 7));
         if (cap) {
-          VASSERT(_board[to] != _EMPTY);
-          VASSERT(cap == _board[to]->type);
-          VASSERT(_board[to]->sqr == to);
+          VASSERT(pos->board[to] != pos->empty);
+          VASSERT(cap == pos->board[to]->type);
+          VASSERT(pos->board[to]->sqr == to);
         }
         else {
-          VASSERT(_board[to] == _EMPTY);
+          VASSERT(pos->board[to] == pos->empty);
           VASSERT((ep != None) && (to == ep));
           const int sqr = (ep + (color ? North : South));
           VASSERT(IS_SQUARE(sqr));
-          VASSERT(_board[sqr] != _EMPTY);
-          VASSERT(_board[sqr]->type == ((!color)|Pawn));
+          VASSERT(pos->board[sqr] != pos->empty);
+          VASSERT(pos->board[sqr]->type == ((!color)|Pawn));
         }
       }
       break;
@@ -2439,7 +3159,8 @@ struct Node
     case QueenMove:
     case KingMove:
       VASSERT(pc == (color|move.Type()));
-      VASSERT(cap ? (_board[to]->type == cap) : (_board[to] == _EMPTY));
+      VASSERT(cap ? (pos->board[to]->type == cap)
+                  : (pos->board[to] == pos->empty));
       VASSERT(!promo);
       switch (pc) {
       case (color|Knight):
@@ -2468,9 +3189,10 @@ struct Node
         }
         break;
       case (color|King):
-        VASSERT(_board[from] == _KING[color]);
+        VASSERT(pos->board[from] == pos->king[color]);
         VASSERT(Distance(from, to) == 1);
-        VASSERT(!AttackedBy<!color>(to));
+        VASSERT(!pos->AttackedBy<!color>(to));
+        // fall through
       case (color|Queen):
         switch (Direction(from, to)) {
         case SouthWest: case South: case SouthEast: case West:
@@ -2483,37 +3205,43 @@ struct Node
       default:
         VASSERT(false);
       }
+      if ((pc != (color|Knight)) & (pc != (color|King))) {
+        const int dir = Direction(from, to);
+        for (int sqr = (from + dir); sqr != to; sqr += dir) {
+          VASSERT(IS_SQUARE(sqr) && (pos->board[sqr] == pos->empty));
+        }
+      }
       break;
     case CastleShort:
       VASSERT(state & (color ? BlackShort : WhiteShort));
-      VASSERT(moved == (color ? _KING[Black] : _KING[White]));
+      VASSERT(moved == (color ? pos->king[Black] : pos->king[White]));
       VASSERT(from == (color ? E8 : E1));
       VASSERT(to == (color ? G8 : G1));
       VASSERT(!cap);
       VASSERT(!promo);
-      VASSERT(_board[color ? H8 : H1] != _EMPTY);
-      VASSERT(_board[color ? H8 : H1]->type == (color|Rook));
-      VASSERT(_board[color ? F8 : F1] == _EMPTY);
-      VASSERT(_board[color ? G8 : G1] == _EMPTY);
-      VASSERT(!AttackedBy<!color>(color ? E8 : E1));
-      VASSERT(!AttackedBy<!color>(color ? F8 : F1));
-      VASSERT(!AttackedBy<!color>(color ? G8 : G1));
+      VASSERT(pos->board[color ? H8 : H1] != pos->empty);
+      VASSERT(pos->board[color ? H8 : H1]->type == (color|Rook));
+      VASSERT(pos->board[color ? F8 : F1] == pos->empty);
+      VASSERT(pos->board[color ? G8 : G1] == pos->empty);
+      VASSERT(!pos->AttackedBy<!color>(color ? E8 : E1));
+      VASSERT(!pos->AttackedBy<!color>(color ? F8 : F1));
+      VASSERT(!pos->AttackedBy<!color>(color ? G8 : G1));
       break;
     case CastleLong:
       VASSERT(state & (color ? BlackLong : WhiteLong));
-      VASSERT(moved == (color ? _KING[Black] : _KING[White]));
+      VASSERT(moved == (color ? pos->king[Black] : pos->king[White]));
       VASSERT(from == (color ? E8 : E1));
       VASSERT(to == (color ? C8 : C1));
       VASSERT(!cap);
       VASSERT(!promo);
-      VASSERT(_board[color ? A8 : A1] != _EMPTY);
-      VASSERT(_board[color ? A8 : A1]->type == (color|Rook));
-      VASSERT(_board[color ? B8 : B1] == _EMPTY);
-      VASSERT(_board[color ? C8 : C1] == _EMPTY);
-      VASSERT(_board[color ? D8 : D1] == _EMPTY);
-      VASSERT(!AttackedBy<!color>(color ? C8 : C1));
-      VASSERT(!AttackedBy<!color>(color ? D8 : D1));
-      VASSERT(!AttackedBy<!color>(color ? E8 : E1));
+      VASSERT(pos->board[color ? A8 : A1] != pos->empty);
+      VASSERT(pos->board[color ? A8 : A1]->type == (color|Rook));
+      VASSERT(pos->board[color ? B8 : B1] == pos->empty);
+      VASSERT(pos->board[color ? C8 : C1] == pos->empty);
+      VASSERT(pos->board[color ? D8 : D1] == pos->empty);
+      VASSERT(!pos->AttackedBy<!color>(color ? C8 : C1));
+      VASSERT(!pos->AttackedBy<!color>(color ? D8 : D1));
+      VASSERT(!pos->AttackedBy<!color>(color ? E8 : E1));
       break;
     default:
       VASSERT(false);
@@ -2521,23 +3249,97 @@ struct Node
     return 0;
   }
 
+  //---------------------------------------------------------------------------
+  // the position and pawn keys Exec() will give the child, from the move alone
   //---------------------------------------------------------------------------
   template<Color color>
+  uint64_t ChildKey(const Move& move, uint64_t& childPawnKey) const {
+    const int from  = move.From();
+    const int to    = move.To();
+    const int cap   = move.Cap();
+    const int promo = move.Promo();
+    const int pc    = pos->board[from]->type;
+
+    uint64_t pawns  = pawnKey;
+    uint64_t pieces = pieceKey;
+    int childState  = ((state ^ 1) & _TOUCH[from] & _TOUCH[to]);
+    int childEp     = None;
+
+    switch (move.Type()) {
+    case CastleShort:
+      childState = ((state ^ 1) & ~(color ? BlackCastle : WhiteCastle));
+      pieces ^= (_HASH[color|Rook][color ? F8 : F1] ^
+                 _HASH[color|Rook][color ? H8 : H1] ^
+                 _HASH[color|King][color ? E8 : E1] ^
+                 _HASH[color|King][color ? G8 : G1]);
+      break;
+    case CastleLong:
+      childState = ((state ^ 1) & ~(color ? BlackCastle : WhiteCastle));
+      pieces ^= (_HASH[color|Rook][color ? A8 : A1] ^
+                 _HASH[color|Rook][color ? D8 : D1] ^
+                 _HASH[color|King][color ? C8 : C1] ^
+                 _HASH[color|King][color ? E8 : E1]);
+      break;
+    case PawnLung:
+      childEp = (to + (color ? North : South));
+      // fall through
+    case PawnMove:
+    case PawnCap:
+      pawns ^= _HASH[pc][from];
+      if (promo) {
+        pieces ^= _HASH[promo][to];
+      }
+      else {
+        pawns ^= _HASH[pc][to];
+        if ((move.Type() == PawnCap) & !cap) {
+          pawns ^= _HASH[(!color)|Pawn][ep + (color ? North : South)];
+        }
+      }
+      break;
+    default:
+      pieces ^= (_HASH[pc][from] ^ _HASH[pc][to]);
+    }
+
+    if (cap >= Knight) {
+      pieces ^= _HASH[cap][to];
+    }
+    else if (cap) {
+      pawns ^= _HASH[cap][to];
+    }
+
+    childPawnKey = pawns;
+    return (pawns ^ pieces ^ _HASH[0][childState & 0x1F] ^ _HASH[1][childEp]);
+  }
+
+  //---------------------------------------------------------------------------
+  template<Color color, bool prefetch>
   void Exec(const Move& move, Node& dest) const {
     assert(ValidateMove<color>(move) == 0);
-    assert(!checks == !AttackedBy<!color>(_KING[color]->sqr));
+    assert(!checks == !pos->AttackedBy<!color>(pos->king[color]->sqr));
 
-    _stats.execs++;
+    // get the child's hash table entries on their way into cache while the
+    // board is updated, perft doesn't probe them so it passes prefetch=false
+    uint64_t childPawnKey = 0;
+    const uint64_t childKey = (prefetch ? ChildKey<color>(move, childPawnKey)
+                                        : 0);
+    if (prefetch) {
+      ctx->tt.Prefetch(childKey ^ ctx->tt.Salt());
+      if (childPawnKey != pawnKey) {
+        pos->pawnTT.Prefetch(childPawnKey);
+      }
+    }
 
-    assert((_seenIndex >= 0) & (_seenIndex < MaxPlies));
-    _seen[_seenIndex++] = positionKey;
-    _seenIndex -= (MaxPlies * (_seenIndex == MaxPlies));
-    _seenFilter[positionKey & SeenFilterMask]++;
-    assert(_seenFilter[positionKey & SeenFilterMask]);
+    pos->stats.execs++;
+
+    assert((pos->seenIndex >= 0) & (pos->seenIndex < MaxPlies));
+    pos->seen[pos->seenIndex++] = positionKey;
+    pos->seenIndex -= (MaxPlies * (pos->seenIndex == MaxPlies));
+    pos->seenFilter[positionKey & SeenFilterMask]++;
+    assert(pos->seenFilter[positionKey & SeenFilterMask]);
 #ifndef NDEBUG
-    assert(_seenStackTop >= _seenStack);
-    assert((_seenStackTop - _seenStack) < 8000);
-    *_seenStackTop++ = positionKey;
+    assert(pos->seenStackTop >= pos->seenStack);
+    assert((pos->seenStackTop - pos->seenStack) < 8000);
+    *pos->seenStackTop++ = positionKey;
 #endif
 
     const int from  = move.From();
@@ -2545,29 +3347,30 @@ struct Node
     const int cap   = move.Cap();
     const int promo = move.Promo();
 
-    Piece* moved = _board[from];
+    Piece* moved = pos->board[from];
     const int pc = moved->type;
 
     if (IS_SLIDER(pc)) {
-      ClearAttacksFrom(pc, from);
+      pos->ClearAttacksFrom(pc, from);
     }
     if (IS_SLIDER(cap)) {
-      ClearAttacksFrom(cap, to);
+      pos->ClearAttacksFrom(cap, to);
     }
 
     switch (move.Type()) {
     case PawnMove:
       if (promo) {
-        RemovePiece((color|Pawn), from);
-        AddPiece(promo, to);
-        _material[color] += (ValueOf(promo) - PawnValue);
+        pos->RemovePiece((color|Pawn), from);
+        pos->AddPiece(promo, to);
+        pos->material[color] += (ValueOf(promo) - PawnValue);
         dest.pawnKey = (pawnKey ^ _HASH[pc][from]);
         dest.pieceKey = (pieceKey ^ _HASH[promo][to]);
       }
       else {
-        _board[from] = _EMPTY;
-        _board[to] = moved;
+        pos->board[from] = pos->empty;
+        pos->board[to] = moved;
         moved->sqr = to;
+        pos->MovePieceBits(pc, from, to);
         dest.pawnKey = (pawnKey ^ _HASH[pc][from] ^ _HASH[pc][to]);
         dest.pieceKey = pieceKey;
       }
@@ -2575,93 +3378,97 @@ struct Node
       dest.ep = None;
       dest.rcount = 0;
       dest.mcount = (mcount + 1);
-      UpdateKingDirs<White>(from, to);
-      UpdateKingDirs<Black>(from, to);
+      pos->UpdateKingDirs<White>(from, to);
+      pos->UpdateKingDirs<Black>(from, to);
       break;
     case PawnLung:
-      _board[from] = _EMPTY;
-      _board[to] = moved;
+      pos->board[from] = pos->empty;
+      pos->board[to] = moved;
       moved->sqr = to;
+      pos->MovePieceBits(pc, from, to);
       dest.state = ((state ^ 1) & _TOUCH[from] & _TOUCH[to]);
       dest.ep = (to + (color ? North : South));
       dest.rcount = 0;
       dest.mcount = (mcount + 1);
       dest.pawnKey = (pawnKey ^ _HASH[pc][from] ^ _HASH[pc][to]);
       dest.pieceKey = pieceKey;
-      UpdateKingDirs<White>(from, to);
-      UpdateKingDirs<Black>(from, to);
+      pos->UpdateKingDirs<White>(from, to);
+      pos->UpdateKingDirs<Black>(from, to);
       break;
     case PawnCap:
       if (promo) {
-        RemovePiece((color|Pawn), from);
-        RemovePiece(cap, to);
-        AddPiece(promo, to);
-        _material[color] += (ValueOf(promo) - PawnValue);
-        _material[!color] -= ValueOf(cap);
+        pos->RemovePiece((color|Pawn), from);
+        pos->RemovePiece(cap, to);
+        pos->AddPiece(promo, to);
+        pos->material[color] += (ValueOf(promo) - PawnValue);
+        pos->material[!color] -= ValueOf(cap);
         dest.pawnKey = (pawnKey ^ _HASH[pc][from]);
         dest.pieceKey = (pieceKey ^ _HASH[promo][to] ^ _HASH[cap][to]);
       }
       else {
-        _board[from] = _EMPTY;
+        pos->board[from] = pos->empty;
         if (cap >= Knight) {
-          RemovePiece(cap, to);
-          _board[to] = moved;
+          pos->RemovePiece(cap, to);
+          pos->board[to] = moved;
           moved->sqr = to;
-          _material[!color] -= ValueOf(cap);
+          pos->MovePieceBits(pc, from, to);
+          pos->material[!color] -= ValueOf(cap);
           dest.pawnKey = (pawnKey ^ _HASH[pc][from] ^ _HASH[pc][to]);
           dest.pieceKey = (pieceKey ^ _HASH[cap][to]);
         }
         else if (cap) {
-          RemovePiece(((!color)|Pawn), to);
-          _board[to] = moved;
+          pos->RemovePiece(((!color)|Pawn), to);
+          pos->board[to] = moved;
           moved->sqr = to;
-          _material[!color] -= ValueOf(cap);
+          pos->MovePieceBits(pc, from, to);
+          pos->material[!color] -= ValueOf(cap);
           dest.pawnKey = (pawnKey ^ _HASH[pc][from] ^ _HASH[pc][to] ^
                           _HASH[cap][to]);
           dest.pieceKey = pieceKey;
         }
         else {
           const int sqr = (ep + (color ? North : South));
-          RemovePiece(((!color)|Pawn), sqr);
-          _board[to] = moved;
+          pos->RemovePiece(((!color)|Pawn), sqr);
+          pos->board[to] = moved;
           moved->sqr = to;
-          _material[!color] -= PawnValue;
-          if (_atk[sqr]) {
-            ExtendAttacks(sqr);
+          pos->MovePieceBits(pc, from, to);
+          pos->material[!color] -= PawnValue;
+          if (pos->atk[sqr]) {
+            pos->ExtendAttacks(sqr);
           }
           dest.pawnKey = (pawnKey ^ _HASH[pc][from] ^ _HASH[pc][to] ^
                           _HASH[(!color)|Pawn][sqr]);
           dest.pieceKey = pieceKey;
-          UpdateKingDirs<White>(sqr, to);
-          UpdateKingDirs<Black>(sqr, to);
+          pos->UpdateKingDirs<White>(sqr, to);
+          pos->UpdateKingDirs<Black>(sqr, to);
         }
       }
       dest.state = ((state ^ 1) & _TOUCH[from] & _TOUCH[to]);
       dest.ep = None;
       dest.rcount = 0;
       dest.mcount = (mcount + 1);
-      UpdateKingDirs<White>(from, to);
-      UpdateKingDirs<Black>(from, to);
+      pos->UpdateKingDirs<White>(from, to);
+      pos->UpdateKingDirs<Black>(from, to);
       break;
     case KnightMove:
     case BishopMove:
     case RookMove:
     case QueenMove:
-      _board[from] = _EMPTY;
+      pos->board[from] = pos->empty;
       dest.state = ((state ^ 1) & _TOUCH[from] & _TOUCH[to]);
       dest.ep = None;
       dest.rcount = (cap ? 0 : (rcount + 1));
       dest.mcount = (mcount + 1);
       if (cap >= Knight) {
-        RemovePiece(cap, to);
-        _material[!color] -= ValueOf(cap);
+        pos->RemovePiece(cap, to);
+        pos->material[!color] -= ValueOf(cap);
         dest.pawnKey = pawnKey;
         dest.pieceKey = (pieceKey ^ _HASH[pc][from] ^ _HASH[pc][to] ^
                          _HASH[cap][to]);
       }
       else if (cap) {
-        RemovePiece(((!color)|Pawn), to);
-        _material[!color] -= PawnValue;
+        pos->RemovePiece(((!color)|Pawn), to);
+        pos->material[!color] -= PawnValue;
         dest.pawnKey = (pawnKey ^ _HASH[cap][to]);
         dest.pieceKey = (pieceKey ^ _HASH[pc][from] ^ _HASH[pc][to]);
       }
@@ -2669,28 +3476,29 @@ struct Node
         dest.pawnKey = pawnKey;
         dest.pieceKey = (pieceKey ^ _HASH[pc][from] ^ _HASH[pc][to]);
       }
-      _board[to] = moved;
+      pos->board[to] = moved;
       moved->sqr = to;
-      UpdateKingDirs<White>(from, to);
-      UpdateKingDirs<Black>(from, to);
+      pos->MovePieceBits(pc, from, to);
+      pos->UpdateKingDirs<White>(from, to);
+      pos->UpdateKingDirs<Black>(from, to);
       break;
     case KingMove:
-      ClearKingDirs<color>(from);
-      _board[from] = _EMPTY;
+      pos->ClearKingDirs<color>(from);
+      pos->board[from] = pos->empty;
       dest.state = ((state ^ 1) & _TOUCH[from] & _TOUCH[to]);
       dest.ep = None;
       dest.rcount = (cap ? 0 : (rcount + 1));
       dest.mcount = (mcount + 1);
       if (cap >= Knight) {
-        RemovePiece(cap, to);
-        _material[!color] -= ValueOf(cap);
+        pos->RemovePiece(cap, to);
+        pos->material[!color] -= ValueOf(cap);
         dest.pawnKey = pawnKey;
         dest.pieceKey = (pieceKey ^ _HASH[pc][from] ^ _HASH[pc][to] ^
                          _HASH[cap][to]);
       }
       else if (cap) {
-        RemovePiece(((!color)|Pawn), to);
-        _material[!color] -= PawnValue;
+        pos->RemovePiece(((!color)|Pawn), to);
+        pos->material[!color] -= PawnValue;
         dest.pawnKey = (pawnKey ^ _HASH[cap][to]);
         dest.pieceKey = (pieceKey ^ _HASH[pc][from] ^ _HASH[pc][to]);
       }
@@ -2698,26 +3506,29 @@ struct Node
         dest.pawnKey = pawnKey;
         dest.pieceKey = (pieceKey ^ _HASH[pc][from] ^ _HASH[pc][to]);
       }
-      _board[to] = moved;
+      pos->board[to] = moved;
       moved->sqr = to;
-      SetKingDirs<color>(to);
-      UpdateKingDirs<!color>(from, to);
+      pos->MovePieceBits(pc, from, to);
+      pos->SetKingDirs<color>(to);
+      pos->UpdateKingDirs<!color>(from, to);
       break;
     case CastleShort:
-      ClearKingDirs<color>(from);
-      ClearAttacksFrom((color|Rook), (color ? H8 : H1));
-      _board[color ? E8 : E1] = _EMPTY;
-      _board[color ? G8 : G1] = moved;
-      _board[color ? F8 : F1] = _board[color ? H8 : H1];
-      _board[color ? H8 : H1] = _EMPTY;
+      pos->ClearKingDirs<color>(from);
+      pos->ClearAttacksFrom((color|Rook), (color ? H8 : H1));
+      pos->board[color ? E8 : E1] = pos->empty;
+      pos->board[color ? G8 : G1] = moved;
+      pos->board[color ? F8 : F1] = pos->board[color ? H8 : H1];
+      pos->board[color ? H8 : H1] = pos->empty;
       moved->sqr = to;
-      _board[color ? F8 : F1]->sqr = (color ? F8 : F1);
-      SetKingDirs<color>(to);
-      if (_kingDir[color ? (E8 + 8) : E1] == West) {
-        assert(!_kingDir[color ? (F8 + 8) : F1]);
-        _kingDir[color ? (F8 + 8) : F1] = West;
-      }
-      AddAttacksFrom((color|Rook), (color ? F8 : F1));
+      pos->MovePieceBits(pc, from, to);
+      pos->board[color ? F8 : F1]->sqr = (color ? F8 : F1);
+      pos->MovePieceBits((color|Rook), (color ? H8 : H1), (color ? F8 : F1));
+      pos->SetKingDirs<color>(to);
+      if (pos->kingDir[color ? (E8 + 8) : E1] == West) {
+        assert(!pos->kingDir[color ? (F8 + 8) : F1]);
+        pos->kingDir[color ? (F8 + 8) : F1] = West;
+      }
+      pos->AddAttacksFrom((color|Rook), (color ? F8 : F1));
       dest.state = ((state ^ 1) & ~(color ? BlackCastle : WhiteCastle));
       dest.ep = None;
       dest.rcount = (rcount + 1);
@@ -2730,20 +3541,22 @@ struct Node
                        _HASH[color|King][color ? G8 : G1]);
       break;
     case CastleLong:
-      ClearKingDirs<color>(from);
-      ClearAttacksFrom((color|Rook), (color ? A8 : A1));
-      _board[color ? D8 : D1] = _board[color ? A8 : A1];
-      _board[color ? A8 : A1] = _EMPTY;
-      _board[color ? C8 : C1] = moved;
-      _board[color ? E8 : E1] = _EMPTY;
+      pos->ClearKingDirs<color>(from);
+      pos->ClearAttacksFrom((color|Rook), (color ? A8 : A1));
+      pos->board[color ? D8 : D1] = pos->board[color ? A8 : A1];
+      pos->board[color ? A8 : A1] = pos->empty;
+      pos->board[color ? C8 : C1] = moved;
+      pos->board[color ? E8 : E1] = pos->empty;
       moved->sqr = to;
-      _board[color ? D8 : D1]->sqr = (color ? D8 : D1);
-      SetKingDirs<color>(to);
-      if (_kingDir[color ? (E8 + 8) : E1] == East) {
-        assert(!_kingDir[color ? (D8 + 8) : D1]);
-        _kingDir[color ? (D8 + 8) : D1] = East;
-      }
-      AddAttacksFrom((color|Rook), (color ? D8 : D1));
+      pos->MovePieceBits(pc, from, to);
+      pos->board[color ? D8 : D1]->sqr = (color ? D8 : D1);
+      pos->MovePieceBits((color|Rook), (color ? A8 : A1), (color ? D8 : D1));
+      pos->SetKingDirs<color>(to);
+      if (pos->kingDir[color ? (E8 + 8) : E1] == East) {
+        assert(!pos->kingDir[color ? (D8 + 8) : D1]);
+        pos->kingDir[color ? (D8 + 8) : D1] = East;
+      }
+      pos->AddAttacksFrom((color|Rook), (color ? D8 : D1));
       dest.state = ((state ^ 1) & ~(color ? BlackCastle : WhiteCastle));
       dest.ep = None;
       dest.rcount = (rcount + 1);
@@ -2761,25 +3574,27 @@ struct Node
                         dest.pieceKey ^
                         _HASH[0][dest.state & 0x1F] ^
                         _HASH[1][dest.ep]);
+    assert(!prefetch || (dest.positionKey == childKey));
+    assert(!prefetch || (dest.pawnKey == childPawnKey));
 
     dest.lastMove = move;
-    dest.standPat = (_material[!color] - _material[color]);
+    dest.standPat = (pos->material[!color] - pos->material[color]);
     assert(standPat > (ply - Infinity));
 
-    if (!cap && _atk[to]) {
-      TruncateAttacks(to, from);
+    if (!cap && pos->atk[to]) {
+      pos->TruncateAttacks(to, from);
     }
-    if (_atk[from]) {
-      ExtendAttacks(from);
+    if (pos->atk[from]) {
+      pos->ExtendAttacks(from);
     }
-    if (_board[to] >= _FIRST_SLIDER) {
-      assert(IS_SLIDER(_board[to]->type));
-      assert(_board[to]->sqr == to);
-      AddAttacksFrom(_board[to]->type, to);
+    if (pos->board[to] >= pos->firstSlider) {
+      assert(IS_SLIDER(pos->board[to]->type));
+      assert(pos->board[to]->sqr == to);
+      pos->AddAttacksFrom(pos->board[to]->type, to);
     }
 
 #if 0
-    assert(VerifyAttacks(true));
+    assert(pos->VerifyAttacks(true));
 #endif
 
     dest.FindCheckers<!color>();
@@ -2792,20 +3607,20 @@ struct Node
     assert(move.IsValid());
     assert(IS_SQUARE(move.From()));
     assert(IS_SQUARE(move.To()));
-    assert(_board[move.From()] == _EMPTY);
+    assert(pos->board[move.From()] == pos->empty);
     assert(!move.Cap() || IS_CAP(move.Cap()));
     assert(!move.Cap() || (COLOR(move.Cap()) != color));
     assert(!move.Promo() || IS_PROMO(move.Promo()));
     assert(!move.Promo() || (COLOR(move.Promo()) == color));
 
-    _seenIndex += ((MaxPlies * !_seenIndex) - 1);
-    assert((_seenIndex >= 0) & (_seenIndex < MaxPlies));
-    assert(_seenFilter[positionKey & SeenFilterMask]);
-    _seenFilter[positionKey & SeenFilterMask]--;
+    pos->seenIndex += ((MaxPlies * !pos->seenIndex) - 1);
+    assert((pos->seenIndex >= 0) & (pos->seenIndex < MaxPlies));
+    assert(pos->seenFilter[positionKey & SeenFilterMask]);
+    pos->seenFilter[positionKey & SeenFilterMask]--;
 
 #ifndef NDEBUG
-    assert(_seenStackTop > _seenStack);
-    _seenStackTop--;
+    assert(pos->seenStackTop > pos->seenStack);
+    pos->seenStackTop--;
 #endif
 
     const int from  = move.From();
@@ -2813,8 +3628,8 @@ struct Node
     const int cap   = move.Cap();
     const int promo = move.Promo();
 
-    Piece* moved = _board[to];
-    assert(moved && (moved != _EMPTY));
+    Piece* moved = pos->board[to];
+    assert(moved && (moved != pos->empty));
     assert(moved->type);
     assert(COLOR(moved->type) == color);
     assert(moved->sqr == to);
@@ -2825,182 +3640,190 @@ struct Node
         assert(moved->type == promo);
         assert(cap);
         if (promo >= Bishop) {
-          ClearAttacksFrom(promo, to);
+          pos->ClearAttacksFrom(promo, to);
         }
-        RemovePiece(promo, to);
-        AddPiece(cap, to);
-        AddPiece((color|Pawn), from);
-        _material[color] += (PawnValue - ValueOf(promo));
-        _material[!color] += ValueOf(cap);
-        if (_atk[from]) {
-          TruncateAttacks(from, to);
+        pos->RemovePiece(promo, to);
+        pos->AddPiece(cap, to);
+        pos->AddPiece((color|Pawn), from);
+        pos->material[color] += (PawnValue - ValueOf(promo));
+        pos->material[!color] += ValueOf(cap);
+        if (pos->atk[from]) {
+          pos->TruncateAttacks(from, to);
         }
         if (cap >= Bishop) {
-          AddAttacksFrom(cap, to);
+          pos->AddAttacksFrom(cap, to);
         }
       }
       else if (cap) {
-        _board[from] = moved;
+        pos->board[from] = moved;
         moved->sqr = from;
-        AddPiece(cap, to);
-        _material[!color] += ValueOf(cap);
-        if (_atk[from]) {
-          TruncateAttacks(from, to);
+        pos->MovePieceBits(moved->type, to, from);
+        pos->AddPiece(cap, to);
+        pos->material[!color] += ValueOf(cap);
+        if (pos->atk[from]) {
+          pos->TruncateAttacks(from, to);
         }
         if (cap >= Bishop) {
-          AddAttacksFrom(cap, to);
+          pos->AddAttacksFrom(cap, to);
         }
       }
       else {
         assert(moved->type == (color|Pawn));
         assert((ep != None) && (to == ep));
         const int sqr = (ep + (color ? North : South));
-        assert(_board[sqr] == _EMPTY);
-        if (_atk[sqr]) {
-          TruncateAttacks(sqr, -1);
+        assert(pos->board[sqr] == pos->empty);
+        if (pos->atk[sqr]) {
+          pos->TruncateAttacks(sqr, -1);
         }
-        AddPiece(((!color)|Pawn), sqr);
-        _board[to] = _EMPTY;
-        _board[from] = moved;
+        pos->AddPiece(((!color)|Pawn), sqr);
+        pos->board[to] = pos->empty;
+        pos->board[from] = moved;
         moved->sqr = from;
-        _material[!color] += PawnValue;
-        if (_atk[from]) {
-          TruncateAttacks(from, to);
+        pos->MovePieceBits(moved->type, to, from);
+        pos->material[!color] += PawnValue;
+        if (pos->atk[from]) {
+          pos->TruncateAttacks(from, to);
         }
-        if (_atk[to]) {
-          ExtendAttacks(to);
+        if (pos->atk[to]) {
+          pos->ExtendAttacks(to);
         }
-        if (_atk[sqr]) {
-          TruncateAttacks(sqr, from);
+        if (pos->atk[sqr]) {
+          pos->TruncateAttacks(sqr, from);
         }
-        UpdateKingDirs<White>(to, sqr);
-        UpdateKingDirs<Black>(to, sqr);
+        pos->UpdateKingDirs<White>(to, sqr);
+        pos->UpdateKingDirs<Black>(to, sqr);
       }
-      UpdateKingDirs<White>(to, from);
-      UpdateKingDirs<Black>(to, from);
+      pos->UpdateKingDirs<White>(to, from);
+      pos->UpdateKingDirs<Black>(to, from);
       break;
     case KingMove:
-      ClearKingDirs<color>(to);
-      _board[from] = moved;
+      pos->ClearKingDirs<color>(to);
+      pos->board[from] = moved;
       moved->sqr = from;
+      pos->MovePieceBits(moved->type, to, from);
       if (cap) {
-        AddPiece(cap, to);
-        _material[!color] += ValueOf(cap);
+        pos->AddPiece(cap, to);
+        pos->material[!color] += ValueOf(cap);
       }
       else {
-        _board[to] = _EMPTY;
+        pos->board[to] = pos->empty;
       }
-      if (_atk[from]) {
-        TruncateAttacks(from, to);
+      if (pos->atk[from]) {
+        pos->TruncateAttacks(from, to);
       }
       if (cap >= Bishop) {
-        AddAttacksFrom(cap, to);
+        pos->AddAttacksFrom(cap, to);
       }
-      else if (!cap && _atk[to]) {
-        ExtendAttacks(to);
+      else if (!cap && pos->atk[to]) {
+        pos->ExtendAttacks(to);
       }
-      SetKingDirs<color>(from);
-      UpdateKingDirs<!color>(to, from);
+      pos->SetKingDirs<color>(from);
+      pos->UpdateKingDirs<!color>(to, from);
       break;
     case CastleShort:
-      assert(moved == (color ? _KING[Black] : _KING[White]));
+      assert(moved == (color ? pos->king[Black] : pos->king[White]));
       assert(from == (color ? E8 : E1));
       assert(to == (color ? G8 : G1));
       assert(!cap);
       assert(!promo);
-      assert(_board[color ? E8 : E1] == _EMPTY);
-      assert(_board[color ? H8 : H1] == _EMPTY);
-      assert(_board[color ? F8 : F1] != _EMPTY);
-      assert(_board[color ? G8 : G1] != _EMPTY);
-      assert(_board[color ? F8 : F1]->type == (color|Rook));
-      ClearKingDirs<color>(to);
-      ClearAttacksFrom((color|Rook), (color ? F8 : F1));
-      _board[color ? E8 : E1] = moved;
-      _board[color ? G8 : G1] = _EMPTY;
-      _board[color ? H8 : H1] = _board[color ? F8 : F1];
-      _board[color ? F8 : F1] = _EMPTY;
+      assert(pos->board[color ? E8 : E1] == pos->empty);
+      assert(pos->board[color ? H8 : H1] == pos->empty);
+      assert(pos->board[color ? F8 : F1] != pos->empty);
+      assert(pos->board[color ? G8 : G1] != pos->empty);
+      assert(pos->board[color ? F8 : F1]->type == (color|Rook));
+      pos->ClearKingDirs<color>(to);
+      pos->ClearAttacksFrom((color|Rook), (color ? F8 : F1));
+      pos->board[color ? E8 : E1] = moved;
+      pos->board[color ? G8 : G1] = pos->empty;
+      pos->board[color ? H8 : H1] = pos->board[color ? F8 : F1];
+      pos->board[color ? F8 : F1] = pos->empty;
       moved->sqr = from;
-      _board[color ? H8 : H1]->sqr = (color ? H8 : H1);
-      SetKingDirs<color>(from);
-      if (_kingDir[color ? (E8 + 8) : E1] == West) {
-        assert(_kingDir[color ? (F8 + 8) : F1] == West);
-        _kingDir[color ? (F8 + 8) : F1] = 0;
-      }
-      if (_atk[from]) {
-        TruncateAttacks(from, to);
-      }
-      AddAttacksFrom((color|Rook), (color ? H8 : H1));
+      pos->MovePieceBits(moved->type, to, from);
+      pos->board[color ? H8 : H1]->sqr = (color ? H8 : H1);
+      pos->MovePieceBits((color|Rook), (color ? F8 : F1), (color ? H8 : H1));
+      pos->SetKingDirs<color>(from);
+      if (pos->kingDir[color ? (E8 + 8) : E1] == West) {
+        assert(pos->kingDir[color ? (F8 + 8) : F1] == West);
+        pos->kingDir[color ? (F8 + 8) : F1] = 0;
+      }
+      if (pos->atk[from]) {
+        pos->TruncateAttacks(from, to);
+      }
+      pos->AddAttacksFrom((color|Rook), (color ? H8 : H1));
       break;
     case CastleLong:
-      assert(moved == (color ? _KING[Black] : _KING[White]));
+      assert(moved == (color ? pos->king[Black] : pos->king[White]));
       assert(from == (color ? E8 : E1));
       assert(to == (color ? C8 : C1));
       assert(!cap);
       assert(!promo);
-      assert(_board[color ? E8 : E1] == _EMPTY);
-      assert(_board[color ? A8 : A1] == _EMPTY);
-      assert(_board[color ? B8 : B1] == _EMPTY);
-      assert(_board[color ? C8 : C1] != _EMPTY);
-      assert(_board[color ? D8 : D1] != _EMPTY);
-      assert(_board[color ? D8 : D1]->type == (color|Rook));
-      ClearKingDirs<color>(to);
-      ClearAttacksFrom((color|Rook), (color ? D8 : D1));
-      _board[color ? A8 : A1] = _board[color ? D8 : D1];
-      _board[color ? D8 : D1] = _EMPTY;
-      _board[color ? E8 : E1] = moved;
-      _board[color ? C8 : C1] = _EMPTY;
+      assert(pos->board[color ? E8 : E1] == pos->empty);
+      assert(pos->board[color ? A8 : A1] == pos->empty);
+      assert(pos->board[color ? B8 : B1] == pos->empty);
+      assert(pos->board[color ? C8 : C1] != pos->empty);
+      assert(pos->board[color ? D8 : D1] != pos->empty);
+      assert(pos->board[color ? D8 : D1]->type == (color|Rook));
+      pos->ClearKingDirs<color>(to);
+      pos->ClearAttacksFrom((color|Rook), (color ? D8 : D1));
+      pos->board[color ? A8 : A1] = pos->board[color ? D8 : D1];
+      pos->board[color ? D8 : D1] = pos->empty;
+      pos->board[color ? E8 : E1] = moved;
+      pos->board[color ? C8 : C1] = pos->empty;
       moved->sqr = from;
-      _board[color ? A8 : A1]->sqr = (color ? A8 : A1);
-      SetKingDirs<color>(from);
-      if (_kingDir[color ? (E8 + 8) : E1] == East) {
-        assert(_kingDir[color ? (D8 + 8) : D1] == East);
-        _kingDir[color ? (D8 + 8) : D1] = 0;
-      }
-      if (_atk[from]) {
-        TruncateAttacks(from, to);
-      }
-      AddAttacksFrom((color|Rook), (color ? A8 : A1));
+      pos->MovePieceBits(moved->type, to, from);
+      pos->board[color ? A8 : A1]->sqr = (color ? A8 : A1);
+      pos->MovePieceBits((color|Rook), (color ? D8 : D1), (color ? A8 : A1));
+      pos->SetKingDirs<color>(from);
+      if (pos->kingDir[color ? (E8 + 8) : E1] == East) {
+        assert(pos->kingDir[color ? (D8 + 8) : D1] == East);
+        pos->kingDir[color ? (D8 + 8) : D1] = 0;
+      }
+      if (pos->atk[from]) {
+        pos->TruncateAttacks(from, to);
+      }
+      pos->AddAttacksFrom((color|Rook), (color ? A8 : A1));
       break;
     default:
-      if (moved >= _FIRST_SLIDER) {
-        ClearAttacksFrom(moved->type, to);
+      if (moved >= pos->firstSlider) {
+        pos->ClearAttacksFrom(moved->type, to);
       }
       if (promo) {
         assert(move.Type() == PawnMove);
         assert(moved->type == promo);
-        RemovePiece(promo, to);
-        AddPiece((color|Pawn), from);
-        _material[color] += (PawnValue - ValueOf(promo));
+        pos->RemovePiece(promo, to);
+        pos->AddPiece((color|Pawn), from);
+        pos->material[color] += (PawnValue - ValueOf(promo));
       }
       else {
-        _board[from] = moved;
+        pos->board[from] = moved;
         moved->sqr = from;
+        pos->MovePieceBits(moved->type, to, from);
       }
       if (cap) {
-        AddPiece(cap, to);
-        _material[!color] += ValueOf(cap);
+        pos->AddPiece(cap, to);
+        pos->material[!color] += ValueOf(cap);
       }
       else {
-        _board[to] = _EMPTY;
+        pos->board[to] = pos->empty;
       }
-      if (_atk[from]) {
-        TruncateAttacks(from, to);
+      if (pos->atk[from]) {
+        pos->TruncateAttacks(from, to);
       }
       if (cap >= Bishop) {
-        AddAttacksFrom(cap, to);
+        pos->AddAttacksFrom(cap, to);
       }
-      else if (!cap && _atk[to]) {
-        ExtendAttacks(to);
+      else if (!cap && pos->atk[to]) {
+        pos->ExtendAttacks(to);
       }
-      if (_board[from] >= _FIRST_SLIDER) {
-        AddAttacksFrom(_board[from]->type, from);
+      if (pos->board[from] >= pos->firstSlider) {
+        pos->AddAttacksFrom(pos->board[from]->type, from);
       }
-      UpdateKingDirs<White>(to, from);
-      UpdateKingDirs<Black>(to, from);
+      pos->UpdateKingDirs<White>(to, from);
+      pos->UpdateKingDirs<Black>(to, from);
     }
 
 #if 0
-    assert(VerifyAttacks(true));
+    assert(pos->VerifyAttacks(true));
 #endif
   }
 
@@ -3011,7 +3834,7 @@ struct Node
     assert(!checks);
     assert(&dest != this);
 
-    _stats.nullMoves++;
+    pos->stats.nullMoves++;
 
     dest.state = (state ^ 1);
     dest.ep = None;
@@ -3025,31 +3848,44 @@ struct Node
                         _HASH[1][dest.ep]);
 
     dest.lastMove.Clear();
-    dest.standPat = (_material[!color] - _material[color]);
+    dest.standPat = (pos->material[!color] - pos->material[color]);
     assert(standPat > (ply - Infinity));
     dest.checks = 0;
 
 #if 0
-    assert(VerifyAttacks(true));
+    assert(pos->VerifyAttacks(true));
 #endif
   }
 
   //---------------------------------------------------------------------------
   template<Color color>
   uint64_t PerftSearch(const int depth) {
+    PerftEntry* entry = NULL;
+    const uint64_t key = (positionKey + depth);
+    uint64_t count = 0;
+    if (ctx->perftHashSize && (depth > 1)) {
+      entry = ctx->perftTT.Get(key);
+      if (entry->Get(key, depth, count)) {
+        ctx->perftTT.IncHits();
+        return count;
+      }
+    }
+
     GenerateMoves<color, false>(depth);
-    _stats.snodes += moveCount;
+    pos->stats.snodes += moveCount;
     if (!child || (depth <= 1)) {
       return moveCount;
     }
 
-    uint64_t count = 0;
-    while (!_stop && (moveIndex < moveCount)) {
+    while (!ctx->stop && (moveIndex < moveCount)) {
       const Move& move = moves[moveIndex++];
-      Exec<color>(move, *child);
+      Exec<color, false>(move, *child);
       count += child->PerftSearch<!color>(depth - 1);
       Undo<color>(move);
     }
+    if (entry && !ctx->stop) {
+      entry->Set(key, depth, count);
+    }
     return count;
   }
 
@@ -3059,18 +3895,21 @@ struct Node
     assert(!ply);
     assert(!parent);
     assert(child);
-    assert(VerifyAttacks(true));
+    assert(pos->VerifyAttacks(true));
 
     GenerateMoves<color, false>(depth);
-    _stats.snodes += moveCount;
+    pos->stats.snodes += moveCount;
 
     std::sort(moves, (moves + moveCount), Move::LexicalCompare);
 
     uint64_t total = 0;
-    if (depth > 1) {
-      while (!_stop && (moveIndex < moveCount)) {
+    if ((depth > 1) & (ctx->threads.size() > 1)) {
+      total = PerftParallel<color>(depth, false);
+    }
+    else if (depth > 1) {
+      while (!ctx->stop && (moveIndex < moveCount)) {
         const Move& move = moves[moveIndex++];
-        Exec<color>(move, *child);
+        Exec<color, false>(move, *child);
         const uint64_t count = child->PerftSearch<!color>(depth - 1);
         Undo<color>(move);
         senjo::Output() << move.ToString() << ' ' << count << ' '
@@ -3079,7 +3918,7 @@ struct Node
       }
     }
     else {
-      while (!_stop && (moveIndex < moveCount)) {
+      while (!ctx->stop && (moveIndex < moveCount)) {
         const Move& move = moves[moveIndex++];
         assert(move.IsValid());
         senjo::Output() << move.ToString() << " 0 " << move.GetScore();
@@ -3089,25 +3928,99 @@ struct Node
     return total;
   }
 
+  //---------------------------------------------------------------------------
+  // split the root moves, and their replies if there aren't enough root moves
+  // to keep every thread busy, into jobs for all the search threads
+  //---------------------------------------------------------------------------
+  template<Color color>
+  uint64_t PerftParallel(const int depth, const bool qperft) {
+    assert(!ply);
+    assert(depth > 1);
+
+    const int threadCount = static_cast<int>(ctx->threads.size());
+    const bool expand = ((depth > 2) & (moveCount < (4 * threadCount)));
+    std::vector<uint64_t> counts(moveCount, 0);
+    std::vector<PerftJob>& jobs = ctx->perftJobs;
+    jobs.clear();
+
+    PerftJob job;
+    job.qperft = qperft;
+    job.count = 0;
+    for (int i = 0; i < moveCount; ++i) {
+      job.root = i;
+      job.line[0] = moves[i];
+      if (!expand) {
+        job.moves = 1;
+        job.depth = (depth - 1);
+        jobs.push_back(job);
+        continue;
+      }
+
+      // qperft counts the interior node itself
+      counts[i] = qperft;
+      job.moves = 2;
+      job.depth = (depth - 2);
+      Exec<color, false>(moves[i], *child);
+      child->GenerateMoves<!color, false>(depth - 1);
+      pos->stats.snodes += child->moveCount;
+      for (int k = 0; k < child->moveCount; ++k) {
+        job.line[1] = child->moves[k];
+        jobs.push_back(job);
+      }
+      Undo<color>(moves[i]);
+    }
+
+    ctx->RunPerftJobs();
+
+    for (size_t i = 0; i < jobs.size(); ++i) {
+      counts[jobs[i].root] += jobs[i].count;
+    }
+
+    uint64_t total = 0;
+    for (int i = 0; i < moveCount; ++i) {
+      senjo::Output() << moves[i].ToString() << ' ' << counts[i] << ' '
+                      << moves[i].GetScore();
+      total += counts[i];
+    }
+    return total;
+  }
+
+  //---------------------------------------------------------------------------
+  // count the leaves (or qperft nodes) below the given line of moves
+  //---------------------------------------------------------------------------
+  template<Color color>
+  uint64_t PerftLine(const Move* line, const int count, const int depth,
+                     const bool qperft)
+  {
+    if (!count) {
+      return qperft ? QPerftSearch<color>(depth) : PerftSearch<color>(depth);
+    }
+    Exec<color, false>(*line, *child);
+    const uint64_t leafs =
+        child->PerftLine<!color>((line + 1), (count - 1), depth, qperft);
+    Undo<color>(*line);
+    return leafs;
+  }
+
   //---------------------------------------------------------------------------
   template<Color color>
   uint64_t QPerftSearch(const int depth) {
     if (depth <= 0) {
       GenerateMoves<color, true>(depth);
-      _stats.qnodes += moveCount;
+      pos->stats.qnodes += moveCount;
     }
     else {
       GenerateMoves<color, false>(depth);
-      _stats.snodes += moveCount;
+      pos->stats.snodes += moveCount;
     }
     if ((!child) | (!moveCount) | (depth < 0)) {
       return (moveCount + 1);
     }
 
     uint64_t count = 1;
-    while (!_stop && (moveIndex < moveCount)) {
+    while (!ctx->stop && (moveIndex < moveCount)) {
       const Move& move = moves[moveIndex++];
-      Exec<color>(move, *child);
+      Exec<color, false>(move, *child);
       count += child->QPerftSearch<!color>(depth - 1);
       Undo<color>(move);
     }
@@ -3123,18 +4036,22 @@ struct Node
 
     if (depth <= 0) {
       GenerateMoves<color, true>(depth);
-      _stats.qnodes += moveCount;
+      pos->stats.qnodes += moveCount;
     }
     else {
       GenerateMoves<color, false>(depth);
-      _stats.snodes += moveCount;
+      pos->stats.snodes += moveCount;
     }
     std::sort(moves, (moves + moveCount), Move::LexicalCompare);
 
+    if ((depth > 1) & (ctx->threads.size() > 1)) {
+      return PerftParallel<color>(depth, true);
+    }
+
     uint64_t total = 0;
-    while (!_stop && (moveIndex < moveCount)) {
+    while (!ctx->stop && (moveIndex < moveCount)) {
       const Move& move = moves[moveIndex++];
-      Exec<color>(move, *child);
+      Exec<color, false>(move, *child);
       const uint64_t count = child->QPerftSearch<!color>(depth - 1);
       Undo<color>(move);
       senjo::Output() << move.ToString() << ' ' << count << ' '
@@ -3146,11 +4063,16 @@ struct Node
 
   //---------------------------------------------------------------------------
   inline void UpdatePV(const Move& move) {
+    UpdatePV(move, child);
+  }
+
+  //---------------------------------------------------------------------------
+  inline void UpdatePV(const Move& move, const Node* from) {
     pv[0] = move;
-    if (child) {
-      if ((pvCount = (child->pvCount + 1)) > 1) {
+    if (from) {
+      if ((pvCount = (from->pvCount + 1)) > 1) {
         assert(pvCount <= MaxPlies);
-        memcpy((pv + 1), child->pv, (child->pvCount * sizeof(Move)));
+        memcpy((pv + 1), from->pv, (from->pvCount * sizeof(Move)));
       }
     }
     else {
@@ -3161,19 +4083,19 @@ struct Node
   //---------------------------------------------------------------------------
   void OutputPV(const int score, const int bound = 0) const {
     if (pvCount > 0) {
-      const uint64_t msecs = (senjo::Now() - _startTime);
+      const uint64_t msecs = (senjo::Now() - ctx->startTime);
       senjo::Output out(senjo::Output::NoPrefix);
 
-      const uint64_t nodes = (_stats.snodes + _stats.qnodes);
-      out << "info depth " << _depth
-          << " seldepth " << _seldepth
+      const uint64_t nodes = ctx->NodeCount();
+      out << "info depth " << ctx->depth
+          << " seldepth " << pos->seldepth
           << " nodes " << nodes
           << " time " << msecs
           << " nps " << static_cast<uint64_t>(senjo::Rate(nodes, msecs));
 
       if (bound) {
-        out << " currmovenumber " << _movenum
-            << " currmove " << _currmove;
+        out << " currmovenumber " << ctx->movenum
+            << " currmove " << ctx->currmove;
       }
 
       if (abs(score) < MateScore) {
@@ -3208,13 +4130,13 @@ struct Node
     int* top = stack;
     uint8_t* file = entry->fileInfo[color];
 
-    for (int i = _pcount[color|Pawn]; i--; ) {
+    for (int i = pos->pcount[color|Pawn]; i--; ) {
       assert(i >= 0);
-      const int sqr = _piece[PawnOffset + i + (8 * color)].sqr;
+      const int sqr = pos->piece[PawnOffset + i + (8 * color)].sqr;
       assert(IS_SQUARE(sqr));
-      assert(_board[sqr] == (_piece + PawnOffset + i + (8 * color)));
-      assert(_board[sqr]->type == (color|Pawn));
-      assert(_board[sqr]->sqr == sqr);
+      assert(pos->board[sqr] == (pos->piece + PawnOffset + i + (8 * color)));
+      assert(pos->board[sqr]->type == (color|Pawn));
+      assert(pos->board[sqr]->sqr == sqr);
 
       score += _PAWN_SQR[sqr + (8 * color)];
 
@@ -3270,7 +4192,6 @@ struct Node
   void FindPassers(PawnEntry* entry) {
     assert(entry);
     uint8_t* me = entry->fileInfo[color];
-    const uint8_t* you = entry->fileInfo[!color];
 
     for (int x = 0; x < 8; ++x) {
       const int y = (me[x + 1] & 7);
@@ -3280,28 +4201,24 @@ struct Node
 
       assert((y >= 1) & (y <= 6));
       assert(IS_SQUARE(SQR(x,y)));
-      assert(_board[SQR(x,y)]->type == (color|Pawn));
-      assert(_board[SQR(x,y)]->sqr == SQR(x,y));
+      assert(pos->board[SQR(x,y)]->type == (color|Pawn));
+      assert(pos->board[SQR(x,y)]->sqr == SQR(x,y));
 
       // opposing pawn counts
-      int op[3] = {0};
-      for (int n = 0; n < 3; ++n) {
-        for (int i = (you[x + n] & 7); ((i > 0) & (i < 7)); color ? --i : ++i) {
-          if (_board[SQR((x + n - 1),i)]->type == ((!color)|Pawn)) {
-            op[n] += (color ? (i < y) : (i > y));
-          }
-        }
-      }
-      if (op[1]) {
+      const uint64_t ahead = (pos->bits[(!color)|Pawn] & RanksAhead<color>(y));
+      if (ahead & FileBits(x)) {
         continue;
       }
+      int op[3] = {0};
+      op[0] = (x > 0) ? BitCount(ahead & FileBits(x - 1)) : 0;
+      op[2] = (x < 7) ? BitCount(ahead & FileBits(x + 1)) : 0;
       if (op[0] | op[2]) {
         if ((color ? (y > 3) : (y < 4)) | !(me[x + 1] & PawnEntry::Supported)) {
           continue;
         }
         for (int n = 0; n < 3; n += 2) {
           for (int i = (me[x + n] & 7); ((i > 0) & (i < 7)); color ? ++i : --i) {
-            if (_board[SQR((x + n - 1),i)]->type == (color|Pawn)) {
+            if (pos->board[SQR((x + n - 1),i)]->type == (color|Pawn)) {
               op[n] -= (color ? (i < y) : (i > y));
               break; // be pessimistic, only count the first supporting pawn
             }
@@ -3330,8 +4247,8 @@ struct Node
       const int y = (me[x + 1] & 7);
       assert((y >= 1) & (y <= 6));
       assert(IS_SQUARE(SQR(x,y)));
-      assert(_board[SQR(x,y)]->type == (color|Pawn));
-      assert(_board[SQR(x,y)]->sqr == SQR(x,y));
+      assert(pos->board[SQR(x,y)]->type == (color|Pawn));
+      assert(pos->board[SQR(x,y)]->sqr == SQR(x,y));
 
       int bonus = _PASSER_BONUS[color ? (7 - y) : y];
 
@@ -3347,35 +4264,29 @@ struct Node
 
       const int from = SQR(x,y);
       assert(IS_SQUARE(from));
-      assert(_board[from]->type == (color|Pawn));
-      assert(_board[from]->sqr == SQR(x,y));
+      assert(pos->board[from]->type == (color|Pawn));
+      assert(pos->board[from]->sqr == SQR(x,y));
 
       // reduce bonus if blocked
-      if (_board[from + (color ? South : North)]->type) {
+      if (pos->board[from + (color ? South : North)]->type) {
         bonus = ((bonus * 3) / 4);
       }
 
       // can it outrun the enemy king?
-      else if (!(_pcount[!color] + _pcount[(!color)|Knight])) {
+      else if (!(pos->pcount[!color] + pos->pcount[(!color)|Knight])) {
         const int tmp = SQR(x,(color ? 0 : 7)); // promotion square
         if ((Distance(from, tmp) + (COLOR(state) != color)) <
-            Distance(_KING[!color]->sqr, tmp))
+            Distance(pos->king[!color]->sqr, tmp))
         {
           bonus += 200;
         }
       }
 
       // increase bonus if path to promotion is completely unblocked
-      else {
+      else if (!((pos->bits[White] | pos->bits[Black]) & FileBits(x) &
+                 RanksAhead<color>(color ? (y - 1) : (y + 1))))
+      {
         bonus += 8;
-        for (int sqr = (from + (2 * (color ? South : North))); IS_SQUARE(sqr);
-             sqr += (color ? South : North))
-        {
-          if (_board[sqr]->type) {
-            bonus -= 8;
-            break;
-          }
-        }
       }
 
       score += bonus;
@@ -3397,21 +4308,21 @@ struct Node
     int score = 0;
 
     // redundant knights are worth slightly less
-    if (_pcount[color|Knight] > 1) {
-      score -= (16 * (_pcount[color|Knight] - 1));
+    if (pos->pcount[color|Knight] > 1) {
+      score -= (16 * (pos->pcount[color|Knight] - 1));
     }
 
-    for (int i = _pcount[color|Knight]; i--; ) {
+    for (int i = pos->pcount[color|Knight]; i--; ) {
       assert(i >= 0);
-      const int sqr = _piece[KnightOffset + i + (10 * color)].sqr;
+      const int sqr = pos->piece[KnightOffset + i + (10 * color)].sqr;
       assert(IS_SQUARE(sqr));
-      assert(_board[sqr] == (_piece + KnightOffset + i + (10 * color)));
-      assert(_board[sqr]->type == (color|Knight));
-      assert(_board[sqr]->sqr == sqr);
+      assert(pos->board[sqr] == (pos->piece + KnightOffset + i + (10 * color)));
+      assert(pos->board[sqr]->type == (color|Knight));
+      assert(pos->board[sqr]->sqr == sqr);
 
       const int x = XC(sqr);
       const int y = YC(sqr);
-      if (_pcount[(!color)|Pawn]) {
+      if (pos->pcount[(!color)|Pawn]) {
         // bonus if can't be menaced by enemy pawns
         score += (4 * !(fileInfo[!color][x] | fileInfo[!color][x + 2]));
 
@@ -3427,15 +4338,16 @@ struct Node
           const int to = ((mvs & 0xFF) - 1);
           assert(IS_SQUARE(to));
           assert(to != sqr);
-          mob += ((!_board[to]->type) | (COLOR(_board[to]->type) != color));
+          mob += ((!pos->board[to]->type) |
+                  (COLOR(pos->board[to]->type) != color));
         }
       }
       assert((mob >= 0) & (mob <= 8));
       score += (mob - (16 * !mob) - (4 * (mob == 1)));
 
       // keep knights close to the kings
-      score += (8 - (Distance(sqr, _KING[White]->sqr) +
-                     Distance(sqr, _KING[Black]->sqr)));
+      score += (8 - (Distance(sqr, pos->king[White]->sqr) +
+                     Distance(sqr, pos->king[Black]->sqr)));
     }
 
 #ifndef NDEBUG
@@ -3455,21 +4367,22 @@ struct Node
 
     // bonus for having bishop pair (increases as pawns come off the board)
     // NOTE: this doesn't verify they are on opposite color squares!
-    if (_pcount[color|Bishop] > 1) {
-      score += (48 - ((5 * (_pcount[White|Pawn] + _pcount[Black|Pawn])) / 3));
+    if (pos->pcount[color|Bishop] > 1) {
+      const int pawns = (pos->pcount[White|Pawn] + pos->pcount[Black|Pawn]);
+      score += (48 - ((5 * pawns) / 3));
     }
 
-    for (int i = _pcount[color|Bishop]; i--; ) {
+    for (int i = pos->pcount[color|Bishop]; i--; ) {
       assert(i >= 0);
-      const int sqr = _piece[BishopOffset + i + (10 * color)].sqr;
+      const int sqr = pos->piece[BishopOffset + i + (10 * color)].sqr;
       assert(IS_SQUARE(sqr));
-      assert(_board[sqr] == (_piece + BishopOffset + i + (10 * color)));
-      assert(_board[sqr]->type == (color|Bishop));
-      assert(_board[sqr]->sqr == sqr);
+      assert(pos->board[sqr] == (pos->piece + BishopOffset + i + (10 * color)));
+      assert(pos->board[sqr]->type == (color|Bishop));
+      assert(pos->board[sqr]->sqr == sqr);
 
       const int x = XC(sqr);
       const int y = YC(sqr);
-      if (_pcount[(!color)|Pawn]) {
+      if (pos->pcount[(!color)|Pawn]) {
         // bonus if can't be menaced by enemy pawns
         score += (4 * !(fileInfo[!color][x] | fileInfo[!color][x + 2]));
 
@@ -3480,25 +4393,25 @@ struct Node
 
       // mobility bonus/penalty
       int mob = 0;
-      for (uint64_t mvs = _atk[sqr + 8]; mvs; mvs >>= 8) {
+      for (uint64_t mvs = pos->atk[sqr + 8]; mvs; mvs >>= 8) {
         if (mvs & 0xFF) {
           int to = ((mvs & 0xFF) - 1);
           assert(IS_DIAG(Direction(sqr, to)));
           assert(Distance(sqr, to) > 0);
-          mob += (Distance(sqr, to) - ((_board[to]->type != 0) &
-                                       (COLOR(_board[to]->type) == color)));
+          mob += (Distance(sqr, to) - ((pos->board[to]->type != 0) &
+                                       (COLOR(pos->board[to]->type) == color)));
         }
       }
       assert((mob >= 0) & (mob <= 13));
       score += ((mob / 2) - (16 * !mob) - (4 * (mob == 1)));
 
       // bonus for being inline with enemy king
-      const int dir = Direction(sqr, _KING[!color]->sqr);
+      const int dir = Direction(sqr, pos->king[!color]->sqr);
       score += (4 * IS_DIAG(dir));
 
       // stay close to fiendly king during endgame
       score += static_cast<int>(
-            EndGame(color) * (8 - Distance(sqr, _KING[color]->sqr)));
+            pos->EndGame(color) * (8 - Distance(sqr, pos->king[color]->sqr)));
     }
 
 #ifndef NDEBUG
@@ -3516,22 +4429,22 @@ struct Node
     assert((RookOffset + 10) == BlackRookOffset);
     int score = 0;
 
-    for (int i = _pcount[color|Rook]; i--; ) {
+    for (int i = pos->pcount[color|Rook]; i--; ) {
       assert(i >= 0);
-      const int sqr = _piece[RookOffset + i + (10 * color)].sqr;
+      const int sqr = pos->piece[RookOffset + i + (10 * color)].sqr;
       assert(IS_SQUARE(sqr));
-      assert(_board[sqr] == (_piece + RookOffset + i + (10 * color)));
-      assert(_board[sqr]->type == (color|Rook));
-      assert(_board[sqr]->sqr == sqr);
+      assert(pos->board[sqr] == (pos->piece + RookOffset + i + (10 * color)));
+      assert(pos->board[sqr]->type == (color|Rook));
+      assert(pos->board[sqr]->sqr == sqr);
 
       int mob = 0;
-      for (uint64_t mvs = _atk[sqr + 8]; mvs; mvs >>= 8) {
+      for (uint64_t mvs = pos->atk[sqr + 8]; mvs; mvs >>= 8) {
         if (mvs & 0xFF) {
           int to = ((mvs & 0xFF) - 1);
           assert(IS_CROSS(Direction(sqr, to)));
           assert(Distance(sqr, to) > 0);
-          mob += (Distance(sqr, to) - ((_board[to]->type != 0) &
-                                       (COLOR(_board[to]->type) == color)));
+          mob += (Distance(sqr, to) - ((pos->board[to]->type != 0) &
+                                       (COLOR(pos->board[to]->type) == color)));
         }
       }
       assert((mob >= 0) & (mob <= 14));
@@ -3540,7 +4453,7 @@ struct Node
       const int y = YC(sqr);
       const uint8_t pawn = (fileInfo[color][x + 1] & 7);
       assert(!pawn || ((pawn >= 1) & (pawn <= 6)));
-      assert(!pawn || (_board[SQR(x,pawn)]->type == (color|Pawn)));
+      assert(!pawn || (pos->board[SQR(x,pawn)]->type == (color|Pawn)));
       assert(!pawn || (pawn != y));
 
       // bonus if on open file
@@ -3562,7 +4475,7 @@ struct Node
       else if ((mob < 6) & !(state & (color ? BlackCastle : WhiteCastle)) &
                (color ? (y > pawn) : (y < pawn)))
       {
-        const int kx = XC(_KING[color]->sqr);
+        const int kx = XC(pos->king[color]->sqr);
         if (kx >= 4) {
           score -= (20 * (x >= kx));
         }
@@ -3583,7 +4496,7 @@ struct Node
 
       // stay close to fiendly king during endgame
       score += static_cast<int>(
-            EndGame(color) * (8 - Distance(sqr, _KING[color]->sqr)));
+            pos->EndGame(color) * (8 - Distance(sqr, pos->king[color]->sqr)));
     }
 
 #ifndef NDEBUG
@@ -3600,30 +4513,30 @@ struct Node
     assert((QueenOffset + 10) == BlackQueenOffset);
     int score = 0;
 
-    for (int i = _pcount[color|Queen]; i--; ) {
+    for (int i = pos->pcount[color|Queen]; i--; ) {
       assert(i >= 0);
-      const int sqr = _piece[QueenOffset + i + (10 * color)].sqr;
+      const int sqr = pos->piece[QueenOffset + i + (10 * color)].sqr;
       assert(IS_SQUARE(sqr));
-      assert(_board[sqr] == (_piece + QueenOffset + i + (10 * color)));
-      assert(_board[sqr]->type == (color|Queen));
-      assert(_board[sqr]->sqr == sqr);
+      assert(pos->board[sqr] == (pos->piece + QueenOffset + i + (10 * color)));
+      assert(pos->board[sqr]->type == (color|Queen));
+      assert(pos->board[sqr]->sqr == sqr);
 
       // mobility bonus/penalty
       int mob = 0;
-      for (uint64_t mvs = _atk[sqr + 8]; mvs; mvs >>= 8) {
+      for (uint64_t mvs = pos->atk[sqr + 8]; mvs; mvs >>= 8) {
         if (mvs & 0xFF) {
           int to = ((mvs & 0xFF) - 1);
           assert(IS_DIR(Direction(sqr, to)));
           assert(Distance(sqr, to) > 0);
-          mob += (Distance(sqr, to) - ((_board[to]->type != 0) &
-                                       (COLOR(_board[to]->type) == color)));
+          mob += (Distance(sqr, to) - ((pos->board[to]->type != 0) &
+                                       (COLOR(pos->board[to]->type) == color)));
         }
       }
       assert((mob >= 0) & (mob <= 27));
       score += ((mob / 4) - (16 * !mob) - (4 * (mob == 1)));
 
       // bonus for being close to enemy king
-      score += (16 - (2 * Distance(sqr, _KING[!color]->sqr)));
+      score += (16 - (2 * Distance(sqr, pos->king[!color]->sqr)));
     }
 
 #ifndef NDEBUG
@@ -3656,10 +4569,10 @@ struct Node
   //---------------------------------------------------------------------------
   template<Color color>
   int KingEval(const uint8_t fileInfo[2][10]) {
-    const int sqr = _KING[color]->sqr;
+    const int sqr = pos->king[color]->sqr;
     assert(IS_SQUARE(sqr));
-    assert(_board[sqr]->type == (color|King));
-    assert(_board[sqr]->sqr == sqr);
+    assert(pos->board[sqr]->type == (color|King));
+    assert(pos->board[sqr]->sqr == sqr);
     assert(fileInfo);
 
     int eg = _SQR[sqr];     // endgame score
@@ -3697,7 +4610,8 @@ struct Node
     // TODO endgame scoring
     //      keep close to pawns, especially passers (friend or foe)
 
-    mg = static_cast<int>((EndGame(color) * eg) + (MidGame(color) * mg));
+    mg = static_cast<int>((pos->EndGame(color) * eg) +
+                          (pos->MidGame(color) * mg));
 
 #ifndef NDEBUG
     scoreType[color|King] = mg;
@@ -3709,62 +4623,70 @@ struct Node
 
   //---------------------------------------------------------------------------
   void Evaluate() {
-    assert(!_piece[0].type);
-    assert(_piece[WhiteKingOffset].type == (White|King));
-    assert(_piece[BlackKingOffset].type == (Black|King));
-    assert(_KING[White]->type == (White|King));
-    assert(_KING[Black]->type == (Black|King));
-    assert(IS_SQUARE(_KING[White]->sqr));
-    assert(IS_SQUARE(_KING[White]->sqr));
-    assert(_board[_KING[White]->sqr] == _KING[White]);
-    assert(_board[_KING[Black]->sqr] == _KING[Black]);
-    assert((_pcount[White] >= 0) & (_pcount[White] <= 13));
-    assert((_pcount[Black] >= 0) & (_pcount[Black] <= 13));
-    assert(_pcount[White] == (_pcount[White|Bishop] + _pcount[White|Rook] +
-                              _pcount[White|Queen]));
-    assert(_pcount[Black] == (_pcount[Black|Bishop] + _pcount[Black|Rook] +
-                              _pcount[Black|Queen]));
-    assert((_pcount[White|Pawn] >= 0) & (_pcount[White|Pawn] <= 8));
-    assert((_pcount[Black|Pawn] >= 0) & (_pcount[Black|Pawn] <= 8));
-    assert((_pcount[White|Knight] >= 0) & (_pcount[White|Knight] <= 10));
-    assert((_pcount[Black|Knight] >= 0) & (_pcount[Black|Knight] <= 10));
-    assert((_pcount[White|Bishop] >= 0) & (_pcount[White|Bishop] <= 10));
-    assert((_pcount[Black|Bishop] >= 0) & (_pcount[Black|Bishop] <= 10));
-    assert((_pcount[White|Rook] >= 0) & (_pcount[White|Rook] <= 10));
-    assert((_pcount[Black|Rook] >= 0) & (_pcount[Black|Rook] <= 10));
-    assert((_pcount[White|Queen] >= 0) & (_pcount[White|Queen] <= 9));
-    assert((_pcount[Black|Queen] >= 0) & (_pcount[Black|Queen] <= 9));
-    assert(!pawnKey == !(_pcount[White|Pawn]|_pcount[Black|Pawn]));
-
-    const bool whiteCanWin = (_pcount[White|Pawn] |
-                             (_pcount[White|Knight] > 2) |
-                             (_pcount[White|Bishop] > 1) |
-                             ((_pcount[White|Knight] != 0) &
-                              (_pcount[White|Bishop] != 0)) |
-                              _pcount[White|Rook] |
-                              _pcount[White|Queen]);
-
-    const bool blackCanWin = (_pcount[Black|Pawn] |
-                             (_pcount[Black|Knight] > 2) |
-                             (_pcount[Black|Bishop] > 1) |
-                             ((_pcount[Black|Knight] != 0) &
-                              (_pcount[Black|Bishop] != 0)) |
-                              _pcount[Black|Rook] |
-                              _pcount[Black|Queen]);
+    assert(!pos->piece[0].type);
+    assert(pos->piece[WhiteKingOffset].type == (White|King));
+    assert(pos->piece[BlackKingOffset].type == (Black|King));
+    assert(pos->king[White]->type == (White|King));
+    assert(pos->king[Black]->type == (Black|King));
+    assert(IS_SQUARE(pos->king[White]->sqr));
+    assert(IS_SQUARE(pos->king[White]->sqr));
+    assert(pos->board[pos->king[White]->sqr] == pos->king[White]);
+    assert(pos->board[pos->king[Black]->sqr] == pos->king[Black]);
+    assert((pos->pcount[White] >= 0) & (pos->pcount[White] <= 13));
+    assert((pos->pcount[Black] >= 0) & (pos->pcount[Black] <= 13));
+    assert(pos->pcount[White] == (pos->pcount[White|Bishop] +
+                                  pos->pcount[White|Rook] +
+                                  pos->pcount[White|Queen]));
+    assert(pos->pcount[Black] == (pos->pcount[Black|Bishop] +
+                                  pos->pcount[Black|Rook] +
+                                  pos->pcount[Black|Queen]));
+    assert((pos->pcount[White|Pawn] >= 0) & (pos->pcount[White|Pawn] <= 8));
+    assert((pos->pcount[Black|Pawn] >= 0) & (pos->pcount[Black|Pawn] <= 8));
+    assert((pos->pcount[White|Knight] >= 0) &
+           (pos->pcount[White|Knight] <= 10));
+    assert((pos->pcount[Black|Knight] >= 0) &
+           (pos->pcount[Black|Knight] <= 10));
+    assert((pos->pcount[White|Bishop] >= 0) &
+           (pos->pcount[White|Bishop] <= 10));
+    assert((pos->pcount[Black|Bishop] >= 0) &
+           (pos->pcount[Black|Bishop] <= 10));
+    assert((pos->pcount[White|Rook] >= 0) & (pos->pcount[White|Rook] <= 10));
+    assert((pos->pcount[Black|Rook] >= 0) & (pos->pcount[Black|Rook] <= 10));
+    assert((pos->pcount[White|Queen] >= 0) & (pos->pcount[White|Queen] <= 9));
+    assert((pos->pcount[Black|Queen] >= 0) & (pos->pcount[Black|Queen] <= 9));
+    assert(!pawnKey == !(pos->pcount[White|Pawn]|pos->pcount[Black|Pawn]));
+
+    const bool whiteCanWin = (pos->pcount[White|Pawn] |
+                             (pos->pcount[White|Knight] > 2) |
+                             (pos->pcount[White|Bishop] > 1) |
+                             ((pos->pcount[White|Knight] != 0) &
+                              (pos->pcount[White|Bishop] != 0)) |
+                              pos->pcount[White|Rook] |
+                              pos->pcount[White|Queen]);
+
+    const bool blackCanWin = (pos->pcount[Black|Pawn] |
+                             (pos->pcount[Black|Knight] > 2) |
+                             (pos->pcount[Black|Bishop] > 1) |
+                             ((pos->pcount[Black|Knight] != 0) &
+                              (pos->pcount[Black|Bishop] != 0)) |
+                              pos->pcount[Black|Rook] |
+                              pos->pcount[Black|Queen]);
 
 #ifndef NDEBUG
     memset(scoreType, 0, sizeof(scoreType));
     scoreType[White|CanWin]   = (whiteCanWin * _CAN_WIN_BONUS);
     scoreType[Black|CanWin]   = (blackCanWin * _CAN_WIN_BONUS);
-    scoreType[White|Material] = _material[White];
-    scoreType[Black|Material] = _material[Black];
-    scoreType[White|Total]    = (_material[White] + scoreType[White|CanWin]);
-    scoreType[Black|Total]    = (_material[Black] + scoreType[Black|CanWin]);
+    scoreType[White|Material] = pos->material[White];
+    scoreType[Black|Material] = pos->material[Black];
+    scoreType[White|Total]    = (pos->material[White] +
+                                 scoreType[White|CanWin]);
+    scoreType[Black|Total]    = (pos->material[Black] +
+                                 scoreType[Black|CanWin]);
 #endif
 
     if (!(whiteCanWin | blackCanWin)) {
       state |= Draw;
-      standPat = _drawScore[COLOR(state)];
+      standPat = ctx->drawScore[COLOR(state)];
       return;
     }
 
@@ -3773,24 +4695,24 @@ struct Node
     atkScore[White] = 0;
     atkScore[Black] = 0;
 
-    int score = (_material[White] - _material[Black] +
+    int score = (pos->material[White] - pos->material[Black] +
                  (whiteCanWin * _CAN_WIN_BONUS) -
                  (blackCanWin * _CAN_WIN_BONUS));
 
-    PawnEntry* entry = _pawnTT.Get(pawnKey);
+    PawnEntry* entry = pos->pawnTT.Get(pawnKey);
     assert(entry);
     if (entry->positionKey == pawnKey) {
-      _pawnTT.IncHits();
+      pos->pawnTT.IncHits();
       score += (entry->score[White] - entry->score[Black]);
 #ifndef NDEBUG
       int pscore = (score - entry->score[White] + entry->score[Black]);
       PawnEntry tmp;
       memset(&tmp, 0, sizeof(tmp));
       tmp.positionKey = pawnKey;
-      if (_pcount[White|Pawn]) pscore += PawnEval<White>(&tmp);
-      if (_pcount[Black|Pawn]) pscore -= PawnEval<Black>(&tmp);
-      if (_pcount[White|Pawn]) FindPassers<White>(&tmp);
-      if (_pcount[Black|Pawn]) FindPassers<Black>(&tmp);
+      if (pos->pcount[White|Pawn]) pscore += PawnEval<White>(&tmp);
+      if (pos->pcount[Black|Pawn]) pscore -= PawnEval<Black>(&tmp);
+      if (pos->pcount[White|Pawn]) FindPassers<White>(&tmp);
+      if (pos->pcount[Black|Pawn]) FindPassers<Black>(&tmp);
       assert(pscore == score);
       assert(!memcmp(&tmp, entry, sizeof(PawnEntry)));
 #endif
@@ -3798,14 +4720,14 @@ struct Node
     else {
       memset(entry, 0, sizeof(PawnEntry));
       entry->positionKey = pawnKey;
-      if (_pcount[White|Pawn]) score += PawnEval<White>(entry);
-      if (_pcount[Black|Pawn]) score -= PawnEval<Black>(entry);
-      if (_pcount[White|Pawn]) FindPassers<White>(entry);
-      if (_pcount[Black|Pawn]) FindPassers<Black>(entry);
+      if (pos->pcount[White|Pawn]) score += PawnEval<White>(entry);
+      if (pos->pcount[Black|Pawn]) score -= PawnEval<Black>(entry);
+      if (pos->pcount[White|Pawn]) FindPassers<White>(entry);
+      if (pos->pcount[Black|Pawn]) FindPassers<Black>(entry);
     }
 
-    if (_pcount[White|Pawn]) score += PasserEval<White>(entry->fileInfo);
-    if (_pcount[Black|Pawn]) score -= PasserEval<Black>(entry->fileInfo);
+    if (pos->pcount[White|Pawn]) score += PasserEval<White>(entry->fileInfo);
+    if (pos->pcount[Black|Pawn]) score -= PasserEval<Black>(entry->fileInfo);
     score += KnightEval<White>(entry->fileInfo);
     score -= KnightEval<Black>(entry->fileInfo);
     score += BishopEval<White>(entry->fileInfo);
@@ -3841,16 +4763,21 @@ struct Node
     assert(abs(beta) <= Infinity);
     assert(depth <= 0);
 
-    _stats.qnodes++;
-    if (ply > _seldepth) {
-      _seldepth = ply;
+    if (NodeLimitReached()) {
+      pvCount = 0;
+      return alpha;
+    }
+
+    pos->stats.qnodes++;
+    if (ply > pos->seldepth) {
+      pos->seldepth = ply;
     }
 
     pvCount = 0;
     depthChange = 0;
 
     if (IsDraw()) {
-      return (standPat = _drawScore[color]);
+      return (standPat = ctx->drawScore[color]);
     }
 
     // mate distance pruning
@@ -3863,21 +4790,23 @@ struct Node
 
     // transposition table lookup
     int score;
-    HashEntry* entry = _tt.Get(positionKey);
-    if (entry->Key() == positionKey) {
-      _tt.IncHits();
-      switch (entry->GetPrimaryFlag()) {
+    HashEntry stored;
+    HashEntry* entry = ProbeTT(stored);
+    if (stored.Key() == TTKey()) {
+      switch (stored.GetPrimaryFlag()) {
       case HashEntry::Checkmate: return (ply - Infinity);
-      case HashEntry::Stalemate: return (standPat = _drawScore[color]);
+      case HashEntry::Stalemate: return (standPat = ctx->drawScore[color]);
       case HashEntry::UpperBound:
-        if ((score = entry->Score(ply)) <= alpha) {
+        if ((score = stored.Score(ply)) <= alpha) {
+          pos->stats.qttCutoffs += !stored.Depth();
           return score;
         }
         break;
       case HashEntry::ExactScore:
-        return entry->Score(ply);
+        return stored.Score(ply);
       case HashEntry::LowerBound:
-        if ((score = entry->Score(ply)) >= beta) {
+        if ((score = stored.Score(ply)) >= beta) {
+          pos->stats.qttCutoffs += !stored.Depth();
           return score;
         }
         break;
@@ -3889,6 +4818,7 @@ struct Node
     assert(best <= alpha);
     assert(alpha < beta);
     assert(!pvCount);
+    const int origAlpha = alpha;
 
     // if not in check allow standPat
     if (!checks) {
@@ -3906,13 +4836,14 @@ struct Node
     GenerateMoves<color, true>(depth);
     if (moveCount <= 0) {
       if (checks) {
-        entry->SetCheckmate(positionKey);
-        _tt.IncCheckmates();
+        entry->SetCheckmate(TTKey(), ctx->tt.Age());
+        ctx->tt.IncCheckmates();
         return (ply - Infinity);
       }
-      // don't call _tt.StoreStalemate()!!!
+      // don't call ctx->tt.StoreStalemate()!!!
       return standPat;
     }
+    SortMoves(0);
 
     // search 'em
     Move* move;
@@ -3920,16 +4851,21 @@ struct Node
       assert(move->IsValid());
       assert(best <= alpha);
       assert(alpha < beta);
-      _stats.qexecs++;
-      Exec<color>(*move, *child);
+      if (!checks && move->Cap() && BadCapture<color>(*move)) {
+        pos->stats.seePrunes++;
+        continue;
+      }
+      pos->stats.qexecs++;
+      Exec<color, true>(*move, *child);
       score = -child->QSearch<!color>(-beta, -alpha, (depth - 1));
       Undo<color>(*move);
-      if (_stop) {
+      if (Aborted()) {
         return beta;
       }
       if (score > best) {
         UpdatePV(*move);
         if (score >= beta) {
+          StoreQEntry(entry, *move, score, HashEntry::LowerBound);
           return score;
         }
         alpha = std::max<int>(alpha, score);
@@ -3940,6 +4876,10 @@ struct Node
 
     assert(best <= alpha);
     assert(alpha < beta);
+    if (best <= origAlpha) {
+      StoreQEntry(entry, (pvCount ? pv[0] : Move()), best,
+                  HashEntry::UpperBound);
+    }
     return best;
   }
 
@@ -3955,14 +4895,22 @@ struct Node
     assert((type == PV) | ((alpha + 1) == beta));
     assert(cutNode ? lastMove.IsValid() : true);
 
-    _stats.snodes++;
+    if (NodeLimitReached()) {
+      pvCount = 0;
+      return alpha;
+    }
+
+    pos->stats.snodes++;
     moveIndex   = 0;
     moveCount   = 0;
+    stage       = RemainingStage;
+    badIndex    = 0;
+    badCount    = 0;
     pvCount     = 0;
     depthChange = 0;
 
     if (IsDraw()) {
-      return (standPat = _drawScore[color]);
+      return (standPat = ctx->drawScore[color]);
     }
 
     // mate distance pruning
@@ -3975,7 +4923,7 @@ struct Node
 
     // check extensions
     if (checks && (parent->depthChange <= 0)) {
-      _stats.chkExts++;
+      pos->stats.chkExts++;
       depthChange++;
       depth++;
     }
@@ -3985,17 +4933,16 @@ struct Node
     Move firstMove;
 
     // transposition table lookup
-    HashEntry* entry = _tt.Get(positionKey);
-    if (entry->Key() == positionKey) {
-      _tt.IncHits();
-      switch (entry->GetPrimaryFlag()) {
+    HashEntry stored;
+    HashEntry* entry = ProbeTT(stored);
+    if ((stored.Key() == TTKey()) && HashMoveOK<color>(stored)) {
+      switch (stored.GetPrimaryFlag()) {
       case HashEntry::Checkmate: return (ply - Infinity);
-      case HashEntry::Stalemate: return (standPat = _drawScore[color]);
+      case HashEntry::Stalemate: return (standPat = ctx->drawScore[color]);
       case HashEntry::UpperBound:
-        firstMove.Init(entry->MoveBits(), entry->Score(ply));
-        assert(ValidateMove<color>(firstMove) == 0);
-        if (((!pvNode) | entry->HasPvFlag()) &&
-            ((entry->Depth() >= depth) & (firstMove.GetScore() <= alpha)))
+        firstMove.Init(stored.MoveBits(), stored.Score(ply));
+        if (((!pvNode) | stored.HasPvFlag()) &&
+            ((stored.Depth() >= depth) & (firstMove.GetScore() <= alpha)))
         {
           pv[0] = firstMove;
           pvCount = 1;
@@ -4004,10 +4951,9 @@ struct Node
         eval = firstMove.GetScore();
         break;
       case HashEntry::ExactScore:
-        firstMove.Init(entry->MoveBits(), entry->Score(ply));
-        assert(ValidateMove<color>(firstMove) == 0);
-        assert(entry->HasPvFlag());
-        if ((entry->Depth() >= depth) &
+        firstMove.Init(stored.MoveBits(), stored.Score(ply));
+        assert(stored.HasPvFlag());
+        if ((stored.Depth() >= depth) &
             ((!pvNode) |
              (firstMove.GetScore() <= alpha) |
              (firstMove.GetScore() >= beta)))
@@ -4020,17 +4966,16 @@ struct Node
           else if ((!checks) & (firstMove.GetScore() > alpha) &
                    (!firstMove.IsCapOrPromo()))
           {
-            IncHistory(firstMove, depth);
+            pos->IncHistory(firstMove, depth);
           }
           return firstMove.GetScore();
         }
         eval = firstMove.GetScore();
         break;
       case HashEntry::LowerBound:
-        firstMove.Init(entry->MoveBits(), entry->Score(ply));
-        assert(ValidateMove<color>(firstMove) == 0);
-        if (((!pvNode) | entry->HasPvFlag()) &&
-            ((entry->Depth() >= depth) & (firstMove.GetScore() >= beta)))
+        firstMove.Init(stored.MoveBits(), stored.Score(ply));
+        if (((!pvNode) | stored.HasPvFlag()) &&
+            ((stored.Depth() >= depth) & (firstMove.GetScore() >= beta)))
         {
           pv[0] = firstMove;
           pvCount = 1;
@@ -4042,9 +4987,9 @@ struct Node
         assert(false);
       }
       if (((depthChange <= 0) & (parent->depthChange <= 0)) &&
-          entry->HasExtendedFlag())
+          stored.HasExtendedFlag())
       {
-        _stats.hashExts++;
+        pos->stats.hashExts++;
         depthChange++;
         depth++;
       }
@@ -4058,8 +5003,9 @@ struct Node
     // forward pruning (the risky stuff)
     if ((cutNode & (!pvNode) & (!depthChange) & (!checks)) &&
         !IsKiller(lastMove) &&
-        ((_pcount[color] + _pcount[color|Knight]) > 1) &&
-        ((_pcount[color] + _pcount[color|Knight] + _pcount[color|Pawn] > 2)))
+        ((pos->pcount[color] + pos->pcount[color|Knight]) > 1) &&
+        ((pos->pcount[color] + pos->pcount[color|Knight] +
+          pos->pcount[color|Pawn]) > 2))
     {
       assert((alpha + 1) == beta);
       Evaluate();
@@ -4068,7 +5014,7 @@ struct Node
       // static null move pruning
       if (depth == 1) {
         if ((eval >= (beta + (3 * PawnValue))) & (abs(beta) < WinningScore)) {
-          _stats.staticNM++;
+          pos->stats.staticNM++;
           depthChange = -1;
           return beta;
         }
@@ -4081,11 +5027,11 @@ struct Node
         eval = (rdepth > 0)
             ? -child->Search<NonPV, !color>(-beta, -alpha, rdepth, false)
             : -child->QSearch<!color>(-beta, -alpha, 0);
-        if (_stop) {
+        if (Aborted()) {
           return beta;
         }
         if (eval >= beta) {
-          _stats.nmCutoffs++;
+          pos->stats.nmCutoffs++;
           depthChange = -depth;
           return std::max<int>(standPat, beta); // do not return eval
         }
@@ -4099,16 +5045,19 @@ struct Node
     if ((!firstMove) & (depth > 3)) {
       assert(!moveCount);
       assert(!pvCount);
-      _stats.iidCount++;
+      pos->stats.iidCount++;
       eval = Search<NonPV, color>((beta - 1), beta, (depth - 2), false);
-      if (_stop | !pvCount) {
+      if (Aborted() | !pvCount) {
         return eval;
       }
-      assert(moveCount > 0);
+      // moveCount is still zero if another thread stored a hash entry
+      // for this position that cut the IID search short
       assert(pvCount > 0);
       assert(pv[0].IsValid());
       firstMove = pv[0];
-      moveIndex = 1;
+      moveCount = moveIndex = 0;
+      badCount = badIndex = 0;
+      stage = RemainingStage;
     }
 
     // make sure firstMove is populated
@@ -4118,34 +5067,35 @@ struct Node
       GenerateMoves<color, false>(depth);
       if (moveCount <= 0) {
         if (checks) {
-          entry->SetCheckmate(positionKey);
-          _tt.IncCheckmates();
+          entry->SetCheckmate(TTKey(), ctx->tt.Age());
+          ctx->tt.IncCheckmates();
           return (ply - Infinity);
         }
-        entry->SetStalemate(positionKey);
-        _tt.IncStalemates();
-        return (standPat = _drawScore[color]);
+        entry->SetStalemate(TTKey(), ctx->tt.Age());
+        ctx->tt.IncStalemates();
+        return (standPat = ctx->drawScore[color]);
       }
 
+      SortMoves(0);
       firstMove = *GetNextMove();
       assert(moveIndex == 1);
     }
 
     // single reply extensions
     if ((moveCount == 1) & (depthChange <= 0) & (parent->depthChange <= 0)) {
-      _stats.oneReplyExts++;
+      pos->stats.oneReplyExts++;
       depthChange++;
       depth++;
     }
 
     // search first move with full alpha/beta window
     const int orig_alpha = alpha;
-    Exec<color>(firstMove, *child);
+    Exec<color, true>(firstMove, *child);
     best = (depth > 1)
         ? -child->Search<type, !color>(-beta, -alpha, (depth - 1), !cutNode)
         : -child->QSearch<!color>(-beta, -alpha, 0);
     Undo<color>(firstMove);
-    if (_stop) {
+    if (Aborted()) {
       return beta;
     }
     int pvDepth = (depth + std::min<int>(0, child->depthChange));
@@ -4154,7 +5104,7 @@ struct Node
       assert(pvDepth == depth);
       AddKiller(firstMove, pvDepth);
       eval = ((abs(best) > MateScore) ? best : beta);
-      entry->Set(positionKey, firstMove, eval, ply, pvDepth,
+      StoreEntry(entry, firstMove, eval, pvDepth,
                  HashEntry::LowerBound,
                  (((depthChange > 0) ? HashEntry::Extended : 0) |
                   (pvNode ? HashEntry::FromPV : 0)));
@@ -4165,40 +5115,73 @@ struct Node
       alpha = best;
     }
     else if (!(checks | firstMove.IsCapOrPromo())) {
-      DecHistory(firstMove);
+      pos->DecHistory(firstMove);
     }
 
-    // generate moves if we haven't done so already
+    // generate the remaining moves in stages if we haven't generated them
+    // already, unless in check or helper threads may need the whole list
+    const bool splitOK = ((ctx->idleThreads > 0) & (depth >= MinSplitDepth));
     if (moveCount <= 0) {
-      GenerateMoves<color, false>(depth);
-      assert(moveCount > 0);
-      assert((moveCount == 1) ? (moves[0] == firstMove) : true);
+      if (checks || splitOK) {
+        GenerateMoves<color, false>(depth);
+        assert(moveCount > 0);
+        assert((moveCount == 1) ? (moves[0] == firstMove) : true);
+        SortMoves(0);
+      }
+      else {
+        stage = HashMoveStage;
+      }
     }
 
     assert(moveIndex <= 1);
     assert(moveIndex <= moveCount);
 
+    // let idle helper threads search the remaining moves with us
+    if ((splitOK & ((moveCount - moveIndex) > 1)) &&
+        Split<type, color>(alpha, beta, depth, best, pvDepth, firstMove))
+    {
+      if (Aborted()) {
+        return beta;
+      }
+      if (best >= beta) {
+        assert(pvCount > 0);
+        assert(pvDepth == depth);
+        AddKiller(pv[0], pvDepth);
+        eval = ((abs(best) > MateScore) ? best : beta);
+        StoreEntry(entry, pv[0], eval, pvDepth,
+                   HashEntry::LowerBound,
+                   (((depthChange > 0) ? HashEntry::Extended : 0) |
+                    (pvNode ? HashEntry::FromPV : 0)));
+        return best;
+      }
+      assert(moveIndex == moveCount);
+    }
+
     // search remaining moves
     const bool lmrOK = ((!pvNode) & (depth > 2) & (!checks));
     Move* move;
-    while ((move = GetNextMove())) {
+    while ((move = GetNextStagedMove<color>())) {
       assert(move->IsValid());
       if (firstMove == (*move)) {
         continue;
       }
 
-      _stats.lateMoves++;
-      Exec<color>(*move, *child);
+      pos->stats.lateMoves++;
+      Exec<color, true>(*move, *child);
 
       // late move reductions
       int d = (depth - 1);
       if (lmrOK) {
-        _stats.lmCandidates++;
+        pos->stats.lmCandidates++;
         if (!(move->IsCapOrPromo() | IsKiller(*move) | child->checks) &&
-            (_hist[move->TypeToIndex()] < depth))
+            (pos->hist[move->TypeToIndex()] < depth))
         {
-          _stats.lmReductions++;
-          d -= (1 + (_hist[move->TypeToIndex()] < 0));
+          pos->stats.lmReductions++;
+          d -= (1 + (pos->hist[move->TypeToIndex()] < 0));
+        }
+        else if ((stage == BadCaptureStage) & (!child->checks)) {
+          pos->stats.lmReductions++;
+          d--;
         }
       }
 
@@ -4208,28 +5191,28 @@ struct Node
           : -child->QSearch<!color>(-(alpha + 1), -alpha, 0);
 
       // re-search it?
-      if ((!_stop) & (eval > alpha)) {
+      if ((eval > alpha) && !Aborted()) {
         assert(child->depthChange >= 0);
-        _stats.lmAlphaIncs++;
+        pos->stats.lmAlphaIncs++;
         if (pvNode) {
           assert(d == (depth - 1));
-          _stats.lmResearches++;
+          pos->stats.lmResearches++;
           eval = (d > 0)
               ? -child->Search<PV, !color>(-beta, -alpha, d, false)
               : -child->QSearch<!color>(-beta, -alpha, 0);
         }
         else if (d < (depth - 1)) {
           assert((alpha + 1) == beta);
-          _stats.lmResearches++;
+          pos->stats.lmResearches++;
           d = (depth - 1);
           eval = -child->Search<NonPV, !color>(-beta, -alpha, d, false);
         }
-        _stats.lmConfirmed += (eval > alpha);
+        pos->stats.lmConfirmed += (eval > alpha);
       }
 
       assert((depth + child->depthChange) >= 0);
       Undo<color>(*move);
-      if (_stop) {
+      if (Aborted()) {
         return beta;
       }
       if (eval > best) {
@@ -4240,7 +5223,7 @@ struct Node
           assert(pvDepth == depth);
           AddKiller(*move, pvDepth);
           eval = ((abs(best) > MateScore) ? best : beta);
-          entry->Set(positionKey, *move, eval, ply, pvDepth,
+          StoreEntry(entry, *move, eval, pvDepth,
                      HashEntry::LowerBound,
                      (((depthChange > 0) ? HashEntry::Extended : 0) |
                       (pvNode ? HashEntry::FromPV : 0)));
@@ -4252,7 +5235,7 @@ struct Node
         alpha = eval;
       }
       else if (!(checks | move->IsCapOrPromo())) {
-        DecHistory(*move);
+        pos->DecHistory(*move);
       }
     }
 
@@ -4264,40 +5247,188 @@ struct Node
       assert(pvDepth >= 0);
       assert(pv[0].IsValid());
       if (!(checks | pv[0].IsCapOrPromo())) {
-        IncHistory(pv[0], depth);
+        pos->IncHistory(pv[0], depth);
+      }
+      if (best > orig_alpha) {
+        assert(pvNode);
+        assert(pvDepth == depth);
+        StoreEntry(entry, pv[0], best, pvDepth,
+            HashEntry::ExactScore,
+            (((depthChange > 0) ? HashEntry::Extended : 0) |
+             HashEntry::FromPV));
+      }
+      else {
+        assert(alpha == orig_alpha);
+        StoreEntry(entry, pv[0], alpha, pvDepth,
+            HashEntry::UpperBound,
+            (((depthChange > 0) ? HashEntry::Extended : 0) |
+             (pvNode ? HashEntry::FromPV : 0)));
+      }
+    }
+
+    return best;
+  }
+
+  //---------------------------------------------------------------------------
+  // hand the remaining moves of this node to any idle helper threads and
+  // search them together, returns false if no helper could be had
+  //---------------------------------------------------------------------------
+  template<NodeType type, Color color>
+  bool Split(int& alpha, const int beta, const int depth, int& best,
+             int& pvDepth, const Move& firstMove)
+  {
+    SplitPoint sp;
+    sp.parent    = pos->split;
+    sp.node      = this;
+    sp.firstMove = firstMove;
+    sp.pvNode    = (type == PV);
+    sp.depth     = depth;
+    sp.alpha     = alpha;
+    sp.beta      = beta;
+    sp.best      = best;
+    sp.pvDepth   = pvDepth;
+    sp.workers   = 1;
+    sp.cutoff    = false;
+
+    const int helpers = ctx->AssignHelpers(sp, *pos);
+    if (!helpers) {
+      return false;
+    }
+
+    pos->stats.splitPoints++;
+    pos->stats.splitHelpers += helpers;
+    pos->split = &sp;
+    SearchSplit<type, color>(sp);
+    pos->split = sp.parent;
+
+    // wait for the helpers to finish their last move
+    sp.lock.Lock();
+    sp.workers--;
+    sp.lock.Unlock();
+    for (int spins = 0; sp.workers > 0; ) {
+      Backoff(spins);
+    }
+
+    alpha   = sp.alpha;
+    best    = sp.best;
+    pvDepth = sp.pvDepth;
+    return true;
+  }
+
+  //---------------------------------------------------------------------------
+  // search moves of a split point until there are none left or one of them
+  // fails high, run by the owner and each helper on its own copy of the node
+  //---------------------------------------------------------------------------
+  template<NodeType type, Color color>
+  void SearchSplit(SplitPoint& sp) {
+    assert(sp.node->ply == ply);
+    assert(pos->split == &sp);
+
+    const bool pvNode = (type == PV);
+    const int  depth  = sp.depth;
+    const int  beta   = sp.beta;
+    const bool lmrOK  = ((!pvNode) & (depth > 2) & (!checks));
+    const Move* next;
+    Move move;
+    int alpha;
+    int eval;
+
+    while (true) {
+      sp.lock.Lock();
+      next = NULL;
+      if (!sp.cutoff) {
+        while ((next = sp.node->GetNextMove()) && (sp.firstMove == *next)) { }
+        if (next) {
+          move = *next;
+        }
+      }
+      alpha = sp.alpha;
+      sp.lock.Unlock();
+      if (!next) {
+        break;
+      }
+
+      assert(move.IsValid());
+      pos->stats.lateMoves++;
+      Exec<color, true>(move, *child);
+
+      // late move reductions
+      int d = (depth - 1);
+      if (lmrOK) {
+        pos->stats.lmCandidates++;
+        if (!(move.IsCapOrPromo() | IsKiller(move) | child->checks) &&
+            (pos->hist[move.TypeToIndex()] < depth))
+        {
+          pos->stats.lmReductions++;
+          d -= (1 + (pos->hist[move.TypeToIndex()] < 0));
+        }
+      }
+
+      // null window first, then re-search if it improves alpha
+      eval = (d > 0)
+          ? -child->Search<NonPV, !color>(-(alpha + 1), -alpha, d, true)
+          : -child->QSearch<!color>(-(alpha + 1), -alpha, 0);
+      if ((eval > alpha) && !Aborted()) {
+        pos->stats.lmAlphaIncs++;
+        if (pvNode) {
+          pos->stats.lmResearches++;
+          eval = (d > 0)
+              ? -child->Search<PV, !color>(-beta, -alpha, d, false)
+              : -child->QSearch<!color>(-beta, -alpha, 0);
+        }
+        else if (d < (depth - 1)) {
+          pos->stats.lmResearches++;
+          d = (depth - 1);
+          eval = -child->Search<NonPV, !color>(-beta, -alpha, d, false);
+        }
+        pos->stats.lmConfirmed += (eval > alpha);
       }
-      if (best > orig_alpha) {
-        assert(pvNode);
-        assert(pvDepth == depth);
-        entry->Set(positionKey, pv[0], best, ply, pvDepth,
-            HashEntry::ExactScore,
-            (((depthChange > 0) ? HashEntry::Extended : 0) |
-             HashEntry::FromPV));
+
+      Undo<color>(move);
+      if (Aborted()) {
+        break;
       }
-      else {
-        assert(alpha == orig_alpha);
-        entry->Set(positionKey, pv[0], alpha, ply, pvDepth,
-            HashEntry::UpperBound,
-            (((depthChange > 0) ? HashEntry::Extended : 0) |
-             (pvNode ? HashEntry::FromPV : 0)));
+
+      sp.lock.Lock();
+      if (!sp.cutoff) {
+        if (eval > sp.best) {
+          sp.best = eval;
+          sp.pvDepth = (depth + std::min<int>(0, child->depthChange));
+          sp.node->UpdatePV(move, child);
+          if (eval >= beta) {
+            pos->stats.splitCutoffs++;
+            sp.cutoff = true;
+          }
+        }
+        if (eval > sp.alpha) {
+          sp.alpha = eval;
+        }
+        else if (!(checks | move.IsCapOrPromo())) {
+          pos->DecHistory(move);
+        }
       }
+      sp.lock.Unlock();
     }
-
-    return best;
   }
 
+  //---------------------------------------------------------------------------
+  // helper threads (helper > 0) run the same iterative deepening loop as the
+  // main thread but don't produce any output, they only feed the shared ctx->tt
   //---------------------------------------------------------------------------
   template<Color color>
-  std::string SearchRoot(const int depth) {
+  std::string SearchRoot(const int depth, const int helper = 0) {
     assert(!parent);
     assert(child);
     assert(!ply);
+    assert(helper >= 0);
 
     // TODO disable timer
 
     GenerateMoves<color, false>(depth);
     if (moveCount <= 0) {
-      senjo::Output() << "No legal moves";
+      if (!helper) {
+        senjo::Output() << "No legal moves";
+      }
       return std::string();
     }
 
@@ -4305,24 +5436,28 @@ struct Node
     std::stable_sort(moves, (moves + moveCount), Move::ScoreCompare);
 
     // move transposition table move (if any) to front of list
-    HashEntry* entry = _tt.Get(positionKey);
+    HashEntry stored;
+    HashEntry* entry = ProbeTT(stored);
     assert(entry);
-    if (entry->Key() == positionKey) {
-      _tt.IncHits();
+    if (stored.Key() == TTKey()) {
       if (moveCount > 1) {
         Move ttMove;
-        switch (entry->GetPrimaryFlag()) {
+        switch (stored.GetPrimaryFlag()) {
         case HashEntry::Checkmate:
-          senjo::Output() << "CHECKMATE";
+          if (!helper) {
+            senjo::Output() << "CHECKMATE";
+          }
           return std::string();
         case HashEntry::Stalemate:
-          senjo::Output() << "STALEMATE";
+          if (!helper) {
+            senjo::Output() << "STALEMATE";
+          }
           return std::string();
         case HashEntry::UpperBound:
         case HashEntry::ExactScore:
         case HashEntry::LowerBound:
-          ttMove.Init(entry->MoveBits(), entry->Score(ply));
-          assert(ValidateMove<color>(ttMove) == 0);
+          ttMove.Init(stored.MoveBits(), stored.Score(ply));
+          assert(!ttMove || (ValidateMove<color>(ttMove) == 0));
           for (int i = 0; i < moveCount; ++i) {
             if (moves[i] == ttMove) {
               ScootMoveToFront(i);
@@ -4340,41 +5475,55 @@ struct Node
 
     // return immediately if we only have one move
     if (moveCount == 1) {
-      OutputPV(0);
+      if (!helper) {
+        OutputPV(0);
+      }
       return pv[0].ToString();
     }
 
     Move* move;
-    bool  showPV = true;
+    Move  lastBest = pv[0];
+    bool  showPV = !helper;
+    bool  failLow;
     int   alpha = -Infinity;
     int   beta;
     int   delta;
     int   score;
+    int   movenum;
+    int   changes;
+    int   stable = 0;
 
-    // iterative deepening
-    for (int d = 0; !_stop && (d < depth); ++d) {
+    // iterative deepening, every other helper starts one ply deeper
+    for (int d = (helper & 1); !ctx->stop && (d < depth); ++d) {
       // TODO enable timer if d > 0
 
-      _seldepth = _depth = (d + 1);
-      delta = (_depth < AspirationDepth) ? HugeDelta : 16;
+      const int iterDepth = (d + 1);
+      failLow = false;
+      changes = 0;
+      pos->seldepth = iterDepth;
+      if (!helper) {
+        ctx->depth = iterDepth;
+      }
+      delta = (iterDepth < AspirationDepth) ? HugeDelta : 16;
       beta  = std::min<int>((alpha + delta), +Infinity);
       alpha = std::max<int>((alpha - delta), -Infinity);
 
-      for (moveIndex = 0; !_stop && (moveIndex < moveCount); ++moveIndex) {
+      for (moveIndex = 0; !ctx->stop && (moveIndex < moveCount); ++moveIndex) {
         move = (moves + moveIndex);
         assert(ValidateMove<color>(*move) == 0);
-        assert(d == (_depth - 1));
-
-        _currmove = move->ToString();
-        _movenum  = (moveIndex + 1);
+        movenum = (moveIndex + 1);
+        if (!helper) {
+          ctx->currmove = move->ToString();
+          ctx->movenum  = movenum;
+        }
 
-        Exec<color>(*move, *child);
+        Exec<color, true>(*move, *child);
         score = (d > 0)
-            ? ((_movenum == 1)
+            ? ((movenum == 1)
                ? -child->Search<   PV, !color>(-beta, -alpha, d, false)
                : -child->Search<NonPV, !color>(-beta, -alpha, d, true))
             : -child->QSearch<!color>(-beta, -alpha, 0);
-        if (_stop) {
+        if (ctx->stop) {
           Undo<color>(*move);
           break;
         }
@@ -4382,24 +5531,28 @@ struct Node
         move->SetScore(score);
 
         // re-search it to get real score?
-        while ((score >= beta) | ((score <= alpha) & (_movenum == 1))) {
+        while ((score >= beta) | ((score <= alpha) & (movenum == 1))) {
           if (score >= beta) {
-            OutputPV(score, 1); // report lowerbound
+            if (!helper) {
+              OutputPV(score, 1); // report lowerbound
+            }
             beta = std::min<int>(Infinity, (score + delta));
           }
-          else if (_movenum == 1) {
-            OutputPV(score, -1); // report upperbound
+          else if (movenum == 1) {
+            if (!helper) {
+              OutputPV(score, -1); // report upperbound
+            }
             alpha = std::max<int>(-Infinity, (score - delta));
+            failLow = (d > 0);
           }
           else {
             beta = std::min<int>(Infinity, (score + delta));
           }
-          // TODO: increase time
           score = (d > 0)
               ? -child->Search<PV, !color>(-beta, -alpha, d, false)
               : -child->QSearch<!color>(-beta, -alpha, 0);
           assert(abs(score) < Infinity);
-          if (_stop) {
+          if (ctx->stop) {
             break;
           }
           move->SetScore(score);
@@ -4411,13 +5564,16 @@ struct Node
         assert(abs(move->GetScore()) < Infinity);
 
         // do we have a new principal variation?
-        if ((_movenum == 1) | (move->GetScore() > alpha)) {
+        if ((movenum == 1) | (move->GetScore() > alpha)) {
+          changes += ((movenum > 1) & (d > 0));
           alpha = move->GetScore();
           UpdatePV(*move);
-          OutputPV(alpha);
+          if (!helper) {
+            OutputPV(alpha);
+          }
           showPV = false;
-          if (!_stop) {
-            entry->Set(positionKey, *move, alpha, ply, _depth,
+          if (!ctx->stop) {
+            StoreEntry(entry, *move, alpha, iterDepth,
                        HashEntry::ExactScore,
                        HashEntry::FromPV);
           }
@@ -4425,9 +5581,24 @@ struct Node
         }
 
         // set null aspiration window now that we have a principal variation
-        delta = (_depth < AspirationDepth) ? HugeDelta : 16;
+        delta = (iterDepth < AspirationDepth) ? HugeDelta : 16;
         beta = (alpha + 1);
       }
+
+      // spend more time when the best move is unsettled, less when it isn't,
+      // and don't start an iteration that probably can't finish in time
+      if (!helper && ctx->softTime && !ctx->stop) {
+        stable = (pv[0] == lastBest) ? (stable + 1) : 0;
+        lastBest = pv[0];
+        ctx->timePct = (100 + (failLow ? 100 : 0) +
+                        (40 * std::min<int>(changes, 3)) -
+                        (10 * std::min<int>(stable, 5)));
+        if (!ctx->pondering &&
+            ((2 * (senjo::Now() - ctx->startTime)) >= ctx->SoftLimit()))
+        {
+          break;
+        }
+      }
     }
 
     if (showPV) {
@@ -4439,26 +5610,426 @@ struct Node
 };
 
 //-----------------------------------------------------------------------------
-Node _node[MaxPlies];
+struct SearchThread
+{
+  //---------------------------------------------------------------------------
+  SearchThread(SearchContext* ctx, const int id)
+    : id(id),
+      idle(false),
+      work(NULL)
+  {
+    for (int i = 0; i < MaxPlies; ++i) {
+      Node* n = (node + i);
+      n->ctx = ctx;
+      n->pos = &pos;
+      n->parent = (i ? (n - 1) : NULL);
+      n->child = (((i + 1) < MaxPlies) ? (n + 1) : NULL);
+      n->ply = i;
+    }
+    pos.pawnTT.Resize(ctx->pawnHashSize);
+  }
+
+  //---------------------------------------------------------------------------
+  void ClearSearchData() {
+    pos.pawnTT.Clear();
+    memset(pos.hist, 0, sizeof(pos.hist));
+    for (int i = 0; i < MaxPlies; ++i) {
+      node[i].ClearKillers();
+    }
+  }
+
+  //---------------------------------------------------------------------------
+  static void Run(void* param) {
+    SearchThread* helper = static_cast<SearchThread*>(param);
+    assert(helper && (helper->id > 0));
+    if (COLOR(helper->node->state)) {
+      helper->node->SearchRoot<Black>(MaxPlies, helper->id);
+    }
+    else {
+      helper->node->SearchRoot<White>(MaxPlies, helper->id);
+    }
+  }
+
+  //---------------------------------------------------------------------------
+  void SearchSplit(SplitPoint& sp) {
+    Node* n = (node + sp.node->ply);
+    pos.split = &sp;
+    if (COLOR(n->state)) {
+      if (sp.pvNode) {
+        n->SearchSplit<PV, Black>(sp);
+      }
+      else {
+        n->SearchSplit<NonPV, Black>(sp);
+      }
+    }
+    else {
+      if (sp.pvNode) {
+        n->SearchSplit<PV, White>(sp);
+      }
+      else {
+        n->SearchSplit<NonPV, White>(sp);
+      }
+    }
+    pos.split = NULL;
+
+    // the owner may return (destroying sp) as soon as workers hits zero
+    sp.lock.Lock();
+    sp.workers--;
+    sp.lock.Unlock();
+  }
+
+  //---------------------------------------------------------------------------
+  void RunPerftJobs() {
+    SearchContext* ctx = node->ctx;
+    while (!ctx->stop) {
+      PerftJob* job = NULL;
+      ctx->splitLock.Lock();
+      if (ctx->perftNext < ctx->perftJobs.size()) {
+        job = &ctx->perftJobs[ctx->perftNext++];
+      }
+      ctx->splitLock.Unlock();
+      if (!job) {
+        break;
+      }
+      job->count = COLOR(node->state)
+          ? node->PerftLine<Black>(job->line, job->moves, job->depth,
+                                   job->qperft)
+          : node->PerftLine<White>(job->line, job->moves, job->depth,
+                                   job->qperft);
+    }
+  }
+
+  //---------------------------------------------------------------------------
+  static void PerftWorker(void* param) {
+    SearchThread* helper = static_cast<SearchThread*>(param);
+    assert(helper && (helper->id > 0));
+    helper->RunPerftJobs();
+  }
+
+  //---------------------------------------------------------------------------
+  // YBW helpers sit here until the main thread is done, joining whatever
+  // split points they are assigned to by SearchContext::AssignHelpers()
+  //---------------------------------------------------------------------------
+  static void Idle(void* param) {
+    SearchThread* helper = static_cast<SearchThread*>(param);
+    assert(helper && (helper->id > 0));
+    SearchContext* ctx = helper->node->ctx;
+    int spins = 0;
+    while (true) {
+      if (helper->work) {
+        // wait for the owner to finish setting up our copy of the split node
+        ctx->splitLock.Lock();
+        SplitPoint* sp = helper->work;
+        ctx->splitLock.Unlock();
+
+        helper->SearchSplit(*sp);
+
+        ctx->splitLock.Lock();
+        helper->work = NULL;
+        helper->idle = true;
+        ctx->idleThreads++;
+        ctx->splitLock.Unlock();
+        spins = 0;
+      }
+      else if (ctx->stop & HelperStop) {
+        break;
+      }
+      else {
+        Backoff(spins);
+      }
+    }
+  }
+
+  int id;
+  bool idle;
+  SplitPoint* volatile work;
+  Position pos;
+  Node node[MaxPlies];
+  senjo::Thread thread;
+};
+
+//-----------------------------------------------------------------------------
+void SearchContext::InitSearch(const Color colorToMove,
+                               const uint64_t searchStart)
+{
+  startTime = searchStart;
+  stop     &= senjo::ChessEngine::FullStop;
+  depth     = 0;
+  movenum   = 0;
+
+  currmove.clear();
+  tt.ResetCounters();
+  tt.NextAge();
+
+  for (size_t i = 0; i < threads.size(); ++i) {
+    threads[i]->pos.seldepth = 0;
+    threads[i]->pos.stats.Clear();
+  }
+
+  drawScore[colorToMove] = 0; // TODO -_contempt;
+  drawScore[!colorToMove] = 0; // TODO _contempt;
+}
+
+//-----------------------------------------------------------------------------
+// clock is the time remaining for the side to move, 0 = not playing on a clock
+//-----------------------------------------------------------------------------
+void SearchContext::SetTimeLimits(const int movestogo, const uint64_t movetime,
+                                  const uint64_t clock, const uint64_t inc,
+                                  const int defaultMovesToGo)
+{
+  const uint64_t overhead = static_cast<uint64_t>(moveOverhead);
+
+  softTime = 0;
+  hardTime = 0;
+  timePct  = 100;
+
+  if (movetime) {
+    hardTime = ((movetime > overhead) ? (movetime - overhead) : 1);
+  }
+
+  if (clock) {
+    const uint64_t avail = ((clock > overhead) ? (clock - overhead) : 1);
+    const int moves = (movestogo > 0) ? movestogo : defaultMovesToGo;
+    const uint64_t most = (moves > 1) ? (avail / 2) : ((avail * 9) / 10);
+    const uint64_t soft = ((avail / std::max<int>(1, moves)) + ((inc * 3) / 4));
+    const uint64_t hard = std::max<uint64_t>(1, std::min((soft * 4), most));
+    if (!hardTime || (hard < hardTime)) {
+      hardTime = hard;
+    }
+    softTime = std::min(soft, hardTime);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void SearchContext::SetThreadCount(const int count) {
+  assert((count >= 0) & (count <= MaxThreads));
+  while (static_cast<int>(threads.size()) < count) {
+    const int id = static_cast<int>(threads.size());
+    threads.push_back(new SearchThread(this, id));
+  }
+  while (static_cast<int>(threads.size()) > count) {
+    delete threads.back();
+    threads.pop_back();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void SearchContext::StartHelpers() {
+  assert(!threads.empty());
+  const SearchThread* mainThread = threads[0];
+  for (size_t i = 1; i < threads.size(); ++i) {
+    SearchThread* helper = threads[i];
+    if (ybw) {
+      helper->work = NULL;
+      helper->idle = true;
+      idleThreads++;
+      helper->thread.Start(SearchThread::Idle, helper);
+    }
+    else {
+      helper->pos.CopyBoard(mainThread->pos);
+      helper->node->CopyState(*mainThread->node);
+      helper->thread.Start(SearchThread::Run, helper);
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+void SearchContext::StopHelpers() {
+  stop |= HelperStop;
+  for (size_t i = 1; i < threads.size(); ++i) {
+    threads[i]->thread.Join();
+    threads[i]->idle = false;
+  }
+  idleThreads = 0;
+}
+
+//-----------------------------------------------------------------------------
+// give each idle helper a copy of the split node, returns number of helpers
+//-----------------------------------------------------------------------------
+int SearchContext::AssignHelpers(SplitPoint& sp, const Position& pos) {
+  int count = 0;
+  splitLock.Lock();
+  for (size_t i = 1; (i < threads.size()) & (idleThreads > 0); ++i) {
+    SearchThread* helper = threads[i];
+    if (helper->idle) {
+      Node* n = (helper->node + sp.node->ply);
+      helper->pos.CopyBoard(pos);
+      n->CopyState(*sp.node);
+      n->depthChange = sp.node->depthChange;
+      helper->idle = false;
+      helper->work = &sp;
+      idleThreads--;
+      sp.workers++;
+      count++;
+    }
+  }
+  splitLock.Unlock();
+  return count;
+}
+
+//-----------------------------------------------------------------------------
+// every thread works through perftJobs on its own copy of the root position
+//-----------------------------------------------------------------------------
+void SearchContext::RunPerftJobs() {
+  assert(!threads.empty());
+  SearchThread* mainThread = threads[0];
+  perftNext = 0;
+  for (size_t i = 1; i < threads.size(); ++i) {
+    SearchThread* helper = threads[i];
+    helper->pos.CopyBoard(mainThread->pos);
+    helper->node->CopyState(*mainThread->node);
+    helper->thread.Start(SearchThread::PerftWorker, helper);
+  }
+  mainThread->RunPerftJobs();
+  for (size_t i = 1; i < threads.size(); ++i) {
+    threads[i]->thread.Join();
+  }
+}
+
+//-----------------------------------------------------------------------------
+// allocate a new transposition table without holding up the caller, the old
+// one stays in use until ApplyResize() swaps the new one in
+//-----------------------------------------------------------------------------
+void SearchContext::ResizeHash(const size_t mbytes) {
+  resizeLock.Lock();
+  resizeThread.Join();
+  resizeDone = false;
+  hashSize = mbytes;
+  if (!resizeThread.Start(ResizeWorker, this)) {
+    ResizeWorker(this);
+  }
+  resizeLock.Unlock();
+}
+
+//-----------------------------------------------------------------------------
+void SearchContext::ResizeWorker(void* param) {
+  assert(param);
+  SearchContext* ctx = static_cast<SearchContext*>(param);
+  ctx->nextTT.Resize(ctx->hashSize);
+  ctx->resizeDone = true;
+}
+
+//-----------------------------------------------------------------------------
+// call between searches only, returns true if a resized table was swapped in
+//-----------------------------------------------------------------------------
+bool SearchContext::ApplyResize() {
+  if (!resizeDone) {
+    return false;
+  }
+  resizeLock.Lock();
+  const bool ready = resizeDone;
+  if (ready) {
+    resizeThread.Join();
+    resizeDone = false;
+    tt.Swap(nextTT);
+    nextTT.Free();
+  }
+  resizeLock.Unlock();
+  if (ready) {
+    PrintHashSize();
+  }
+  return ready;
+}
+
+//-----------------------------------------------------------------------------
+// discard a table being resized in the background
+//-----------------------------------------------------------------------------
+void SearchContext::CancelResize() {
+  resizeLock.Lock();
+  resizeThread.Join();
+  resizeDone = false;
+  nextTT.Free();
+  resizeLock.Unlock();
+}
+
+//-----------------------------------------------------------------------------
+// set up the transposition table according to hashSize and hashShare
+//-----------------------------------------------------------------------------
+bool SearchContext::InitHash() {
+  CancelResize();
+  bool ok = true;
+  if (hashShare.size() &&
+      !tt.Attach(('/' + hashShare).c_str(), hashSize, HashKeySignature()))
+  {
+    hashShare.clear();
+    ok = false;
+  }
+  if (hashShare.empty()) {
+    tt.Resize(hashSize);
+  }
+  PrintHashSize();
+  return ok;
+}
+
+//-----------------------------------------------------------------------------
+void SearchContext::PrintHashSize() const {
+  senjo::Output() << "Hash " << (tt.Bytes() / (1024 * 1024)) << " MB using "
+                  << tt.PageType();
+}
 
 //-----------------------------------------------------------------------------
-void InitNodes() {
-  for (int i = 0; i < MaxPlies; ++i) {
-    Node* node = (_node + i);
-    node->parent = (i ? (node - 1) : NULL);
-    node->child = (((i + 1) < MaxPlies) ? (node + 1) : NULL);
-    node->ply = i;
+uint64_t SearchContext::NodeCount() const {
+  uint64_t count = 0;
+  for (size_t i = 0; i < threads.size(); ++i) {
+    const Stats& stats = threads[i]->pos.stats;
+    count += (stats.snodes + stats.qnodes);
   }
+  return count;
+}
+
+//-----------------------------------------------------------------------------
+// the stats of all search threads combined into one sample
+//-----------------------------------------------------------------------------
+Stats SearchContext::ThreadStats() const {
+  Stats stats;
+  for (size_t i = 0; i < threads.size(); ++i) {
+    const Position& pos = threads[i]->pos;
+    stats += pos.stats;
+    stats.ptGets += pos.pawnTT.Gets();
+    stats.ptHits += pos.pawnTT.Hits();
+  }
+  stats.statCount = 1;
+  return stats;
+}
+
+//-----------------------------------------------------------------------------
+// the lookup tables never change once they're built, so they are shared by
+// all engine instances and only built once
+//-----------------------------------------------------------------------------
+void InitTables() {
+  static senjo::Mutex mutex;
+  static bool initialized = false;
+  mutex.Lock();
+  if (!initialized) {
+    InitDistDir();
+    InitMoveMaps();
+    InitSliderAttacks();
+    initialized = true;
+  }
+  mutex.Unlock();
+}
+
+//-----------------------------------------------------------------------------
+// Lazy = helpers search the whole tree sharing only the transposition table
+// YBW  = helpers join nodes whose first move has already been searched
+//-----------------------------------------------------------------------------
+static std::set<std::string> SMPModes() {
+  std::set<std::string> modes;
+  modes.insert("Lazy");
+  modes.insert("YBW");
+  return modes;
 }
 
 //-----------------------------------------------------------------------------
 Clunk::Clunk()
-  : root(NULL)
+  : root(NULL),
+    context(new SearchContext)
 {
 }
 
 //-----------------------------------------------------------------------------
 Clunk::~Clunk() {
+  delete context;
 }
 
 //-----------------------------------------------------------------------------
@@ -4467,9 +6038,98 @@ bool Clunk::IsInitialized() const {
 }
 
 //-----------------------------------------------------------------------------
-bool Clunk::SetEngineOption(const std::string& /*optionName*/,
-                            const std::string& /*optionValue*/)
+bool Clunk::SetEngineOption(const std::string& optionName,
+                            const std::string& optionValue)
 {
+  if (!stricmp(optionName.c_str(), "Threads")) {
+    senjo::EngineOption opt("Threads", "1", senjo::EngineOption::Spin,
+                            1, MaxThreads);
+    if (!opt.SetValue(optionValue)) {
+      return false;
+    }
+    context->threadCount = static_cast<int>(opt.GetIntValue());
+    if (root) {
+      context->SetThreadCount(context->threadCount);
+    }
+    return true;
+  }
+  if (!stricmp(optionName.c_str(), "SMP")) {
+    senjo::EngineOption opt("SMP", "Lazy", senjo::EngineOption::ComboBox,
+                            INT64_MIN, INT64_MAX, SMPModes());
+    if (!opt.SetValue(optionValue)) {
+      return false;
+    }
+    context->ybw = (opt.GetValue() == "YBW");
+    return true;
+  }
+  if (!stricmp(optionName.c_str(), "MoveOverhead")) {
+    senjo::EngineOption opt("MoveOverhead", std::to_string(DefaultMoveOverhead),
+                            senjo::EngineOption::Spin, 0, MaxMoveOverhead);
+    if (!opt.SetValue(optionValue)) {
+      return false;
+    }
+    context->moveOverhead = static_cast<int>(opt.GetIntValue());
+    return true;
+  }
+  if (!stricmp(optionName.c_str(), "Hash")) {
+    senjo::EngineOption opt("Hash", std::to_string(DefaultHashSize),
+                            senjo::EngineOption::Spin, 1, MaxHashSize);
+    if (!opt.SetValue(optionValue)) {
+      return false;
+    }
+    const size_t mbytes = static_cast<size_t>(opt.GetIntValue());
+    if (!root || context->tt.Shared()) {
+      // a shared table keeps the size it was created with
+      context->hashSize = mbytes;
+    }
+    else if (mbytes != context->hashSize) {
+      context->ResizeHash(mbytes);
+    }
+    return true;
+  }
+  if (!stricmp(optionName.c_str(), "PawnHash")) {
+    senjo::EngineOption opt("PawnHash", std::to_string(DefaultPawnHashSize),
+                            senjo::EngineOption::Spin, 1, MaxPawnHashSize);
+    if (!opt.SetValue(optionValue)) {
+      return false;
+    }
+    const size_t mbytes = static_cast<size_t>(opt.GetIntValue());
+    if (mbytes != context->pawnHashSize) {
+      context->pawnHashSize = mbytes;
+      for (size_t i = 0; i < context->threads.size(); ++i) {
+        context->threads[i]->pos.pawnTT.Resize(mbytes);
+      }
+    }
+    return true;
+  }
+  if (!stricmp(optionName.c_str(), "HashShare")) {
+    std::string name = optionValue;
+    if (name == "<empty>") {
+      name.clear();
+    }
+    if (name.find('/') != std::string::npos) {
+      return false;
+    }
+    if (name != context->hashShare) {
+      context->hashShare = name;
+      if (root) {
+        return context->InitHash();
+      }
+    }
+    return true;
+  }
+  if (!stricmp(optionName.c_str(), "Clear Hash")) {
+    context->tt.Clear();
+    return true;
+  }
+  if (!stricmp(optionName.c_str(), "Ponder")) {
+    senjo::EngineOption opt("Ponder", "false", senjo::EngineOption::Checkbox);
+    if (!opt.SetValue(optionValue)) {
+      return false;
+    }
+    context->canPonder = (opt.GetValue() == "true");
+    return true;
+  }
   return false;
 }
 
@@ -4495,14 +6155,15 @@ const char* Clunk::MakeMove(const char* str) {
     return NULL;
   }
 
+  const Position* pos = root->pos;
   int from  = SQR(TO_X(str[0]), TO_Y(str[1]));
   int to    = SQR(TO_X(str[2]), TO_Y(str[3]));
-  int pc    = _board[from]->type;
-  int cap   = _board[to]->type;
+  int pc    = pos->board[from]->type;
+  int cap   = pos->board[to]->type;
   int promo = 0;
 
-  assert(_EMPTY->type == 0);
-  assert(cap || (_board[to] == _EMPTY));
+  assert(pos->empty->type == 0);
+  assert(cap || (pos->board[to] == pos->empty));
 
   const Color color = COLOR(root->state);
   const char* p = (str + 4);
@@ -4549,10 +6210,10 @@ const char* Clunk::MakeMove(const char* str) {
   }
 
   if (color) {
-    root->Exec<Black>(root->moves[root->moveIndex], *root);
+    root->Exec<Black, false>(root->moves[root->moveIndex], *root);
   }
   else {
-    root->Exec<White>(root->moves[root->moveIndex], *root);
+    root->Exec<White, false>(root->moves[root->moveIndex], *root);
   }
 
   return p;
@@ -4565,17 +6226,8 @@ const char* Clunk::SetPosition(const char* fen) {
     return NULL;
   }
 
-  _seenIndex = 0;
-  memset(_kingDir, 0, sizeof(_kingDir));
-  memset(_board, 0, sizeof(_board));
-  memset(_piece, 0, sizeof(_piece));
-  memset(_pcount, 0, sizeof(_pcount));
-  memset(_material, 0, sizeof(_material));
-  memset(_atk, 0, sizeof(_atk));
-  memset(_seen, 0, sizeof(_seen));
-  memset(_seenFilter, 0, sizeof(_seenFilter));
-
-  _board[None] = _EMPTY;
+  Position* pos = root->pos;
+  pos->Clear();
 
   root->state = 0;
   root->ep = None;
@@ -4600,121 +6252,121 @@ const char* Clunk::SetPosition(const char* fen) {
           senjo::Output() << "Invalid empty square count at " << p;
           return NULL;
         }
-        _board[SQR(x,y)] = _EMPTY;
+        pos->board[SQR(x,y)] = pos->empty;
         for (int n = (*p - '1'); n; --n) {
           ++x;
-          _board[SQR(x,y)] = _EMPTY;
+          pos->board[SQR(x,y)] = pos->empty;
         }
       }
       else {
         const int sqr = SQR(x,y);
         assert(IS_SQUARE(sqr));
-        _board[sqr] = _EMPTY;
+        pos->board[sqr] = pos->empty;
         switch (*p) {
         case 'b':
-          if (_pcount[Black|Bishop] >= 10) {
+          if (pos->pcount[Black|Bishop] >= 10) {
             senjo::Output() << "Too many black bishops";
             return NULL;
           }
-          AddPiece((Black|Bishop), sqr);
-          _material[Black] += BishopValue;
+          pos->AddPiece((Black|Bishop), sqr);
+          pos->material[Black] += BishopValue;
           root->pieceKey ^= _HASH[Black|Bishop][sqr];
           break;
         case 'B':
-          if (_pcount[White|Bishop] >= 10) {
+          if (pos->pcount[White|Bishop] >= 10) {
             senjo::Output() << "Too many white bishops";
             return NULL;
           }
-          AddPiece((White|Bishop), sqr);
-          _material[White] += BishopValue;
+          pos->AddPiece((White|Bishop), sqr);
+          pos->material[White] += BishopValue;
           root->pieceKey ^= _HASH[White|Bishop][sqr];
           break;
         case 'k':
-          if (_piece[BlackKingOffset].type) {
+          if (pos->piece[BlackKingOffset].type) {
             senjo::Output() << "Multiple black kings";
             return NULL;
           }
-          AddPiece((Black|King), sqr);
+          pos->AddPiece((Black|King), sqr);
           root->pieceKey ^= _HASH[Black|King][sqr];
           break;
         case 'K':
-          if (_piece[WhiteKingOffset].type) {
+          if (pos->piece[WhiteKingOffset].type) {
             senjo::Output() << "Multiple white kings";
             return NULL;
           }
-          AddPiece((White|King), sqr);
+          pos->AddPiece((White|King), sqr);
           root->pieceKey ^= _HASH[White|King][sqr];
           break;
         case 'n':
-          if (_pcount[Black|Knight] >= 10) {
+          if (pos->pcount[Black|Knight] >= 10) {
             senjo::Output() << "Too many black knights";
             return NULL;
           }
-          AddPiece((Black|Knight), sqr);
-          _material[Black] += KnightValue;
+          pos->AddPiece((Black|Knight), sqr);
+          pos->material[Black] += KnightValue;
           root->pieceKey ^= _HASH[Black|Knight][sqr];
           break;
         case 'N':
-          if (_pcount[White|Knight] >= 10) {
+          if (pos->pcount[White|Knight] >= 10) {
             senjo::Output() << "Too many white knights";
             return NULL;
           }
-          AddPiece((White|Knight), sqr);
-          _material[White] += KnightValue;
+          pos->AddPiece((White|Knight), sqr);
+          pos->material[White] += KnightValue;
           root->pieceKey ^= _HASH[White|Knight][sqr];
           break;
         case 'p':
-          if (_pcount[Black|Pawn] >= 8) {
+          if (pos->pcount[Black|Pawn] >= 8) {
             senjo::Output() << "Too many black pawns";
             return NULL;
           }
-          AddPiece((Black|Pawn), sqr);
-          _material[Black] += PawnValue;
+          pos->AddPiece((Black|Pawn), sqr);
+          pos->material[Black] += PawnValue;
           root->pawnKey ^= _HASH[Black|Pawn][sqr];
           break;
         case 'P':
-          if (_pcount[White|Pawn] >= 8) {
+          if (pos->pcount[White|Pawn] >= 8) {
             senjo::Output() << "Too many white pawns";
             return NULL;
           }
-          AddPiece((White|Pawn), sqr);
-          _material[White] += PawnValue;
+          pos->AddPiece((White|Pawn), sqr);
+          pos->material[White] += PawnValue;
           root->pawnKey ^= _HASH[White|Pawn][sqr];
           break;
         case 'q':
-          if (_pcount[Black|Queen] >= 9) {
+          if (pos->pcount[Black|Queen] >= 9) {
             senjo::Output() << "Too many black queens";
             return NULL;
           }
-          AddPiece((Black|Queen), sqr);
-          _material[Black] += QueenValue;
+          pos->AddPiece((Black|Queen), sqr);
+          pos->material[Black] += QueenValue;
           root->pieceKey ^= _HASH[Black|Queen][sqr];
           break;
         case 'Q':
-          if (_pcount[White|Queen] >= 9) {
+          if (pos->pcount[White|Queen] >= 9) {
             senjo::Output() << "Too many white queens";
             return NULL;
           }
-          AddPiece((White|Queen), sqr);
-          _material[White] += QueenValue;
+          pos->AddPiece((White|Queen), sqr);
+          pos->material[White] += QueenValue;
           root->pieceKey ^= _HASH[White|Queen][sqr];
           break;
         case 'r':
-          if (_pcount[Black|Rook] >= 10) {
+          if (pos->pcount[Black|Rook] >= 10) {
             senjo::Output() << "Too many black rooks";
             return NULL;
           }
-          AddPiece((Black|Rook), sqr);
-          _material[Black] += RookValue;
+          pos->AddPiece((Black|Rook), sqr);
+          pos->material[Black] += RookValue;
           root->pieceKey ^= _HASH[Black|Rook][sqr];
           break;
         case 'R':
-          if (_pcount[White|Rook] >= 10) {
+          if (pos->pcount[White|Rook] >= 10) {
             senjo::Output() << "Too many hite rooks";
             return NULL;
           }
-          AddPiece((White|Rook), sqr);
-          _material[White] += RookValue;
+          pos->AddPiece((White|Rook), sqr);
+          pos->material[White] += RookValue;
           root->pieceKey ^= _HASH[White|Rook][sqr];
           break;
         default:
@@ -4738,58 +6390,58 @@ const char* Clunk::SetPosition(const char* fen) {
     }
   }
 
-  if (_piece[WhiteKingOffset].type != (White|King)) {
+  if (pos->piece[WhiteKingOffset].type != (White|King)) {
     senjo::Output() << "No white king in this position";
     return NULL;
   }
-  if (_piece[BlackKingOffset].type != (Black|King)) {
+  if (pos->piece[BlackKingOffset].type != (Black|King)) {
     senjo::Output() << "No black king in this position";
     return NULL;
   }
 
-  SetKingDirs<White>(_KING[White]->sqr);
-  SetKingDirs<Black>(_KING[Black]->sqr);
+  pos->SetKingDirs<White>(pos->king[White]->sqr);
+  pos->SetKingDirs<Black>(pos->king[Black]->sqr);
 
   int from;
-  for (int i = 0; i < _pcount[White|Bishop]; ++i) {
-    from = _piece[BishopOffset + i].sqr;
-    AddAttacksFrom((White|Bishop), from);
+  for (int i = 0; i < pos->pcount[White|Bishop]; ++i) {
+    from = pos->piece[BishopOffset + i].sqr;
+    pos->AddAttacksFrom((White|Bishop), from);
   }
-  for (int i = 0; i < _pcount[Black|Bishop]; ++i) {
-    from = _piece[BlackBishopOffset + i].sqr;
-    AddAttacksFrom((Black|Bishop), from);
+  for (int i = 0; i < pos->pcount[Black|Bishop]; ++i) {
+    from = pos->piece[BlackBishopOffset + i].sqr;
+    pos->AddAttacksFrom((Black|Bishop), from);
   }
-  for (int i = 0; i < _pcount[White|Rook]; ++i) {
-    from = _piece[RookOffset + i].sqr;
-    AddAttacksFrom((White|Rook), from);
+  for (int i = 0; i < pos->pcount[White|Rook]; ++i) {
+    from = pos->piece[RookOffset + i].sqr;
+    pos->AddAttacksFrom((White|Rook), from);
   }
-  for (int i = 0; i < _pcount[Black|Rook]; ++i) {
-    from = _piece[BlackRookOffset + i].sqr;
-    AddAttacksFrom((Black|Rook), from);
+  for (int i = 0; i < pos->pcount[Black|Rook]; ++i) {
+    from = pos->piece[BlackRookOffset + i].sqr;
+    pos->AddAttacksFrom((Black|Rook), from);
   }
-  for (int i = 0; i < _pcount[White|Queen]; ++i) {
-    from = _piece[QueenOffset + i].sqr;
-    AddAttacksFrom((White|Queen), from);
+  for (int i = 0; i < pos->pcount[White|Queen]; ++i) {
+    from = pos->piece[QueenOffset + i].sqr;
+    pos->AddAttacksFrom((White|Queen), from);
   }
-  for (int i = 0; i < _pcount[Black|Queen]; ++i) {
-    from = _piece[BlackQueenOffset + i].sqr;
-    AddAttacksFrom((Black|Queen), from);
+  for (int i = 0; i < pos->pcount[Black|Queen]; ++i) {
+    from = pos->piece[BlackQueenOffset + i].sqr;
+    pos->AddAttacksFrom((Black|Queen), from);
   }
-  assert(VerifyAttacks(true));
+  assert(pos->VerifyAttacks(true));
 
   p = NextSpace(p);
   p = NextWord(p);
   switch (*p) {
   case 'b':
     root->state |= Black;
-    if (AttackedBy<Black>(_piece[WhiteKingOffset].sqr)) {
+    if (pos->AttackedBy<Black>(pos->piece[WhiteKingOffset].sqr)) {
       senjo::Output() << "The king can be captured in this position";
       return NULL;
     }
     break;
   case 'w':
     root->state |= White;
-    if (AttackedBy<White>(_piece[BlackKingOffset].sqr)) {
+    if (pos->AttackedBy<White>(pos->piece[BlackKingOffset].sqr)) {
       senjo::Output() << "The king can be captured in this position";
       return NULL;
     }
@@ -4826,9 +6478,9 @@ const char* Clunk::SetPosition(const char* fen) {
     root->ep = SQR(x, y);
     const int sqr = (root->ep + (COLOR(root->state) ? North : South));
     if ((y != (COLOR(root->state) ? 2 : 5)) ||
-        (_board[root->ep] != _EMPTY) ||
-        (_board[sqr] == _EMPTY) ||
-        (_board[sqr]->type != ((!COLOR(root->state))|Pawn)))
+        (pos->board[root->ep] != pos->empty) ||
+        (pos->board[sqr] == pos->empty) ||
+        (pos->board[sqr]->type != ((!COLOR(root->state))|Pawn)))
     {
       senjo::Output() << "Invalid en passant square: "
                       << senjo::Square(root->ep).ToString();
@@ -4878,7 +6530,37 @@ const char* Clunk::SetPosition(const char* fen) {
 //-----------------------------------------------------------------------------
 std::list<senjo::EngineOption> Clunk::GetOptions() const {
   std::list<senjo::EngineOption> opts;
-  // TODO add options
+  opts.push_back(senjo::EngineOption("Threads", "1",
+                                     senjo::EngineOption::Spin,
+                                     1, MaxThreads));
+  opts.back().SetValue(context->threadCount);
+  opts.push_back(senjo::EngineOption("SMP", "Lazy",
+                                     senjo::EngineOption::ComboBox,
+                                     INT64_MIN, INT64_MAX, SMPModes()));
+  opts.back().SetValue(context->ybw ? "YBW" : "Lazy");
+  opts.push_back(senjo::EngineOption("MoveOverhead",
+                                     std::to_string(DefaultMoveOverhead),
+                                     senjo::EngineOption::Spin,
+                                     0, MaxMoveOverhead));
+  opts.back().SetValue(context->moveOverhead);
+  opts.push_back(senjo::EngineOption("Hash", std::to_string(DefaultHashSize),
+                                     senjo::EngineOption::Spin,
+                                     1, MaxHashSize));
+  opts.back().SetValue(context->hashSize);
+  opts.push_back(senjo::EngineOption("PawnHash",
+                                     std::to_string(DefaultPawnHashSize),
+                                     senjo::EngineOption::Spin,
+                                     1, MaxPawnHashSize));
+  opts.back().SetValue(context->pawnHashSize);
+  opts.push_back(senjo::EngineOption("HashShare", "<empty>",
+                                     senjo::EngineOption::String));
+  opts.back().SetValue(context->hashShare.size() ? context->hashShare
+                                                 : "<empty>");
+  opts.push_back(senjo::EngineOption("Clear Hash", "",
+                                     senjo::EngineOption::Button));
+  opts.push_back(senjo::EngineOption("Ponder", "false",
+                                     senjo::EngineOption::Checkbox));
+  opts.back().SetValue(context->canPonder ? "true" : "false");
   return opts;
 }
 
@@ -4917,35 +6599,52 @@ std::string Clunk::GetFEN() const {
 
 //-----------------------------------------------------------------------------
 void Clunk::ClearSearchData() {
-  _tt.Clear();
-  _pawnTT.Clear();
-  memset(_hist, 0, sizeof(_hist));
-  for (int i = 0; i < MaxPlies; ++i) {
-    _node[i].ClearKillers();
+  context->ApplyResize();
+  context->tt.Invalidate();
+  for (size_t i = 0; i < context->threads.size(); ++i) {
+    context->threads[i]->ClearSearchData();
   }
 }
 
 //-----------------------------------------------------------------------------
 void Clunk::ClearStopFlags() {
   ChessEngine::ClearStopFlags();
-  clunk::_stop = 0;
+  context->stop = 0;
 }
 
 //-----------------------------------------------------------------------------
 void Clunk::Initialize() {
-  InitNodes();
-  InitDistDir();
-  InitMoveMaps();
+  InitTables();
 
-  _tt.Resize(512); // TODO make configurable
-  _pawnTT.Resize(2); // TODO make configurable
+  context->InitHash();
 
-  root = _node;
+  context->SetThreadCount(context->threadCount);
+  root = context->threads[0]->node;
   SetPosition(_STARTPOS);
 }
 
+//-----------------------------------------------------------------------------
+senjo::ChessEngine* Clunk::NewInstance(const int instances) const {
+  Clunk* engine = new Clunk;
+  engine->context->threadCount = context->threadCount;
+  engine->context->ybw = context->ybw;
+  engine->context->moveOverhead = context->moveOverhead;
+  engine->SetDebug(IsDebugOn());
+  engine->context->hashSize =
+      std::max<size_t>(1, (context->hashSize / std::max<int>(1, instances)));
+  engine->context->pawnHashSize = context->pawnHashSize;
+  return engine;
+}
+
+//-----------------------------------------------------------------------------
+// the clock started when the ponder search did, so time already spent
+// pondering counts against the limits set by MyGo()
 //-----------------------------------------------------------------------------
 void Clunk::PonderHit() {
+  if (context->pondering) {
+    _stopTime = context->hardTime ? (_startTime + context->hardTime) : 0;
+    SetPondering(false);
+  }
 }
 
 //-----------------------------------------------------------------------------
@@ -4961,29 +6660,74 @@ void Clunk::PrintBoard() const {
 //-----------------------------------------------------------------------------
 void Clunk::Quit() {
   ChessEngine::Quit();
-  clunk::_stop |= senjo::ChessEngine::FullStop;
+  context->stop |= senjo::ChessEngine::FullStop;
 }
 
 //-----------------------------------------------------------------------------
 void Clunk::ResetStatsTotals() {
-  _totalStats.Clear();
+  context->totalStats.Clear();
 }
 
 //-----------------------------------------------------------------------------
 void Clunk::SetDebug(const bool flag) {
   ChessEngine::SetDebug(flag);
-  clunk::_debug = flag;
+  context->debug = flag;
+}
+
+//-----------------------------------------------------------------------------
+void Clunk::SetPondering(const bool flag) {
+  ChessEngine::SetPondering(flag);
+  context->pondering = flag;
+}
+
+//-----------------------------------------------------------------------------
+void Clunk::SetPerftHashSize(const size_t mbytes) {
+  if (mbytes && (mbytes != context->perftHashSize)) {
+    context->perftTT.Resize(mbytes);
+  }
+  context->perftHashSize = mbytes;
+}
+
+//-----------------------------------------------------------------------------
+bool Clunk::SaveHash(const std::string& path) {
+  if (!root) {
+    senjo::Output() << NOT_INITIALIZED;
+    return false;
+  }
+  if (!context->tt.Save(path.c_str(), HashKeySignature())) {
+    return false;
+  }
+  senjo::Output() << "Saved " << context->tt.Bytes() << " byte hash table to "
+                  << path;
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool Clunk::LoadHash(const std::string& path) {
+  if (!root) {
+    senjo::Output() << NOT_INITIALIZED;
+    return false;
+  }
+  context->CancelResize();
+  if (!context->tt.Load(path.c_str(), HashKeySignature())) {
+    return false;
+  }
+  context->hashShare.clear();
+  context->hashSize =
+      std::max<size_t>(1, (context->tt.Bytes() / (1024 * 1024)));
+  context->PrintHashSize();
+  return true;
 }
 
 //-----------------------------------------------------------------------------
 void Clunk::ShowStatsTotals() const {
-  _totalStats.Average().Print();
+  context->totalStats.Average().Print();
 }
 
 //-----------------------------------------------------------------------------
 void Clunk::Stop(const StopReason reason) {
   ChessEngine::Stop(reason);
-  clunk::_stop |= reason;
+  context->stop |= reason;
 }
 
 //-----------------------------------------------------------------------------
@@ -4997,25 +6741,28 @@ void Clunk::GetStats(int* depth,
                      const size_t movelen) const
 {
   if (depth) {
-    *depth = _depth;
+    *depth = context->depth;
   }
   if (seldepth) {
-    *seldepth = _seldepth;
+    *seldepth = (root ? root->pos->seldepth : 0);
   }
   if (nodes) {
-    *nodes = (_stats.snodes + _stats.qnodes);
+    *nodes = context->NodeCount();
   }
   if (qnodes) {
-    *qnodes = _stats.qnodes;
+    *qnodes = 0;
+    for (size_t i = 0; i < context->threads.size(); ++i) {
+      *qnodes += context->threads[i]->pos.stats.qnodes;
+    }
   }
   if (msecs) {
     *msecs = (senjo::Now() - _startTime);
   }
   if (movenum) {
-    *movenum = _movenum;
+    *movenum = context->movenum;
   }
   if (move && movelen) {
-    snprintf(move, movelen, "%s", _currmove.c_str());
+    snprintf(move, movelen, "%s", context->currmove.c_str());
   }
 }
 
@@ -5031,19 +6778,33 @@ uint64_t Clunk::MyPerft(const int depth) {
     senjo::Output() << GetFEN();
   }
 
-  InitSearch(COLOR(root->state), _startTime);
+  context->InitSearch(COLOR(root->state), _startTime);
+  context->perftTT.ResetCounters();
 
   const int d = std::min<int>(depth, MaxPlies);
   const uint64_t count = WhiteToMove() ? root->PerftSearchRoot<White>(d)
                                        : root->PerftSearchRoot<Black>(d);
 
   const uint64_t msecs = (senjo::Now() - _startTime);
+  const Stats stats = context->ThreadStats();
   senjo::Output() << "Perft " << count << ' '
                   << senjo::Rate((count / 1000), msecs) << " KLeafs/sec";
-  senjo::Output() << "Nodes " << _stats.snodes << ' '
-                  << senjo::Rate((_stats.snodes / 1000), msecs)
+  senjo::Output() << "Nodes " << stats.snodes << ' '
+                  << senjo::Rate((stats.snodes / 1000), msecs)
                   << " KNodes/sec";
 
+  // without the hash every leaf is generated at least once, so count/snodes
+  // is a lower bound on how much less work the hashed count did
+  if (context->perftHashSize) {
+    const TranspositionTable<PerftEntry>& ptt = context->perftTT;
+    senjo::Output() << "Perft hash " << ptt.Gets() << " gets, "
+                    << ptt.Hits() << " hits ("
+                    << senjo::Percent(ptt.Hits(), ptt.Gets()) << "%), "
+                    << ">= " << (static_cast<double>(count) /
+                                 std::max<uint64_t>(1, stats.snodes))
+                    << "x fewer nodes than unhashed";
+  }
+
   return count;
 }
 
@@ -5059,29 +6820,31 @@ uint64_t Clunk::MyQPerft(const int depth) {
     senjo::Output() << GetFEN();
   }
 
-  InitSearch(COLOR(root->state), _startTime);
+  context->InitSearch(COLOR(root->state), _startTime);
 
   const int d = std::min<int>(depth, MaxPlies);
   const uint64_t count = WhiteToMove() ? root->QPerftSearchRoot<White>(d)
                                        : root->QPerftSearchRoot<Black>(d);
 
   const uint64_t msecs = (senjo::Now() - _startTime);
-  assert(count == (_stats.snodes + _stats.qnodes));
+  const Stats stats = context->ThreadStats();
+  assert(count == (stats.snodes + stats.qnodes));
   senjo::Output() << "Qperft " << count << ' '
                   << senjo::Rate((count / 1000), msecs) << " KNodes/sec";
-  senjo::Output() << "Snodes " << _stats.snodes << ", Qnodes " << _stats.qnodes
-                  << " (" << senjo::Percent(_stats.qnodes, count) << "%)";
+  senjo::Output() << "Snodes " << stats.snodes << ", Qnodes " << stats.qnodes
+                  << " (" << senjo::Percent(stats.qnodes, count) << "%)";
 
   return count;
 }
 
 //-----------------------------------------------------------------------------
 std::string Clunk::MyGo(const int depth,
-                        const int /*movestogo*/,
-                        const uint64_t /*movetime*/,
-                        const uint64_t /*wtime*/, const uint64_t /*winc*/,
-                        const uint64_t /*btime*/, const uint64_t /*binc*/,
-                        std::string* /*ponder*/)
+                        const int movestogo,
+                        const uint64_t movetime,
+                        const uint64_t wtime, const uint64_t winc,
+                        const uint64_t btime, const uint64_t binc,
+                        const uint64_t nodes,
+                        std::string* ponder)
 {
   if (!root) {
     senjo::Output() << NOT_INITIALIZED;
@@ -5093,26 +6856,49 @@ std::string Clunk::MyGo(const int depth,
     senjo::Output() << GetFEN();
   }
 
-  InitSearch(COLOR(root->state), _startTime);
+  context->ApplyResize();
+  context->InitSearch(COLOR(root->state), _startTime);
+  if (WhiteToMove()) {
+    context->SetTimeLimits(movestogo, movetime, wtime, winc, MovesToGo());
+  }
+  else {
+    context->SetTimeLimits(movestogo, movetime, btime, binc, MovesToGo());
+  }
+  _stopTime = (context->hardTime && !context->pondering)
+      ? (_startTime + context->hardTime) : 0;
+
+  context->nodeLimit = nodes;
 
   int d = std::min<int>(depth, MaxPlies);
   if (d <= 0) {
     d = MaxPlies;
   }
+  context->StartHelpers();
   std::string bestmove = (WhiteToMove() ? root->SearchRoot<White>(d)
                                         : root->SearchRoot<Black>(d));
 
-  _stats.ttGets   += _tt.Gets();
-  _stats.ttHits   += _tt.Hits();
-  _stats.ttMates  += _tt.Checkmates();
-  _stats.ttStales += _tt.Stalemates();
-  _stats.ptGets   += _pawnTT.Gets();
-  _stats.ptHits   += _pawnTT.Hits();
-  _totalStats += _stats;
+  // don't report bestmove before 'ponderhit' or 'stop'
+  while (context->pondering &&
+         !(context->stop & senjo::ChessEngine::FullStop))
+  {
+    senjo::MillisecondSleep(10);
+  }
+  context->StopHelpers();
+
+  if (ponder) {
+    *ponder = (root->pvCount > 1) ? root->pv[1].ToString() : std::string();
+  }
+
+  Stats stats = context->ThreadStats();
+  stats.ttGets   += context->tt.Gets();
+  stats.ttHits   += context->tt.Hits();
+  stats.ttMates  += context->tt.Checkmates();
+  stats.ttStales += context->tt.Stalemates();
+  context->totalStats += stats;
 
   if (_debug) {
     senjo::Output() << "--- Stats";
-    _stats.Print();
+    stats.Print();
   }
 
   return bestmove;
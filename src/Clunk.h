@@ -13,6 +13,7 @@ namespace clunk
 
 //----------------------------------------------------------------------------
 struct Node;
+struct SearchContext;
 
 //----------------------------------------------------------------------------
 class Clunk : public senjo::ChessEngine
@@ -32,6 +33,7 @@ public:
   std::string GetEngineName() const;
   std::string GetEngineVersion() const;
   std::string GetFEN() const;
+  senjo::ChessEngine* NewInstance(const int instances) const;
   void ClearSearchData();
   void ClearStopFlags();
   void Initialize();
@@ -40,6 +42,10 @@ public:
   void Quit();
   void ResetStatsTotals();
   void SetDebug(const bool flag);
+  void SetPondering(const bool flag);
+  void SetPerftHashSize(const size_t mbytes);
+  bool SaveHash(const std::string& path);
+  bool LoadHash(const std::string& path);
   void ShowStatsTotals() const;
   void Stop(const StopReason);
   void GetStats(int* depth,
@@ -59,10 +65,12 @@ protected:
                    const uint64_t movetime = 0,
                    const uint64_t wtime = 0, const uint64_t winc = 0,
                    const uint64_t btime = 0, const uint64_t binc = 0,
+                   const uint64_t nodes = 0,
                    std::string* ponder = NULL);
 
 private:
   Node* root;
+  SearchContext* context;
 };
 
 } // namespace clunk
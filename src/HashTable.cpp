@@ -809,4 +809,15 @@ const uint64_t _HASH[14][128] =
   }
 };
 
+//-----------------------------------------------------------------------------
+uint64_t HashKeySignature() {
+  uint64_t signature = 0xCBF29CE484222325ULL;
+  for (int i = 0; i < 14; ++i) {
+    for (int k = 0; k < 128; ++k) {
+      signature = ((signature ^ _HASH[i][k]) * 0x100000001B3ULL);
+    }
+  }
+  return signature;
+}
+
 } // namespace clunk
@@ -6,15 +6,33 @@
 #define CLUNK_HASHTABLE_H
 
 #include "senjo/Platform.h"
+#include "senjo/Output.h"
 #include "Types.h"
 #include "Move.h"
 
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#else
+#include <new>
+#endif
+
+#ifdef _WIN32
+#include <xmmintrin.h>
+#endif
+
 namespace clunk
 {
 
 //-----------------------------------------------------------------------------
 extern const uint64_t _HASH[14][128];
 
+//-----------------------------------------------------------------------------
+// fingerprint of _HASH, saved tables are only usable with the same keys
+//-----------------------------------------------------------------------------
+uint64_t HashKeySignature();
+
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
 struct HashEntry
@@ -31,43 +49,56 @@ struct HashEntry
     // other flags
     Extended    = 0x08,
     FromPV      = 0x10,
-    OtherMask   = 0x18
+    OtherMask   = 0x18,
+
+    // search generation that stored the entry, top 3 bits of flags
+    AgeShift    = 5,
+    AgeMask     = 0x07
   };
 
+  //---------------------------------------------------------------------------
+  // the key is stored xor'd with the data, so an entry torn by another thread
+  // writing it at the same time simply fails to match any key
   //---------------------------------------------------------------------------
   uint64_t Key() const {
-    return key;
+    return (check ^ data);
   }
 
   //---------------------------------------------------------------------------
   uint32_t MoveBits() const {
-    return moveBits;
+    return static_cast<uint32_t>(data);
   }
 
   //---------------------------------------------------------------------------
   int Depth() const {
-    return depth;
+    return static_cast<int>((data >> DepthShift) & 0xFF);
+  }
+
+  //---------------------------------------------------------------------------
+  int Age() const {
+    return ((Flags() >> AgeShift) & AgeMask);
   }
 
   //---------------------------------------------------------------------------
   int GetPrimaryFlag() const {
-    return (flags & HashEntry::PrimaryMask);
+    return (Flags() & HashEntry::PrimaryMask);
   }
 
   //---------------------------------------------------------------------------
   bool HasExtendedFlag() const {
-    return (flags & HashEntry::Extended);
+    return (Flags() & HashEntry::Extended);
   }
 
   //---------------------------------------------------------------------------
   bool HasPvFlag() const {
-    return (flags & HashEntry::FromPV);
+    return (Flags() & HashEntry::FromPV);
   }
 
   //---------------------------------------------------------------------------
   int Score(const int ply) const {
     // get mate-in-N scores relative to root
     assert((ply >= 0) & (ply < MaxPlies));
+    const int score = static_cast<int16_t>(data >> ScoreShift);
     if (score > MateScore) {
       assert((score - ply) > MateScore);
       assert((score - ply) < Infinity);
@@ -89,10 +120,12 @@ struct HashEntry
            const int ply,
            const int draft,
            const int primaryFlag,
-           const int otherFlags)
+           const int otherFlags,
+           const int age)
   {
     assert(entryKey);
-    assert(bestmove.IsValid());
+    assert(bestmove.IsValid() ||
+           (!draft && (primaryFlag == HashEntry::UpperBound)));
     assert(abs(eval) < Infinity);
     assert((ply >= 0) & (ply < MaxPlies));
     assert((draft >= 0) && (draft < 256));
@@ -100,51 +133,95 @@ struct HashEntry
            (primaryFlag == HashEntry::UpperBound) ||
            (primaryFlag == HashEntry::ExactScore));
     assert(!(otherFlags & ~HashEntry::OtherMask));
-
-    key      = entryKey;
-    moveBits = bestmove.Bits();
-    depth    = static_cast<uint8_t>(draft);
-    flags    = static_cast<uint8_t>(primaryFlag | otherFlags);
+    assert(!(age & ~HashEntry::AgeMask));
 
     // store mate-in-N scores relative to position
+    int score = eval;
     if (eval > MateScore) {
-      score  = static_cast<int16_t>(eval + ply);
+      score += ply;
     }
     else if (eval < -MateScore) {
-      score  = static_cast<int16_t>(eval - ply);
-    }
-    else {
-      score  = static_cast<int16_t>(eval);
+      score -= ply;
     }
+
+    Store(entryKey, bestmove.Bits(), draft,
+          (primaryFlag | otherFlags | (age << AgeShift)), score);
   }
 
   //---------------------------------------------------------------------------
-  void SetCheckmate(const uint64_t entryKey) {
+  void SetCheckmate(const uint64_t entryKey, const int age) {
     assert(entryKey);
-    key      = entryKey;
-    moveBits = 0;
-    depth    = 0;
-    flags    = HashEntry::Checkmate;
-    score    = Infinity;
+    Store(entryKey, 0, 0, (HashEntry::Checkmate | (age << AgeShift)), Infinity);
   }
 
   //---------------------------------------------------------------------------
-  void SetStalemate(const uint64_t entryKey) {
+  void SetStalemate(const uint64_t entryKey, const int age) {
     assert(entryKey);
-    key      = entryKey;
-    moveBits = 0;
-    depth    = 0;
-    flags    = HashEntry::Stalemate;
-    score    = 0;
+    Store(entryKey, 0, 0, (HashEntry::Stalemate | (age << AgeShift)), 0);
+  }
+
+private:
+  enum {
+    DepthShift = 32,
+    FlagsShift = 40,
+    ScoreShift = 48
+  };
+
+  //---------------------------------------------------------------------------
+  int Flags() const {
+    return static_cast<int>((data >> FlagsShift) & 0xFF);
+  }
+
+  //---------------------------------------------------------------------------
+  void Store(const uint64_t entryKey, const uint32_t moveBits, const int draft,
+             const int flags, const int score)
+  {
+    const uint64_t bits = (
+        static_cast<uint64_t>(moveBits) |
+        (static_cast<uint64_t>(draft & 0xFF) << DepthShift) |
+        (static_cast<uint64_t>(flags & 0xFF) << FlagsShift) |
+        (static_cast<uint64_t>(score & 0xFFFF) << ScoreShift));
+    data  = bits;
+    check = (entryKey ^ bits);
+  }
+
+  uint64_t check; //  8 bytes, key ^ data
+  uint64_t data;  //  8 bytes, move bits, depth, flags, and score
+                  // 16 bytes
+};
+
+//-----------------------------------------------------------------------------
+// one cache line of hash entries, a key may be stored in any of them
+//-----------------------------------------------------------------------------
+struct HashCluster
+{
+  enum { Size = 4 };
+
+  //---------------------------------------------------------------------------
+  // the entry holding 'key' if there is one, otherwise the entry to replace:
+  // an empty one or else the shallowest, giving up 8 plies per generation old
+  //---------------------------------------------------------------------------
+  HashEntry* Find(const uint64_t key, const int age) {
+    HashEntry* victim = entries;
+    int worst = Infinity;
+    for (int i = 0; i < Size; ++i) {
+      HashEntry* entry = (entries + i);
+      if (entry->Key() == key) {
+        return entry;
+      }
+      const int older = ((age - entry->Age()) & HashEntry::AgeMask);
+      const int value = entry->Key() ? (entry->Depth() - (8 * older))
+                                     : -Infinity;
+      if (value < worst) {
+        worst = value;
+        victim = entry;
+      }
+    }
+    return victim;
   }
 
 private:
-  uint64_t key;      //  8 bytes
-  uint32_t moveBits; //  4 bytes
-  uint8_t  depth;    //  1 byte
-  uint8_t  flags;    //  1 byte
-  int16_t  score;    //  2 bytes
-                     // 16 bytes
+  HashEntry entries[Size]; // 64 bytes
 };
 
 //-----------------------------------------------------------------------------
@@ -164,6 +241,38 @@ struct PawnEntry
                            // 32 bytes
 };
 
+//-----------------------------------------------------------------------------
+// perft leaf count of one subtree, the key is stored xor'd with the data so
+// an entry torn by two threads writing it at once won't match any key
+//-----------------------------------------------------------------------------
+struct PerftEntry
+{
+  //---------------------------------------------------------------------------
+  bool Get(const uint64_t entryKey, const int draft, uint64_t& leafs) const {
+    const uint64_t bits = data;
+    if (((check ^ bits) == entryKey) &
+        (static_cast<int>(bits & 0xFF) == draft))
+    {
+      leafs = (bits >> 8);
+      return true;
+    }
+    return false;
+  }
+
+  //---------------------------------------------------------------------------
+  void Set(const uint64_t entryKey, const int draft, const uint64_t leafs) {
+    assert((draft > 0) && (draft < 256));
+    assert(leafs < (1ULL << 56));
+    data  = ((leafs << 8) | static_cast<uint64_t>(draft));
+    check = (entryKey ^ data);
+  }
+
+private:
+  uint64_t check; //  8 bytes
+  uint64_t data;  //  8 bytes (leafs << 8) | draft
+                  // 16 bytes
+};
+
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
 template<typename EntryType>
@@ -172,7 +281,13 @@ class TranspositionTable
 public:
   //---------------------------------------------------------------------------
   TranspositionTable()
-    : keyMask(0ULL),
+    : salt(0),
+      age(0),
+      keyMask(0ULL),
+      memory(NULL),
+      memoryBytes(0),
+      pageType(NULL),
+      shared(false),
       entries(NULL)
   {
     Resize(1);
@@ -180,58 +295,304 @@ public:
 
   //---------------------------------------------------------------------------
   ~TranspositionTable() {
-    delete[] entries;
-    entries = NULL;
-    keyMask = 0ULL;
+    Free();
   }
 
   //---------------------------------------------------------------------------
   void Resize(size_t mbytes) {
-    delete[] entries;
+    Free();
+
+    keyMask = KeyMask(mbytes);
+    assert(keyMask);
+
+    // allocate as much as we can
+    while (!Allocate(sizeof(EntryType) * (keyMask + 1))) {
+      keyMask >>= 1;
+      assert(keyMask);
+    }
+
+    // initialize it, on linux the table is a fresh anonymous mapping that is
+    // already zero filled, so leave its pages to be touched on demand
+#ifdef __linux__
+    ResetCounters();
+#else
+    Clear();
+#endif
+  }
+
+  //---------------------------------------------------------------------------
+  void Free() {
+    if (memory) {
+#ifdef __linux__
+      munmap(memory, memoryBytes);
+#else
+      delete[] static_cast<char*>(memory);
+#endif
+    }
+    memory = NULL;
+    memoryBytes = 0;
+    pageType = NULL;
+    shared = false;
     entries = NULL;
     keyMask = 0ULL;
+  }
 
-    if (!mbytes) {
-      mbytes = 1;
+  //---------------------------------------------------------------------------
+  // use the POSIX shared memory table called 'name', creating it with room
+  // for 'mbytes' if it doesn't exist yet, so cooperating processes on this
+  // machine can search with one table (entries are safe to share because
+  // they are verified by key ^ data)
+  //---------------------------------------------------------------------------
+  bool Attach(const char* name, const size_t mbytes,
+              const uint64_t signature)
+  {
+    assert(name);
+#ifdef __linux__
+    bool created = true;
+    int fd = shm_open(name, (O_RDWR | O_CREAT | O_EXCL), 0600);
+    if ((fd < 0) && (errno == EEXIST)) {
+      created = false;
+      fd = shm_open(name, O_RDWR, 0);
+    }
+    if (fd < 0) {
+      senjo::Output() << "Unable to open shared hash table '" << name
+                      << "': " << strerror(errno);
+      return false;
     }
 
-    // convert mbytes to bytes
-    const size_t bytes = (mbytes * 1024 * 1024);
-
-    // how many hash entries can we fit into the requested number of bytes?
-    const size_t count = (bytes / sizeof(EntryType));
+    uint64_t count = (KeyMask(mbytes) + 1);
+    if (created) {
+      const off_t size = (FileHeaderSize + (sizeof(EntryType) * count));
+      if (ftruncate(fd, size)) {
+        senjo::Output() << "Unable to size shared hash table '" << name
+                        << "': " << strerror(errno);
+        close(fd);
+        shm_unlink(name);
+        return false;
+      }
+    }
 
-    // get high bit of 'count + 1'
-    // for example, if 'count + 1' in binary is: 100110101
-    //                    the high bit would be: 100000000
-    // NOTE: there are faster ways to do this on modern processors
-    size_t highBit = 2;
-    for (size_t tmp = ((count + 1) >> 2); tmp; tmp >>= 1) {
-      const size_t next = (highBit << 1);
-      if (next) {
-        highBit = next;
+    // another process may have just created the table and not sized it yet
+    struct stat st;
+    for (int tries = 0; ; ++tries) {
+      if (fstat(fd, &st)) {
+        st.st_size = 0;
+        break;
       }
-      else {
+      if (created || (st.st_size > FileHeaderSize) || (tries >= AttachTries)) {
         break;
       }
+      senjo::MillisecondSleep(AttachWait);
+    }
+    if (st.st_size <= FileHeaderSize) {
+      senjo::Output() << "Shared hash table '" << name << "' is not ready";
+      close(fd);
+      return false;
     }
-    assert(highBit >= 2);
 
-    // highBit is the number of entries we'll store
-    // highBit - 1 is the bit mask we use to map keys to a table slot
-    // example highBit in binary: 100000000
-    //                      mask: 011111111
-    keyMask = (highBit - 1);
-    assert(keyMask);
+    const size_t size = static_cast<size_t>(st.st_size);
+    void* mem = mmap(NULL, size, (PROT_READ | PROT_WRITE), MAP_SHARED, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED) {
+      senjo::Output() << "Unable to map shared hash table '" << name
+                      << "': " << strerror(errno);
+      return false;
+    }
 
-    // allocate as much as we can
-    while (!(entries = new EntryType[keyMask + 1])) {
-      keyMask >>= 1;
-      assert(keyMask);
+    // the creator writes the magic last, so a table with a magic is complete
+    FileHeader* h = static_cast<FileHeader*>(mem);
+    if (created) {
+      h->entrySize  = sizeof(EntryType);
+      h->entryCount = count;
+      h->signature  = signature;
+      __sync_synchronize();
+      memcpy(h->magic, FileMagic(), sizeof(h->magic));
     }
+    else {
+      const volatile char* magic = h->magic;
+      for (int tries = 0; !magic[0] && (tries < AttachTries); ++tries) {
+        senjo::MillisecondSleep(AttachWait);
+      }
+      __sync_synchronize();
+    }
+    if (!created &&
+        (memcmp(h->magic, FileMagic(), sizeof(h->magic)) ||
+         (h->entrySize != sizeof(EntryType)) ||
+         !h->entryCount || (h->entryCount & (h->entryCount - 1)) ||
+         (h->signature != signature) ||
+         (size != (FileHeaderSize + (sizeof(EntryType) * h->entryCount)))))
+    {
+      senjo::Output() << "Shared hash table '" << name
+                      << "' is not compatible";
+      munmap(mem, size);
+      return false;
+    }
+    count = h->entryCount;
+
+    Free();
+    memory = mem;
+    memoryBytes = size;
+    pageType = "shared memory";
+    shared = true;
+    entries = reinterpret_cast<EntryType*>(static_cast<char*>(mem) +
+                                           FileHeaderSize);
+    keyMask = (count - 1);
+
+    // every process attached to the table must use the same keys, and since
+    // each process starts its own searches they can't agree on an age, so
+    // entries in a shared table all stay at age 0 and depth alone decides
+    // which ones get replaced
+    salt = 0;
+    age = 0;
+    ResetCounters();
+    return true;
+#else
+    (void)mbytes;
+    (void)signature;
+    senjo::Output() << "Shared hash table '" << name
+                    << "' is not supported on this platform";
+    return false;
+#endif
+  }
 
-    // initialize it
-    Clear();
+  //---------------------------------------------------------------------------
+  bool Shared() const {
+    return shared;
+  }
+
+  //---------------------------------------------------------------------------
+  // write a header followed by a flat image of the entries, 'signature'
+  // identifies the keys the table was filled with.  the image goes to a
+  // temp file that is renamed over 'path' when complete, so a table mapped
+  // from 'path' by Load() keeps its old file and a failed save leaves the
+  // previous file alone
+  //---------------------------------------------------------------------------
+  bool Save(const char* path, const uint64_t signature) const {
+    assert(path);
+    assert(entries);
+    const std::string tmpPath = (std::string(path) + ".tmp");
+    FILE* fp = fopen(tmpPath.c_str(), "wb");
+    if (!fp) {
+      senjo::Output() << "Unable to open '" << tmpPath << "': "
+                      << strerror(errno);
+      return false;
+    }
+
+    char header[FileHeaderSize];
+    memset(header, 0, sizeof(header));
+    FileHeader* h = reinterpret_cast<FileHeader*>(header);
+    memcpy(h->magic, FileMagic(), sizeof(h->magic));
+    h->entrySize  = sizeof(EntryType);
+    h->entryCount = (keyMask + 1);
+    h->signature  = signature;
+    h->salt       = salt;
+    h->age        = static_cast<uint64_t>(age);
+
+    const bool ok = ((fwrite(header, sizeof(header), 1, fp) == 1) &&
+                     (fwrite(entries, sizeof(EntryType), (keyMask + 1), fp) ==
+                      (keyMask + 1)));
+    if (fclose(fp) || !ok) {
+      senjo::Output() << "Error writing '" << tmpPath << "': "
+                      << strerror(errno);
+      remove(tmpPath.c_str());
+      return false;
+    }
+#ifdef _WIN32
+    remove(path); // rename() won't replace an existing file on windows
+#endif
+    if (rename(tmpPath.c_str(), path)) {
+      senjo::Output() << "Unable to rename '" << tmpPath << "' to '" << path
+                      << "': " << strerror(errno);
+      remove(tmpPath.c_str());
+      return false;
+    }
+    return true;
+  }
+
+  //---------------------------------------------------------------------------
+  // replace the table with one written by Save(), on linux the file is
+  // mapped copy-on-write so a large table is usable without reading it all
+  //---------------------------------------------------------------------------
+  bool Load(const char* path, const uint64_t signature) {
+    assert(path);
+    FILE* fp = fopen(path, "rb");
+    if (!fp) {
+      senjo::Output() << "Unable to open '" << path << "': " << strerror(errno);
+      return false;
+    }
+
+    FileHeader h;
+    if ((fread(&h, sizeof(h), 1, fp) != 1) ||
+        memcmp(h.magic, FileMagic(), sizeof(h.magic)) ||
+        (h.entrySize != sizeof(EntryType)) ||
+        !h.entryCount || (h.entryCount & (h.entryCount - 1)) ||
+        (h.signature != signature) ||
+        (h.age & ~static_cast<uint64_t>(HashEntry::AgeMask)))
+    {
+      senjo::Output() << "'" << path << "' is not a compatible hash file";
+      fclose(fp);
+      return false;
+    }
+
+    const uint64_t bytes = (sizeof(EntryType) * h.entryCount);
+    if (FileSize(fp) != (FileHeaderSize + bytes)) {
+      senjo::Output() << "'" << path << "' is truncated";
+      fclose(fp);
+      return false;
+    }
+
+#ifdef __linux__
+    void* mem = mmap(NULL, bytes, (PROT_READ | PROT_WRITE), MAP_PRIVATE,
+                     fileno(fp), FileHeaderSize);
+    fclose(fp);
+    if (mem == MAP_FAILED) {
+      senjo::Output() << "Unable to map '" << path << "': " << strerror(errno);
+      return false;
+    }
+    madvise(mem, bytes, MADV_RANDOM);
+    Free();
+    memory = mem;
+    memoryBytes = bytes;
+    pageType = "file backed pages";
+    entries = static_cast<EntryType*>(mem);
+    keyMask = (h.entryCount - 1);
+#else
+    Free();
+    keyMask = (h.entryCount - 1);
+    if (!Allocate(bytes)) {
+      Resize(1);
+      senjo::Output() << "Not enough memory to load '" << path << "'";
+      fclose(fp);
+      return false;
+    }
+    if (fseek(fp, FileHeaderSize, SEEK_SET) ||
+        (fread(entries, sizeof(EntryType), h.entryCount, fp) != h.entryCount))
+    {
+      senjo::Output() << "Error reading '" << path << "'";
+      fclose(fp);
+      Clear();
+      return false;
+    }
+    fclose(fp);
+#endif
+
+    salt = h.salt;
+    age = static_cast<int>(h.age);
+    ResetCounters();
+    return true;
+  }
+
+  //---------------------------------------------------------------------------
+  // trade table memory with 'other', salt and age stay with each table
+  //---------------------------------------------------------------------------
+  void Swap(TranspositionTable& other) {
+    std::swap(keyMask, other.keyMask);
+    std::swap(memory, other.memory);
+    std::swap(memoryBytes, other.memoryBytes);
+    std::swap(pageType, other.pageType);
+    std::swap(entries, other.entries);
+    ResetCounters();
+    other.ResetCounters();
   }
 
   //---------------------------------------------------------------------------
@@ -242,6 +603,35 @@ public:
     ResetCounters();
   }
 
+  //---------------------------------------------------------------------------
+  // clear without touching the table: callers xor keys with Salt() so entries
+  // stored before this can't match, and they are aged to be replaced first
+  //---------------------------------------------------------------------------
+  void Invalidate() {
+    if (!shared) { // other processes may still be using a shared table
+      salt += 0x9E3779B97F4A7C15ULL;
+      age = ((age + 4) & HashEntry::AgeMask);
+    }
+    ResetCounters();
+  }
+
+  //---------------------------------------------------------------------------
+  uint64_t Salt() const {
+    return salt;
+  }
+
+  //---------------------------------------------------------------------------
+  size_t Bytes() const {
+    return (sizeof(EntryType) * (keyMask + 1));
+  }
+
+  //---------------------------------------------------------------------------
+  // the kind of memory pages backing the table
+  //---------------------------------------------------------------------------
+  const char* PageType() const {
+    return pageType;
+  }
+
   //---------------------------------------------------------------------------
   inline EntryType* Get(const uint64_t key) {
     assert(keyMask);
@@ -250,6 +640,33 @@ public:
     return (entries + (key & keyMask));
   }
 
+  //---------------------------------------------------------------------------
+  // start loading the entry for 'key' into cache ahead of Get()
+  //---------------------------------------------------------------------------
+  inline void Prefetch(const uint64_t key) const {
+    assert(entries);
+#ifdef _WIN32
+    _mm_prefetch(reinterpret_cast<const char*>(entries + (key & keyMask)),
+                 _MM_HINT_T0);
+#else
+    __builtin_prefetch(entries + (key & keyMask));
+#endif
+  }
+
+  //---------------------------------------------------------------------------
+  // bump the generation number used to age out entries from older searches
+  //---------------------------------------------------------------------------
+  void NextAge() {
+    if (!shared) {
+      age = ((age + 1) & HashEntry::AgeMask);
+    }
+  }
+
+  //---------------------------------------------------------------------------
+  int Age() const {
+    return age;
+  }
+
   //---------------------------------------------------------------------------
   void ResetCounters() {
     gets = 0;
@@ -294,13 +711,155 @@ public:
   }
 
 private:
+  //---------------------------------------------------------------------------
+  // entries are randomly accessed all over the table, so on linux map it with
+  // huge pages to save TLB misses: explicit huge pages if the system has any
+  // reserved, otherwise ask for transparent huge pages
+  //---------------------------------------------------------------------------
+  bool Allocate(const size_t bytes) {
+    assert(!memory);
+#ifdef __linux__
+    const size_t hugeBytes =
+        (((bytes + HugePageSize - 1) / HugePageSize) * HugePageSize);
+#ifdef MAP_HUGETLB
+    memory = mmap(NULL, hugeBytes, (PROT_READ | PROT_WRITE),
+                  (MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB), -1, 0);
+    if (memory != MAP_FAILED) {
+      memoryBytes = hugeBytes;
+      pageType = "huge pages";
+      entries = static_cast<EntryType*>(memory);
+      return true;
+    }
+#endif
+    // transparent huge pages only cover whole aligned huge pages
+    memory = mmap(NULL, (hugeBytes + HugePageSize), (PROT_READ | PROT_WRITE),
+                  (MAP_PRIVATE | MAP_ANONYMOUS), -1, 0);
+    if (memory == MAP_FAILED) {
+      memory = NULL;
+      return false;
+    }
+    memoryBytes = (hugeBytes + HugePageSize);
+    entries = reinterpret_cast<EntryType*>(Align(memory, HugePageSize));
+    pageType = "normal pages";
+#ifdef MADV_HUGEPAGE
+    if (!madvise(entries, hugeBytes, MADV_HUGEPAGE)) {
+      pageType = "transparent huge pages";
+    }
+#endif
+#else
+    // entries start on a cache line boundary
+    if (!(memory = new (std::nothrow) char[bytes + CacheLineSize])) {
+      return false;
+    }
+    memoryBytes = (bytes + CacheLineSize);
+    entries = reinterpret_cast<EntryType*>(Align(memory, CacheLineSize));
+    pageType = "normal pages";
+#endif
+    return true;
+  }
+
+  //---------------------------------------------------------------------------
+  // the number of entries that fit in 'mbytes', rounded down to a power of 2,
+  // minus 1 to give the bit mask that maps keys to table slots
+  //---------------------------------------------------------------------------
+  static size_t KeyMask(size_t mbytes) {
+    if (!mbytes) {
+      mbytes = 1;
+    }
+
+    // convert mbytes to bytes
+    const size_t bytes = (mbytes * 1024 * 1024);
+
+    // how many hash entries can we fit into the requested number of bytes?
+    const size_t count = (bytes / sizeof(EntryType));
+
+    // get high bit of 'count + 1'
+    // for example, if 'count + 1' in binary is: 100110101
+    //                    the high bit would be: 100000000
+    // NOTE: there are faster ways to do this on modern processors
+    size_t highBit = 2;
+    for (size_t tmp = ((count + 1) >> 2); tmp; tmp >>= 1) {
+      const size_t next = (highBit << 1);
+      if (next) {
+        highBit = next;
+      }
+      else {
+        break;
+      }
+    }
+    assert(highBit >= 2);
+
+    // highBit is the number of entries we'll store
+    // highBit - 1 is the bit mask we use to map keys to a table slot
+    // example highBit in binary: 100000000
+    //                      mask: 011111111
+    return (highBit - 1);
+  }
+
+  //---------------------------------------------------------------------------
+  // first page of a saved or shared table, entries start on the page after
+  // it so they can be mapped straight from the file
+  //---------------------------------------------------------------------------
+  struct FileHeader {
+    char     magic[8];
+    uint64_t entrySize;
+    uint64_t entryCount;
+    uint64_t signature;
+    uint64_t salt;
+    uint64_t age;
+  };
+
+  enum { FileHeaderSize = 4096 };
+
+  // how long Attach() waits for another process to finish creating a table
+  enum {
+    AttachTries = 100,
+    AttachWait  = 10 // msecs
+  };
+
+  //---------------------------------------------------------------------------
+  static const char* FileMagic() {
+    return "ClunkTT1";
+  }
+
+  //---------------------------------------------------------------------------
+  static uint64_t FileSize(FILE* fp) {
+#ifdef _WIN32
+    if (_fseeki64(fp, 0, SEEK_END)) {
+      return 0;
+    }
+    return static_cast<uint64_t>(_ftelli64(fp));
+#else
+    if (fseeko(fp, 0, SEEK_END)) {
+      return 0;
+    }
+    return static_cast<uint64_t>(ftello(fp));
+#endif
+  }
+
+  //---------------------------------------------------------------------------
+  static void* Align(void* address, const size_t alignment) {
+    return reinterpret_cast<void*>(
+        (reinterpret_cast<uintptr_t>(address) + (alignment - 1)) &
+        ~static_cast<uintptr_t>(alignment - 1));
+  }
+
   uint64_t gets;
   uint64_t hits;
   uint64_t checkmates;
   uint64_t stalemates;
 
-  size_t     keyMask;
-  EntryType* entries;
+  enum { CacheLineSize = 64 };
+  static const size_t HugePageSize = (2 * 1024 * 1024);
+
+  uint64_t    salt;
+  int         age;
+  size_t      keyMask;
+  void*       memory;
+  size_t      memoryBytes;
+  const char* pageType;
+  bool        shared; // mapped from a POSIX shared memory object
+  EntryType*  entries;
 };
 
 } // namespace clunk
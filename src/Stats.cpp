@@ -19,6 +19,12 @@ void Stats::Clear()
   ttMates       = 0;
   ttStales      = 0;
   ptGets        = 0;
+  for (int i = 0; i < DraftBuckets; ++i) {
+    ttDraftHits[i]  = 0;
+    ttOverwrites[i] = 0;
+  }
+  qttStores     = 0;
+  qttCutoffs    = 0;
   ptHits        = 0;
   snodes        = 0;
   qnodes        = 0;
@@ -28,6 +34,8 @@ void Stats::Clear()
   execs         = 0;
   qexecs        = 0;
   deltaCount    = 0;
+  seePrunes     = 0;
+  seeDefers     = 0;
   staticNM      = 0;
   rzrCount      = 0;
   rzrEarlyOut   = 0;
@@ -44,6 +52,9 @@ void Stats::Clear()
   lmResearches  = 0;
   lmConfirmed   = 0;
   lmAlphaIncs   = 0;
+  splitPoints   = 0;
+  splitHelpers  = 0;
+  splitCutoffs  = 0;
 }
 
 //-----------------------------------------------------------------------------
@@ -53,6 +64,12 @@ Stats& Stats::operator+=(const Stats& other) {
   ttHits        += other.ttHits;
   ttMates       += other.ttMates;
   ttStales      += other.ttStales;
+  for (int i = 0; i < DraftBuckets; ++i) {
+    ttDraftHits[i]  += other.ttDraftHits[i];
+    ttOverwrites[i] += other.ttOverwrites[i];
+  }
+  qttStores     += other.qttStores;
+  qttCutoffs    += other.qttCutoffs;
   ptGets        += other.ptGets;
   ptHits        += other.ptHits;
   snodes        += other.snodes;
@@ -63,6 +80,8 @@ Stats& Stats::operator+=(const Stats& other) {
   execs         += other.execs;
   qexecs        += other.qexecs;
   deltaCount    += other.deltaCount;
+  seePrunes     += other.seePrunes;
+  seeDefers     += other.seeDefers;
   staticNM      += other.staticNM;
   rzrCount      += other.rzrCount;
   rzrEarlyOut   += other.rzrEarlyOut;
@@ -79,6 +98,9 @@ Stats& Stats::operator+=(const Stats& other) {
   lmResearches  += other.lmResearches;
   lmConfirmed   += other.lmConfirmed;
   lmAlphaIncs   += other.lmAlphaIncs;
+  splitPoints   += other.splitPoints;
+  splitHelpers  += other.splitHelpers;
+  splitCutoffs  += other.splitCutoffs;
   return *this;
 }
 
@@ -97,6 +119,12 @@ Stats Stats::Average() const {
   avg.ttHits        = Avg(ttHits,       statCount);
   avg.ttMates       = Avg(ttMates,      statCount);
   avg.ttStales      = Avg(ttStales,     statCount);
+  for (int i = 0; i < DraftBuckets; ++i) {
+    avg.ttDraftHits[i]  = Avg(ttDraftHits[i],  statCount);
+    avg.ttOverwrites[i] = Avg(ttOverwrites[i], statCount);
+  }
+  avg.qttStores     = Avg(qttStores,    statCount);
+  avg.qttCutoffs    = Avg(qttCutoffs,   statCount);
   avg.ptGets        = Avg(ptGets,       statCount);
   avg.ptHits        = Avg(ptHits,       statCount);
   avg.snodes        = Avg(snodes,       statCount);
@@ -107,6 +135,8 @@ Stats Stats::Average() const {
   avg.execs         = Avg(execs,        statCount);
   avg.qexecs        = Avg(qexecs,       statCount);
   avg.deltaCount    = Avg(deltaCount,   statCount);
+  avg.seePrunes     = Avg(seePrunes,    statCount);
+  avg.seeDefers     = Avg(seeDefers,    statCount);
   avg.staticNM      = Avg(staticNM,     statCount);
   avg.rzrCount      = Avg(rzrCount,     statCount);
   avg.rzrEarlyOut   = Avg(rzrEarlyOut,  statCount);
@@ -123,15 +153,35 @@ Stats Stats::Average() const {
   avg.lmResearches  = Avg(lmResearches, statCount);
   avg.lmConfirmed   = Avg(lmConfirmed,  statCount);
   avg.lmAlphaIncs   = Avg(lmAlphaIncs,  statCount);
+  avg.splitPoints   = Avg(splitPoints,  statCount);
+  avg.splitHelpers  = Avg(splitHelpers, statCount);
+  avg.splitCutoffs  = Avg(splitCutoffs, statCount);
   return avg;
 }
 
+//-----------------------------------------------------------------------------
+static void PrintByDraft(const char* title,
+                         const uint64_t (&counts)[Stats::DraftBuckets])
+{
+  Output out;
+  out << title;
+  for (int i = 0; i < Stats::DraftBuckets; ++i) {
+    out << ' ' << i << (((i + 1) < Stats::DraftBuckets) ? ":" : "+:")
+        << counts[i];
+  }
+}
+
 //-----------------------------------------------------------------------------
 void Stats::Print() {
   if (ttGets) {
     Output() << ttGets << " gets, " << ttHits << " hits ("
              << Percent(ttHits, ttGets) << "%), " << ttMates
              << " checkmates, " << ttStales << " stalemates";
+
+    PrintByDraft("hits by draft      ", ttDraftHits);
+    PrintByDraft("overwrites by draft", ttOverwrites);
+    Output() << qttStores << " qsearch stores, " << qttCutoffs
+             << " qsearch hash cutoffs";
   }
 
   if (ptGets) {
@@ -157,6 +207,11 @@ void Stats::Print() {
              << Percent(deltaCount, qnodes) << "%)";
   }
 
+  if (seePrunes || seeDefers) {
+    Output() << seePrunes << " losing captures pruned, "
+             << seeDefers << " searched last";
+  }
+
   if (rzrCount) {
     Output() << rzrCount << " razor attempts, "
              << rzrEarlyOut << " early out ("
@@ -202,6 +257,13 @@ void Stats::Print() {
              << lmConfirmed << " confirmed ("
              << Percent(lmConfirmed, lmResearches) << "%)";
   }
+
+  if (splitPoints) {
+    Output() << splitPoints << " split points, "
+             << splitHelpers << " helpers joined, "
+             << splitCutoffs << " cutoffs ("
+             << Percent(splitCutoffs, splitPoints) << "%)";
+  }
 }
 
 } // namespace clunk
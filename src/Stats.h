@@ -12,6 +12,8 @@ namespace clunk
 
 struct Stats
 {
+  enum { DraftBuckets = 8 }; // drafts 0 through 6, and 7 or more
+
   Stats() { Clear(); }
 
   void Clear();
@@ -23,6 +25,10 @@ struct Stats
   uint64_t ttHits;        // transposition table hits
   uint64_t ttMates;       // transposition table checkmates
   uint64_t ttStales;      // transposition table stalemates
+  uint64_t ttDraftHits[DraftBuckets]; // hits by draft of the entry hit
+  uint64_t ttOverwrites[DraftBuckets]; // other positions replaced, by draft
+  uint64_t qttStores;     // draft 0 stores from QSearch()
+  uint64_t qttCutoffs;    // QSearch() cutoffs from draft 0 entries
   uint64_t ptGets;        // pawn transposition table gets
   uint64_t ptHits;        // pawn transposition table hist
   uint64_t snodes;        // Search() calls
@@ -33,6 +39,8 @@ struct Stats
   uint64_t execs;         // Exec() calls
   uint64_t qexecs;        // delta candidates
   uint64_t deltaCount;    // delta prunings
+  uint64_t seePrunes;     // losing captures skipped by QSearch()
+  uint64_t seeDefers;     // losing captures moved behind quiet moves
   uint64_t staticNM;      // static null move pruning
   uint64_t rzrCount;      // razoring attempts
   uint64_t rzrEarlyOut;   // razoring early descent into qsearch
@@ -49,6 +57,9 @@ struct Stats
   uint64_t lmResearches;  // lmReductions re-searched at full depth
   uint64_t lmConfirmed;   // lmResearches alpha increases confirmed
   uint64_t lmAlphaIncs;   // late moves that increase alpha
+  uint64_t splitPoints;   // nodes split between threads
+  uint64_t splitHelpers;  // helper threads that joined split points
+  uint64_t splitCutoffs;  // split points that failed high
   uint64_t statCount;     // number of stats summed into this instance
 };
 
@@ -129,6 +129,7 @@ enum {
   BishopOffset      = 40,
   BlackBishopOffset = 50,
   RookOffset        = 60,
+  MaxThreads        = 64,
   BlackRookOffset   = 70,
   QueenOffset       = 80,
   BlackQueenOffset  = 90,
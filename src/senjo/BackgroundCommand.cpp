@@ -24,6 +24,13 @@
 #include "MoveFinder.h"
 #include "Output.h"
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/select.h>
+#include <sys/wait.h>
+#endif
+
 namespace senjo {
 
 //-----------------------------------------------------------------------------
@@ -199,7 +206,8 @@ bool GoCommandHandle::Parse(const char* params)
     return false;
   }
 
-  if (infinite || ponder) {
+  // ponder searches keep their limits, they are applied on 'ponderhit'
+  if (infinite) {
     depth     = 0;
     movestogo = 0;
     binc      = 0;
@@ -222,10 +230,12 @@ void GoCommandHandle::Execute()
   }
 
   engine->ClearStopFlags();
+  engine->SetPondering(ponder);
 
   std::string ponder; // NOTE: shadows this->ponder
   std::string bestmove =
-      engine->Go(depth, movestogo, movetime, wtime, winc, btime, binc, &ponder);
+      engine->Go(depth, movestogo, movetime, wtime, winc, btime, binc, nodes,
+                 &ponder);
 
   if (bestmove.empty()) {
     bestmove = "none";
@@ -246,18 +256,24 @@ const std::string PerftCommandHandle::_TEST_FILE = "epd/perftsuite.epd";
 //-----------------------------------------------------------------------------
 bool PerftCommandHandle::Parse(const char* params)
 {
+  static const std::string argCheck = "checkpoint";
   static const std::string argCount = "count";
   static const std::string argDepth = "depth";
   static const std::string argEpd   = "epd";
   static const std::string argFile  = "file";
+  static const std::string argHash  = "hash";
   static const std::string argLeafs = "leafs";
+  static const std::string argProcs = "procs";
   static const std::string argSkip  = "skip";
 
-  count    = 0;
-  skip     = 0;
-  maxDepth = 0;
-  maxLeafs = 0;
-  fileName = "";
+  count      = 0;
+  skip       = 0;
+  maxDepth   = 0;
+  hashSize   = 0;
+  procs      = 0;
+  maxLeafs   = 0;
+  checkpoint = "";
+  fileName   = "";
 
   bool epd = false;
   bool invalid = false;
@@ -267,6 +283,9 @@ bool PerftCommandHandle::Parse(const char* params)
         NumberParam(argSkip,  skip,     params, invalid) ||
         NumberParam(argDepth, maxDepth, params, invalid) ||
         NumberParam(argLeafs, maxLeafs, params, invalid) ||
+        NumberParam(argHash,  hashSize, params, invalid) ||
+        NumberParam(argProcs, procs,    params, invalid) ||
+        StringParam(argCheck, checkpoint, params, invalid) ||
         StringParam(argFile,  fileName, params, invalid))
     {
       continue;
@@ -274,10 +293,14 @@ bool PerftCommandHandle::Parse(const char* params)
     Output() << "Unexpected token: " << params;
     return false;
   }
-  if (invalid) {
+  if (invalid || (hashSize < 0) || (procs < 0)) {
     Output() << "usage: " << Usage();
     return false;
   }
+  if (qperft && (procs > 1)) {
+    Output() << "procs is not supported by " << command;
+    return false;
+  }
 
   if (epd && fileName.empty()) {
     fileName = _TEST_FILE;
@@ -295,11 +318,15 @@ void PerftCommandHandle::Execute()
   }
 
   engine->ClearStopFlags();
+  engine->SetPerftHashSize(static_cast<size_t>(hashSize));
 
   if (fileName.empty()) {
     if (qperft) {
       engine->QPerft(maxDepth);
     }
+    else if (procs > 1) {
+      ForkPerft(maxDepth);
+    }
     else {
       engine->Perft(maxDepth);
     }
@@ -428,11 +455,17 @@ bool PerftCommandHandle::Process(const char* params, uint64_t& count,
   }
 
   Output() << "--- " << depth << " => " << expected;
-  uint64_t perft_count = qperft ? engine->QPerft(depth) : engine->Perft(depth);
+  uint64_t perft_count = 0;
   uint64_t node_count = 0;
   uint64_t qnode_count = 0;
 
-  engine->GetStats(NULL, NULL, &node_count, &qnode_count);
+  if (procs > 1) {
+    perft_count = ForkPerft(depth);
+  }
+  else {
+    perft_count = qperft ? engine->QPerft(depth) : engine->Perft(depth);
+    engine->GetStats(NULL, NULL, &node_count, &qnode_count);
+  }
   count += perft_count;
   nodes += node_count;
   qnodes += qnode_count;
@@ -445,6 +478,309 @@ bool PerftCommandHandle::Process(const char* params, uint64_t& count,
   return true;
 }
 
+#ifndef _WIN32
+//-----------------------------------------------------------------------------
+//! \brief Get all legal moves in a position using only SetPosition/MakeMove
+//! \param[in] engine The engine, left at position \p fen
+//! \param[in] fen The position
+//! \return Legal moves in coordinate notation, sorted
+//-----------------------------------------------------------------------------
+static std::vector<std::string> LegalMoves(ChessEngine* engine,
+                                          const std::string& fen)
+{
+  std::vector<std::string> moves;
+  char mv[6] = {0};
+
+  engine->SetPosition(fen.c_str());
+  for (int from = 0; from < 64; ++from) {
+    for (int to = 0; to < 64; ++to) {
+      if (from == to) {
+        continue;
+      }
+      mv[0] = static_cast<char>('a' + (from % 8));
+      mv[1] = static_cast<char>('1' + (from / 8));
+      mv[2] = static_cast<char>('a' + (to % 8));
+      mv[3] = static_cast<char>('1' + (to / 8));
+
+      // only try the plain move if it isn't a promotion
+      bool found = false;
+      for (const char* promo = "qrbn"; *promo; ++promo) {
+        mv[4] = *promo;
+        if (engine->MakeMove(mv)) {
+          moves.push_back(mv);
+          engine->SetPosition(fen.c_str());
+          found = true;
+        }
+      }
+      mv[4] = 0;
+      if (!found && engine->MakeMove(mv)) {
+        moves.push_back(mv);
+        engine->SetPosition(fen.c_str());
+      }
+    }
+  }
+
+  std::sort(moves.begin(), moves.end());
+  return moves;
+}
+
+//-----------------------------------------------------------------------------
+//! \brief Forked worker process loop, count leafs for each task received
+//! Tasks are "<depth>;<fen>;<moves>" lines, answered with a leaf count line.
+//! \param[in] engine The engine
+//! \param[in] in Task stream
+//! \param[in] out Result stream
+//-----------------------------------------------------------------------------
+static void PerftWorker(ChessEngine* engine, FILE* in, FILE* out)
+{
+  char line[16384];
+  while (fgets(line, sizeof(line), in)) {
+    char* fen = strchr(line, ';');
+    char* moves = (fen ? strchr((fen + 1), ';') : NULL);
+    if (!moves) {
+      break;
+    }
+    *fen++ = 0;
+    *moves++ = 0;
+
+    const char* p = engine->SetPosition(fen);
+    for (p = (p ? moves : NULL); p && *NextWord(p); ) {
+      p = engine->MakeMove(p);
+    }
+    if (!p) {
+      fprintf(out, "error\n");
+    }
+    else {
+      fprintf(out, "%" PRIu64 "\n", engine->Perft(atoi(line)));
+    }
+    fflush(out);
+  }
+}
+#endif
+
+//-----------------------------------------------------------------------------
+//! \brief Perft the current position with forked worker processes
+//! The root moves (and their replies at depth > 4) are handed out to 'procs'
+//! worker processes as tasks.  Finished tasks are appended to the checkpoint
+//! file, if any, and skipped when the same count is run again.
+//! \param[in] depth The perft depth
+//! \return The number of leaf nodes at \p depth
+//-----------------------------------------------------------------------------
+uint64_t PerftCommandHandle::ForkPerft(const int depth)
+{
+#ifdef _WIN32
+  Output() << "procs is not supported on this platform";
+  return engine->Perft(depth);
+#else
+  const int plies = (depth > 4) ? 2 : 1;
+  if (depth <= plies) {
+    return engine->Perft(depth);
+  }
+
+  const uint64_t start = Now();
+  const std::string fen = engine->GetFEN();
+  const std::vector<std::string> roots = LegalMoves(engine, fen);
+
+  std::vector<std::string> prefixes;
+  for (size_t i = 0; i < roots.size(); ++i) {
+    if (plies == 1) {
+      prefixes.push_back(roots[i]);
+      continue;
+    }
+    engine->SetPosition(fen.c_str());
+    engine->MakeMove(roots[i].c_str());
+    const std::vector<std::string> replies =
+        LegalMoves(engine, engine->GetFEN());
+    for (size_t k = 0; k < replies.size(); ++k) {
+      prefixes.push_back(roots[i] + ' ' + replies[k]);
+    }
+  }
+  engine->SetPosition(fen.c_str());
+
+  // load finished tasks from the checkpoint file
+  std::map<std::string, uint64_t> finished;
+  FILE* cp = NULL;
+  if (checkpoint.size()) {
+    if ((cp = fopen(checkpoint.c_str(), "r"))) {
+      char line[16384];
+      while (fgets(line, sizeof(line), cp)) {
+        char* count = strrchr(line, ';');
+        if (count) {
+          *count++ = 0;
+          finished[line] = strtoull(count, NULL, 10);
+        }
+      }
+      fclose(cp);
+    }
+    if (!(cp = fopen(checkpoint.c_str(), "a"))) {
+      Output() << "Cannot open '" << checkpoint << "': " << strerror(errno);
+      return 0;
+    }
+  }
+
+  char prefix[32];
+  snprintf(prefix, sizeof(prefix), "%d;", (depth - plies));
+  uint64_t total = 0;
+  std::vector<std::string> tasks;
+  for (size_t i = 0; i < prefixes.size(); ++i) {
+    const std::string task = (prefix + fen + ';' + prefixes[i]);
+    std::map<std::string, uint64_t>::const_iterator it = finished.find(task);
+    if (it != finished.end()) {
+      total += it->second;
+    }
+    else {
+      tasks.push_back(task);
+    }
+  }
+  Output() << prefixes.size() << " tasks, "
+           << (prefixes.size() - tasks.size()) << " from checkpoint";
+
+  struct Worker {
+    pid_t pid;
+    FILE* tasks;
+    FILE* results;
+    std::string task;
+  };
+
+  // worker processes inherit the engine as it is right now
+  void (*sigpipe)(int) = signal(SIGPIPE, SIG_IGN);
+  std::vector<Worker> workers;
+  const size_t count = std::min<size_t>(procs, tasks.size());
+  while (workers.size() < count) {
+    int taskPipe[2];
+    int resultPipe[2];
+    if (pipe(taskPipe) || pipe(resultPipe)) {
+      Output() << "pipe failed: " << strerror(errno);
+      break;
+    }
+    const pid_t pid = fork();
+    if (pid < 0) {
+      Output() << "fork failed: " << strerror(errno);
+      close(taskPipe[0]);
+      close(taskPipe[1]);
+      close(resultPipe[0]);
+      close(resultPipe[1]);
+      break;
+    }
+    if (!pid) {
+      close(taskPipe[1]);
+      close(resultPipe[0]);
+      for (size_t i = 0; i < workers.size(); ++i) {
+        close(fileno(workers[i].tasks));
+        close(fileno(workers[i].results));
+      }
+      const int devnull = open("/dev/null", O_WRONLY);
+      if (devnull >= 0) {
+        dup2(devnull, STDOUT_FILENO);
+      }
+      PerftWorker(engine, fdopen(taskPipe[0], "r"),
+                  fdopen(resultPipe[1], "w"));
+      _exit(0);
+    }
+    close(taskPipe[0]);
+    close(resultPipe[1]);
+    Worker worker;
+    worker.pid = pid;
+    worker.tasks = fdopen(taskPipe[1], "w");
+    worker.results = fdopen(resultPipe[0], "r");
+    workers.push_back(worker);
+  }
+
+  // hand out tasks as workers become available
+  size_t next = 0;
+  size_t done = (prefixes.size() - tasks.size());
+  size_t busy = 0;
+  bool ok = (workers.size() || tasks.empty());
+  for (size_t i = 0; i < workers.size(); ++i) {
+    workers[i].task = tasks[next++];
+    fprintf(workers[i].tasks, "%s\n", workers[i].task.c_str());
+    fflush(workers[i].tasks);
+    busy++;
+  }
+  while (ok && busy) {
+    fd_set fds;
+    int maxfd = 0;
+    FD_ZERO(&fds);
+    for (size_t i = 0; i < workers.size(); ++i) {
+      if (workers[i].task.size()) {
+        const int fd = fileno(workers[i].results);
+        FD_SET(fd, &fds);
+        maxfd = std::max<int>(maxfd, fd);
+      }
+    }
+    if (select((maxfd + 1), &fds, NULL, NULL, NULL) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      Output() << "select failed: " << strerror(errno);
+      ok = false;
+      break;
+    }
+    for (size_t i = 0; ok && (i < workers.size()); ++i) {
+      Worker& worker = workers[i];
+      if (worker.task.empty() || !FD_ISSET(fileno(worker.results), &fds)) {
+        continue;
+      }
+      char line[64];
+      char* end = NULL;
+      uint64_t leafs = 0;
+      if (fgets(line, sizeof(line), worker.results)) {
+        leafs = strtoull(line, &end, 10);
+      }
+      if (!end || (end == line)) {
+        Output() << "worker " << worker.pid << " failed: " << worker.task;
+        ok = false;
+        break;
+      }
+
+      total += leafs;
+      Output() << ++done << '/' << prefixes.size() << ' '
+               << worker.task.substr(worker.task.rfind(';') + 1) << ' '
+               << leafs;
+      if (cp) {
+        fprintf(cp, "%s;%" PRIu64 "\n", worker.task.c_str(), leafs);
+        fflush(cp);
+      }
+
+      worker.task.clear();
+      busy--;
+      if (engine->StopRequested()) {
+        ok = false;
+      }
+      else if (next < tasks.size()) {
+        worker.task = tasks[next++];
+        fprintf(worker.tasks, "%s\n", worker.task.c_str());
+        fflush(worker.tasks);
+        busy++;
+      }
+    }
+  }
+
+  // closing the task pipe tells a worker to exit, busy ones are killed
+  for (size_t i = 0; i < workers.size(); ++i) {
+    if (workers[i].task.size()) {
+      kill(workers[i].pid, SIGTERM);
+    }
+    fclose(workers[i].tasks);
+    fclose(workers[i].results);
+    waitpid(workers[i].pid, NULL, 0);
+  }
+  signal(SIGPIPE, sigpipe);
+  if (cp) {
+    fclose(cp);
+  }
+
+  const uint64_t msecs = (Now() - start);
+  if (!ok) {
+    Output() << "Perft incomplete, " << done << '/' << prefixes.size()
+             << " tasks done";
+  }
+  Output() << "Perft " << total << ' '
+           << Rate((total / 1000), msecs) << " KLeafs/sec";
+  return total;
+#endif
+}
+
 //-----------------------------------------------------------------------------
 const std::string TestCommandHandle::_TEST_FILE = "epd/test.epd";
 
@@ -455,30 +791,36 @@ bool TestCommandHandle::Parse(const char* params)
   static const std::string argDepth   = "depth";
   static const std::string argFile    = "file";
   static const std::string argGain    = "gain";
+  static const std::string argNodes   = "nodes";
   static const std::string argNoClear = "noclear";
   static const std::string argPrint   = "print";
   static const std::string argSkip    = "skip";
+  static const std::string argThreads = "threads";
   static const std::string argTime    = "time";
 
-  noClear    = false;
-  printBoard = false;
-  maxCount   = 0;
-  maxDepth   = 0;
-  minGain    = 0;
-  skipCount  = 0;
-  maxTime    = 0;
-  fileName   = "";
+  noClear     = false;
+  printBoard  = false;
+  maxCount    = 0;
+  maxDepth    = 0;
+  minGain     = 0;
+  skipCount   = 0;
+  threadCount = 0;
+  maxNodes    = 0;
+  maxTime     = 0;
+  fileName    = "";
 
   bool invalid = false;
   while (!invalid && params && *NextWord(params)) {
-    if (HasParam(argNoClear,  noClear,    params) ||
-        HasParam(argPrint,    printBoard, params) ||
-        NumberParam(argCount, maxCount,   params, invalid) ||
-        NumberParam(argDepth, maxDepth,   params, invalid) ||
-        NumberParam(argGain,  minGain,    params, invalid) ||
-        NumberParam(argSkip,  skipCount,  params, invalid) ||
-        NumberParam(argTime,  maxTime,    params, invalid) ||
-        StringParam(argFile,  fileName,   params, invalid))
+    if (HasParam(argNoClear,    noClear,     params) ||
+        HasParam(argPrint,      printBoard,  params) ||
+        NumberParam(argCount,   maxCount,    params, invalid) ||
+        NumberParam(argDepth,   maxDepth,    params, invalid) ||
+        NumberParam(argGain,    minGain,     params, invalid) ||
+        NumberParam(argNodes,   maxNodes,    params, invalid) ||
+        NumberParam(argSkip,    skipCount,   params, invalid) ||
+        NumberParam(argThreads, threadCount, params, invalid) ||
+        NumberParam(argTime,    maxTime,     params, invalid) ||
+        StringParam(argFile,    fileName,    params, invalid))
     {
       continue;
     }
@@ -498,164 +840,298 @@ bool TestCommandHandle::Parse(const char* params)
 }
 
 //-----------------------------------------------------------------------------
-void TestCommandHandle::Execute()
+//! \brief Read test positions and their 'am' and 'bm' moves from a file
+//! \param[in] fp The file
+//! \return false if the file contains an invalid test position
+//-----------------------------------------------------------------------------
+bool TestCommandHandle::LoadTests(FILE* fp)
 {
-  if (!engine) {
-    Output() << "Engine not set for 'test' command";
-    return;
-  }
+  MoveFinder moveFinder;
+  char fen[16384];
+  int  line = 0;
+  int  positions = 0;
 
-  if (fileName.empty()) {
-    Output() << "FileName not set for 'test' command";
-    return;
+  while (fgets(fen, sizeof(fen), fp)) {
+    line++;
+
+    char* f = fen;
+    if (!*NextWord(f) || (*f == '#')) {
+      continue;
+    }
+
+    positions++;
+    if (skipCount && (positions <= skipCount)) {
+      continue;
+    }
+
+    TestPosition test;
+    test.line = line;
+    test.text = f;
+    NormalizeString(f);
+    const char* next = engine->SetPosition(f);
+    if (!next || !moveFinder.LoadFEN(f)) {
+      Output() << "error at line " << line << ", invalid position";
+      return false;
+    }
+    test.fen.assign(f, (next - f));
+    f += (next - f);
+
+    // consume 'am' and 'bm' parameters
+    while (f && *NextWord(f)) {
+      // null terminate this parameter (parameters end with ; or end of line)
+      char* end = strchr(f, ';');
+      if (end) {
+        *end = 0;
+      }
+
+      if (!strncmp(f, "am ", 3)) {
+        f += 3;
+        while (*NextWord(f)) {
+          std::string coord = moveFinder.ToCoordinates(f);
+          if (coord.size()) {
+            test.avoid.insert(coord);
+          }
+          else {
+            break;
+          }
+        }
+      }
+      else if (!strncmp(f, "bm ", 3)) {
+        f += 3;
+        while (*NextWord(f)) {
+          std::string coord = moveFinder.ToCoordinates(f);
+          if (coord.size()) {
+            test.best.insert(coord);
+          }
+          else {
+            break;
+          }
+        }
+      }
+
+      // move 'f' to beginning of next parameter
+      if (end) {
+        f = (end + 1);
+        continue;
+      }
+      break;
+    }
+
+    if (test.avoid.empty() && test.best.empty()) {
+      Output() << "error at line " << line
+               << ", no best or avoid moves specified";
+      return false;
+    }
+
+    test.tail = (f ? f : "");
+    tests.push_back(test);
+    if (maxCount && (static_cast<int>(tests.size()) >= maxCount)) {
+      break;
+    }
   }
+  return true;
+}
 
-  char     fen[16384];
+//-----------------------------------------------------------------------------
+//! \brief Search a single test position and add the result to the totals
+//! \param[in] testEngine The engine to search with
+//! \param[in] test The test position
+//-----------------------------------------------------------------------------
+void TestCommandHandle::RunTest(ChessEngine* testEngine,
+                                const TestPosition& test)
+{
   int      depth = 0;
-  int      line = 0;
-  int      maxSearchDepth = 0;
-  int      maxSeldepth = 0;
-  int      minSearchDepth = -1;
-  int      minSeldepth = -1;
-  int      passed = 0;
-  int      positions = 0;
   int      seldepth = 0;
-  int      tested = 0;
-  int      totalDepth = 0;
-  int      totalSeldepth = 0;
   uint64_t nodes = 0;
   uint64_t qnodes = 0;
   uint64_t time = 0;
-  uint64_t totalNodes = 0;
-  uint64_t totalQnodes = 0;
-  uint64_t totalTime = 0;
-  FILE*    fp = NULL;
 
-  try {
-    MoveFinder moveFinder;
+  mutex.Lock();
+  const int number = ++tested;
+  mutex.Unlock();
 
-    if (!(fp = fopen(fileName.c_str(), "r"))) {
-      Output() << "Cannot open '" << fileName << "': " << strerror(errno);
-      return;
-    }
+  Output() << "--- Test " << number << " at line " << test.line << ' '
+           << test.text;
+  testEngine->SetPosition(test.fen.c_str());
+  if (!noClear) {
+    testEngine->ClearSearchData();
+  }
+  if (printBoard) {
+    testEngine->PrintBoard();
+  }
 
-    engine->ClearStopFlags();
-    engine->ResetStatsTotals();
+  const std::string bestmove =
+      testEngine->Go(maxDepth, 0, maxTime, 0, 0, 0, 0, maxNodes);
+  Output(Output::NoPrefix) << "bestmove " << bestmove;
 
-    while (fgets(fen, sizeof(fen), fp)) {
-      line++;
+  testEngine->GetStats(&depth, &seldepth, &nodes, &qnodes, &time);
 
-      char* f = fen;
-      if (!*NextWord(f) || (*f == '#')) {
-        continue;
-      }
+  mutex.Lock();
+  completed++;
+  if (bestmove.empty() ||
+      (test.best.size() && !test.best.count(bestmove)) ||
+      (test.avoid.size() && test.avoid.count(bestmove)))
+  {
+    Output() << "--- FAILED! line " << test.line << " ("
+             << Percent(passed, completed) << "%) " << test.tail;
+  }
+  else {
+    passed++;
+    Output() << "--- Passed. line " << test.line << " ("
+             << Percent(passed, completed) << "%) " << test.tail;
+  }
 
-      positions++;
-      if (skipCount && (positions <= skipCount)) {
-        continue;
-      }
+  if (depth > maxSearchDepth) {
+    maxSearchDepth = depth;
+  }
+  if ((minSearchDepth < 0) || (depth < minSearchDepth)) {
+    minSearchDepth = depth;
+  }
+  if (seldepth > maxSeldepth) {
+    maxSeldepth = seldepth;
+  }
+  if ((minSeldepth < 0) || (seldepth < minSeldepth)) {
+    minSeldepth = seldepth;
+  }
+  totalDepth += depth;
+  totalNodes += nodes;
+  totalQnodes += qnodes;
+  totalSeldepth += seldepth;
+  totalTime += time;
+  mutex.Unlock();
+}
 
-      Output() << "--- Test " << (++tested) << " at line " << line << ' ' << f;
-      NormalizeString(f);
-      const char* next = engine->SetPosition(f);
-      if (!next || !moveFinder.LoadFEN(f)) {
-        break;
-      }
-      f += (next - f);
+//-----------------------------------------------------------------------------
+//! \brief Thread function that runs test positions until there are none left
+//! \param[in] param The Worker
+//-----------------------------------------------------------------------------
+void TestCommandHandle::RunWorker(void* param)
+{
+  Worker* worker = static_cast<Worker*>(param);
+  TestCommandHandle* handle = worker->handle;
+  while (!handle->engine->StopRequested()) {
+    const TestPosition* test = NULL;
+    handle->mutex.Lock();
+    if (handle->nextTest < handle->tests.size()) {
+      test = &handle->tests[handle->nextTest++];
+    }
+    handle->mutex.Unlock();
+    if (!test) {
+      break;
+    }
+    handle->RunTest(worker->engine, *test);
+  }
+  worker->done = true;
+}
 
-      // consume 'am' and 'bm' parameters
-      std::set<std::string> avoid;
-      std::set<std::string> best;
-      while (f && *NextWord(f)) {
-        // null terminate this parameter (parameters end with ; or end of line)
-        char* end = strchr(f, ';');
-        if (end) {
-          *end = 0;
-        }
+//-----------------------------------------------------------------------------
+//! \brief Run test positions on 'threadCount' independent engine instances
+//-----------------------------------------------------------------------------
+void TestCommandHandle::RunConcurrent()
+{
+  std::vector<Worker*> workers;
+  for (int i = 0; i < threadCount; ++i) {
+    ChessEngine* instance = engine->NewInstance(threadCount);
+    if (!instance) {
+      break;
+    }
+    instance->Initialize();
+    Worker* worker = new Worker;
+    worker->handle = this;
+    worker->engine = instance;
+    worker->done = false;
+    workers.push_back(worker);
+  }
 
-        if (!strncmp(f, "am ", 3)) {
-          f += 3;
-          while (*NextWord(f)) {
-            std::string coord = moveFinder.ToCoordinates(f);
-            if (coord.size()) {
-              avoid.insert(coord);
-            }
-            else {
-              break;
-            }
-          }
-        }
-        else if (!strncmp(f, "bm ", 3)) {
-          f += 3;
-          while (*NextWord(f)) {
-            std::string coord = moveFinder.ToCoordinates(f);
-            if (coord.size()) {
-              best.insert(coord);
-            }
-            else {
-              break;
-            }
-          }
-        }
+  if (workers.empty()) {
+    Output() << "Engine does not support concurrent tests";
+    Worker worker;
+    worker.handle = this;
+    worker.engine = engine;
+    worker.done = false;
+    RunWorker(&worker);
+    return;
+  }
 
-        // move 'f' to beginning of next parameter
-        if (end) {
-          f = (end + 1);
-          continue;
-        }
-        break;
-      }
+  for (size_t i = 0; i < workers.size(); ++i) {
+    workers[i]->thread.Start(RunWorker, workers[i]);
+  }
 
-      if (avoid.empty() && best.empty()) {
-        Output() << "error at line " << line
-                 << ", no best or avoid moves specified";
-        break;
+  // pass stop requests on to the test engines, repeatedly because a test
+  // engine may have been just about to start its next search
+  for (size_t i = 0; i < workers.size(); ) {
+    if (workers[i]->done) {
+      ++i;
+      continue;
+    }
+    if (engine->StopRequested()) {
+      for (size_t k = 0; k < workers.size(); ++k) {
+        workers[k]->engine->Stop(ChessEngine::FullStop);
       }
+    }
+    MillisecondSleep(100);
+  }
 
-      if (!noClear) {
-        engine->ClearSearchData();
-      }
-      if (printBoard) {
-        engine->PrintBoard();
-      }
+  for (size_t i = 0; i < workers.size(); ++i) {
+    workers[i]->thread.Join();
+    workers[i]->engine->Quit();
+    delete workers[i]->engine;
+    delete workers[i];
+  }
+}
+
+//-----------------------------------------------------------------------------
+void TestCommandHandle::Execute()
+{
+  if (!engine) {
+    Output() << "Engine not set for 'test' command";
+    return;
+  }
 
-      const std::string bestmove = engine->Go(maxDepth, 0, maxTime);
-      Output(Output::NoPrefix) << "bestmove " << bestmove;
+  if (fileName.empty()) {
+    Output() << "FileName not set for 'test' command";
+    return;
+  }
 
-      engine->GetStats(&depth, &seldepth, &nodes, &qnodes, &time);
-      if (bestmove.empty() ||
-          (best.size() && !best.count(bestmove)) ||
-          (avoid.size() && avoid.count(bestmove)))
-      {
-        Output() << "--- FAILED! line " << line << " ("
-                 << Percent(passed, tested) << "%) " << f;
-      }
-      else {
-        passed++;
-        Output() << "--- Passed. line " << line << " ("
-                 << Percent(passed, tested) << "%) " << f;
-      }
+  nextTest       = 0;
+  completed      = 0;
+  maxSearchDepth = 0;
+  maxSeldepth    = 0;
+  minSearchDepth = -1;
+  minSeldepth    = -1;
+  passed         = 0;
+  tested         = 0;
+  totalDepth     = 0;
+  totalSeldepth  = 0;
+  totalNodes     = 0;
+  totalQnodes    = 0;
+  totalTime      = 0;
+  tests.clear();
 
-      if (depth > maxSearchDepth) {
-        maxSearchDepth = depth;
-      }
-      if ((minSearchDepth < 0) || (depth < minSearchDepth)) {
-        minSearchDepth = depth;
-      }
-      if (seldepth > maxSeldepth) {
-        maxSeldepth = seldepth;
-      }
-      if ((minSeldepth < 0) || (seldepth < minSeldepth)) {
-        minSeldepth = seldepth;
-      }
-      totalDepth += depth;
-      totalNodes += nodes;
-      totalQnodes += qnodes;
-      totalSeldepth += seldepth;
-      totalTime += time;
+  FILE* fp = NULL;
+  try {
+    if (!(fp = fopen(fileName.c_str(), "r"))) {
+      Output() << "Cannot open '" << fileName << "': " << strerror(errno);
+      return;
+    }
 
-      if (engine->StopRequested() || (maxCount && (tested >= maxCount))) {
-        break;
+    engine->ClearStopFlags();
+    engine->ResetStatsTotals();
+
+    if (!LoadTests(fp)) {
+      fclose(fp);
+      return;
+    }
+
+    if (threadCount > 1) {
+      RunConcurrent();
+    }
+    else {
+      for (size_t i = 0; i < tests.size(); ++i) {
+        RunTest(engine, tests[i]);
+        if (engine->StopRequested()) {
+          break;
+        }
       }
     }
 
@@ -675,7 +1151,9 @@ void TestCommandHandle::Execute()
              << static_cast<int>(Average(totalSeldepth, tested)) << " avg, "
              << maxSeldepth << " max";
 
-    engine->ShowStatsTotals();
+    if (threadCount <= 1) {
+      engine->ShowStatsTotals();
+    }
   }
   catch (const std::exception& e) {
     Output() << "ERROR: " << e.what();
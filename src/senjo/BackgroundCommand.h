@@ -160,6 +160,7 @@ public:
   { }
   std::string Usage() const {
     return (command + " [depth <x>] [count <x>] [skip <x>] [leafs <x>] "
+                      "[hash <mbytes>] [procs <x>] [checkpoint <file>] "
                       "[epd] [file <x> (default=" + _TEST_FILE + ")]");
   }
   std::string Description() const {
@@ -173,6 +174,7 @@ protected:
 private:
   bool Process(const char* params, uint64_t& count,
                uint64_t& nodes, uint64_t& qnodes);
+  uint64_t ForkPerft(const int depth);
 
   static const std::string _TEST_FILE;
 
@@ -180,7 +182,10 @@ private:
   int         count;
   int         skip;
   int         maxDepth;
+  int         hashSize;
+  int         procs;
   uint64_t    maxLeafs;
+  std::string checkpoint;
   std::string fileName;
   std::string command;
 };
@@ -194,7 +199,8 @@ public:
   TestCommandHandle(ChessEngine* engine) : BackgroundCommand(engine) { }
   std::string Usage() const {
     return "test [print] [skip <x>] [count <x>] [depth <x>] [time <msecs>] "
-        "[gain <x>] [file <x> (default=" + _TEST_FILE + ")]";
+        "[nodes <x>] [gain <x>] [threads <x>] "
+        "[file <x> (default=" + _TEST_FILE + ")]";
   }
   std::string Description() const {
     return "Find the best move for a suite of test positions.";
@@ -204,6 +210,29 @@ public:
   void Execute();
 
 private:
+  struct TestPosition
+  {
+    int line;
+    std::string text;
+    std::string fen;
+    std::string tail;
+    std::set<std::string> avoid;
+    std::set<std::string> best;
+  };
+
+  struct Worker
+  {
+    TestCommandHandle* handle;
+    ChessEngine*       engine;
+    Thread             thread;
+    volatile bool      done;
+  };
+
+  bool LoadTests(FILE* fp);
+  void RunTest(ChessEngine* testEngine, const TestPosition& test);
+  void RunConcurrent();
+  static void RunWorker(void* param);
+
   static const std::string _TEST_FILE;
 
   bool        noClear;
@@ -212,8 +241,27 @@ private:
   int         maxDepth;
   int         minGain;
   int         skipCount;
+  int         threadCount;
+  uint64_t    maxNodes;
   uint64_t    maxTime;
   std::string fileName;
+
+  // test results, guarded by mutex when running concurrently
+  Mutex       mutex;
+  size_t      nextTest;
+  int         completed;
+  int         maxSearchDepth;
+  int         maxSeldepth;
+  int         minSearchDepth;
+  int         minSeldepth;
+  int         passed;
+  int         tested;
+  int         totalDepth;
+  int         totalSeldepth;
+  uint64_t    totalNodes;
+  uint64_t    totalQnodes;
+  uint64_t    totalTime;
+  std::vector<TestPosition> tests;
 };
 
 } // namespace senjo
@@ -29,15 +29,35 @@ namespace senjo
 //-----------------------------------------------------------------------------
 // static variables
 //-----------------------------------------------------------------------------
-bool        ChessEngine::_debug = false;
-bool        ChessEngine::_searching = false;
-bool        ChessEngine::_quit = false;
-int         ChessEngine::_stop = 0;
-uint64_t    ChessEngine::_startTime = 0;
-uint64_t    ChessEngine::_stopTime = 0;
 const char* ChessEngine::_STARTPOS =
     "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
 
+//-----------------------------------------------------------------------------
+ChessEngine::ChessEngine()
+  : _debug(false),
+    _searching(false),
+    _pondering(false),
+    _quit(false),
+    _stop(0),
+    _startTime(0),
+    _stopTime(0)
+{
+}
+
+//-----------------------------------------------------------------------------
+bool ChessEngine::SaveHash(const std::string& /*path*/)
+{
+  Output() << GetEngineName() << " can't save its hash table";
+  return false;
+}
+
+//-----------------------------------------------------------------------------
+bool ChessEngine::LoadHash(const std::string& /*path*/)
+{
+  Output() << GetEngineName() << " can't load a hash table";
+  return false;
+}
+
 //-----------------------------------------------------------------------------
 uint64_t ChessEngine::Perft(const int depth)
 {
@@ -64,6 +84,7 @@ std::string ChessEngine::Go(const int depth,
                             const uint64_t movetime,
                             const uint64_t wtime, const uint64_t winc,
                             const uint64_t btime, const uint64_t binc,
+                            const uint64_t nodes,
                             std::string* ponder)
 {
   _stop &= ~StopReason::Timeout;
@@ -81,6 +102,9 @@ std::string ChessEngine::Go(const int depth,
       _stopTime = endTime;
     }
   }
+  if (_pondering) {
+    _stopTime = 0;
+  }
 
   if (UseTimer() && !timerThread.Active()) {
     if (!timerThread.Start(Timer, this)) {
@@ -89,22 +113,24 @@ std::string ChessEngine::Go(const int depth,
   }
 
   std::string bestmove =
-      MyGo(depth, movestogo, movetime, wtime, winc, btime, binc, ponder);
+      MyGo(depth, movestogo, movetime, wtime, winc, btime, binc, nodes,
+           ponder);
 
   _searching = false;
+  SetPondering(false);
   return bestmove;
 }
 
 //-----------------------------------------------------------------------------
 void ChessEngine::Timer(void* data)
 {
+  ChessEngine* engine = NULL;
   try {
     if (!data) {
       Output() << "ChessEngine::Timer() NULL data parameter";
       return;
     }
 
-    ChessEngine* engine;
 #ifdef NDEBUG
     engine = static_cast<ChessEngine*>(data);
 #else
@@ -125,7 +151,7 @@ void ChessEngine::Timer(void* data)
     uint64_t nodes = 0;
     uint64_t qnodes = 0;
 
-    while (!_quit) {
+    while (!engine->_quit) {
       const uint64_t now = Now();
       const uint64_t end = engine->GetStopTime();
 
@@ -169,7 +195,7 @@ void ChessEngine::Timer(void* data)
               << std::endl;
   }
 
-  if (_debug) {
+  if (engine && engine->_debug) {
     Output() << "ChessEngine::Timer thread exiting";
   }
 }
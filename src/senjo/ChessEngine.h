@@ -47,6 +47,16 @@ public:
   //--------------------------------------------------------------------------
   static const char* _STARTPOS;
 
+  //--------------------------------------------------------------------------
+  //! \brief Constructor
+  //--------------------------------------------------------------------------
+  ChessEngine();
+
+  //--------------------------------------------------------------------------
+  //! \brief Destructor
+  //--------------------------------------------------------------------------
+  virtual ~ChessEngine() {}
+
   //--------------------------------------------------------------------------
   //! \brief Get the engine name
   //! \return The engine name
@@ -261,6 +271,41 @@ public:
   //--------------------------------------------------------------------------
   uint64_t QPerft(const int depth);
 
+  //--------------------------------------------------------------------------
+  //! \brief Set the size of the hash table used to count perft subtrees
+  //! Engines that don't hash perft results can ignore this.
+  //! \param[in] mbytes Table size in megabytes, 0 = no perft hashing
+  //--------------------------------------------------------------------------
+  virtual void SetPerftHashSize(const size_t /*mbytes*/) { }
+
+  //--------------------------------------------------------------------------
+  //! \brief Write the engine's hash table to a file
+  //! The default implementation reports that this isn't supported.
+  //! \param[in] path The file to write
+  //! \return true if the hash table was saved
+  //--------------------------------------------------------------------------
+  virtual bool SaveHash(const std::string& path);
+
+  //--------------------------------------------------------------------------
+  //! \brief Replace the engine's hash table with one written by SaveHash()
+  //! The default implementation reports that this isn't supported.
+  //! \param[in] path The file to read
+  //! \return true if the hash table was loaded
+  //--------------------------------------------------------------------------
+  virtual bool LoadHash(const std::string& path);
+
+  //--------------------------------------------------------------------------
+  //! \brief Create an independent engine with the same option values
+  //! Used to run test positions concurrently.  \p instances engines will run
+  //! at the same time, so memory hungry settings (such as hash table size)
+  //! should be divided by it.  The caller initializes and deletes the engine.
+  //! \param[in] instances Number of engines that will run at the same time
+  //! \return NULL if the engine doesn't support multiple instances
+  //--------------------------------------------------------------------------
+  virtual ChessEngine* NewInstance(const int /*instances*/) const {
+    return NULL;
+  }
+
   //--------------------------------------------------------------------------
   //! \brief Execute search on current position to find best move
   //! This will call the MyGo() method, which you must implement.
@@ -271,6 +316,7 @@ public:
   //! \param[in] winc White increment per move in milliseconds
   //! \param[in] btime Milliseconds remaining on black's clock
   //! \param[in] binc Black increment per move in milliseconds
+  //! \param[in] nodes Maximum number of nodes to search, 0 = no limit
   //! \param[out] ponder If not NULL set to the move engine should ponder next
   //! \return Best move in coordinate notation (e.g. "e2e4", "g8f6", "e7f8q")
   //--------------------------------------------------------------------------
@@ -279,6 +325,7 @@ public:
                  const uint64_t movetime = 0,
                  const uint64_t wtime = 0, const uint64_t winc = 0,
                  const uint64_t btime = 0, const uint64_t binc = 0,
+                 const uint64_t nodes = 0,
                  std::string* ponder = NULL);
 
   //--------------------------------------------------------------------------
@@ -300,6 +347,20 @@ public:
   //--------------------------------------------------------------------------
   virtual bool IsSearching() const { return _searching; }
 
+  //--------------------------------------------------------------------------
+  //! \brief Set whether the next (or current) Go() call is a ponder search
+  //! A ponder search must not stop on its own because of its time limits.
+  //! The time limits are applied when PonderHit() is called.
+  //! \param[in] flag true to ponder, false to end pondering
+  //--------------------------------------------------------------------------
+  virtual void SetPondering(const bool flag) { _pondering = flag; }
+
+  //--------------------------------------------------------------------------
+  //! \brief Is the engine pondering?
+  //! \return true if the current Go() call is a ponder search
+  //--------------------------------------------------------------------------
+  virtual bool IsPondering() const { return _pondering; }
+
   //--------------------------------------------------------------------------
   //! \brief Get the millisecond timestamp of when Go() was started
   //! \return 0 if not searching
@@ -393,6 +454,7 @@ protected:
   //! \param[in] winc White increment per move in milliseconds
   //! \param[in] btime Milliseconds remaining on black's clock
   //! \param[in] binc Black increment per move in milliseconds
+  //! \param[in] nodes Maximum number of nodes to search, 0 = no limit
   //! \param[out] ponder If not NULL set to the move engine should ponder next
   //! \return Best move in coordinate notation (e.g. "e2e4", "g8f6", "e7f8q")
   //--------------------------------------------------------------------------
@@ -401,17 +463,19 @@ protected:
                            const uint64_t movetime = 0,
                            const uint64_t wtime = 0, const uint64_t winc = 0,
                            const uint64_t btime = 0, const uint64_t binc = 0,
+                           const uint64_t nodes = 0,
                            std::string* ponder = NULL) = 0;
 
   static void Timer(void* data);
   Thread timerThread;
 
-  static bool     _debug;
-  static bool     _searching;
-  static bool     _quit;
-  static int      _stop;
-  static uint64_t _startTime;
-  static uint64_t _stopTime;
+  bool     _debug;
+  bool     _searching;
+  bool     _pondering;
+  bool     _quit;
+  int      _stop;
+  uint64_t _startTime;
+  uint64_t _stopTime;
 };
 
 } // namespace senjo
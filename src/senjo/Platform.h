@@ -58,6 +58,7 @@
 #include <set>
 #include <string>
 #include <time.h>
+#include <vector>
 
 namespace senjo
 {
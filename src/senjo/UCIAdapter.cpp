@@ -36,6 +36,7 @@ namespace token
   static const std::string Go("go");
   static const std::string Help("help");
   static const std::string IsReady("isready");
+  static const std::string LoadHash("loadhash");
   static const std::string Moves("moves");
   static const std::string Name("name");
   static const std::string New("new");
@@ -47,8 +48,10 @@ namespace token
   static const std::string QPerft("qperft");
   static const std::string Quit("quit");
   static const std::string Register("register");
+  static const std::string SaveHash("savehash");
   static const std::string SetOption("setoption");
   static const std::string StartPos("startpos");
+  static const std::string Startup("startup");
   static const std::string Stop("stop");
   static const std::string Test("test");
   static const std::string Uci("uci");
@@ -56,6 +59,12 @@ namespace token
   static const std::string Value("value");
 }
 
+//-----------------------------------------------------------------------------
+// time the program started, static initialization is about as close to
+// exec as we can portably get
+//-----------------------------------------------------------------------------
+static const uint64_t _startTime = Now();
+
 //-----------------------------------------------------------------------------
 bool UCIAdapter::IsMove(const char* str)
 {
@@ -70,7 +79,9 @@ bool UCIAdapter::IsMove(const char* str)
 
 //-----------------------------------------------------------------------------
 UCIAdapter::UCIAdapter()
-  : engine(NULL)
+  : engine(NULL),
+    initMsecs(0),
+    readyMsecs(0)
 {
 }
 
@@ -151,6 +162,17 @@ bool UCIAdapter::DoCommand(const char* command)
   else if (ParamMatch(token::Print, command)) {
     PrintCommand(command);
   }
+  else if (ParamMatch(token::Startup, command)) {
+    StartupCommand(command);
+  }
+  else if (ParamMatch(token::SaveHash, command)) {
+    StopCommand();
+    SaveHashCommand(command);
+  }
+  else if (ParamMatch(token::LoadHash, command)) {
+    StopCommand();
+    LoadHashCommand(command);
+  }
   else if (ParamMatch(token::Perft, command)) {
     StopCommand();
     PerftCommand(command, false);
@@ -212,10 +234,13 @@ void UCIAdapter::HelpCommand(const char* /*params*/)
   Output() << "  " << token::Exit;
   Output() << "  " << token::Fen;
   Output() << "  " << token::Help;
+  Output() << "  " << token::LoadHash;
   Output() << "  " << token::New;
   Output() << "  " << token::Perft;
   Output() << "  " << token::Print;
   Output() << "  " << token::QPerft;
+  Output() << "  " << token::SaveHash;
+  Output() << "  " << token::Startup;
   Output() << "  " << token::Test;
   Output() << "Also try '<command> help' for help on a specific command";
   Output() << "Or enter move(s) in coordinate notation, e.g. d2d4 g8f6";
@@ -334,6 +359,69 @@ void UCIAdapter::PerftCommand(const char* params, const bool qperft)
   handle = NULL;
 }
 
+//-----------------------------------------------------------------------------
+//! \brief Do the "savehash" command (not a UCI command)
+//! Write the engine's hash table to a file
+//-----------------------------------------------------------------------------
+void UCIAdapter::SaveHashCommand(const char* params)
+{
+  if (!params || !*params || ParamMatch(token::Help, params)) {
+    Output() << "usage: " << token::SaveHash << " <file>";
+    Output() << "Write the hash table to <file>.";
+    return;
+  }
+
+  if (!engine->IsInitialized()) {
+    engine->Initialize();
+  }
+  engine->SaveHash(params);
+}
+
+//-----------------------------------------------------------------------------
+//! \brief Do the "loadhash" command (not a UCI command)
+//! Replace the engine's hash table with one written by "savehash"
+//-----------------------------------------------------------------------------
+void UCIAdapter::LoadHashCommand(const char* params)
+{
+  if (!params || !*params || ParamMatch(token::Help, params)) {
+    Output() << "usage: " << token::LoadHash << " <file>";
+    Output() << "Replace the hash table with one written by "
+             << token::SaveHash << '.';
+    Output() << token::UciNewGame << " clears the hash table, so send it "
+             << "before " << token::LoadHash << '.';
+    Output() << "The file stays in use by the loaded table, don't overwrite "
+             << "it from outside the engine (" << token::SaveHash
+             << " is safe).";
+    return;
+  }
+
+  if (!engine->IsInitialized()) {
+    engine->Initialize();
+  }
+  engine->LoadHash(params);
+}
+
+//-----------------------------------------------------------------------------
+//! \brief Do the "startup" command (not a UCI command)
+//! Output how long it took from program start to the first "readyok"
+//-----------------------------------------------------------------------------
+void UCIAdapter::StartupCommand(const char* params)
+{
+  if (ParamMatch(token::Help, params)) {
+    Output() << "usage: " << token::Startup;
+    Output() << "Output msecs from program start to the first readyok.";
+    return;
+  }
+
+  if (!readyMsecs) {
+    Output() << "No readyok sent yet";
+    return;
+  }
+
+  Output() << "readyok sent " << readyMsecs << " msecs after startup, "
+           << initMsecs << " msecs spent initializing";
+}
+
 //-----------------------------------------------------------------------------
 //! \brief Do the "opts" command (not a UCI command)
 //! Output current engine option values
@@ -490,9 +578,14 @@ void UCIAdapter::IsReadyCommand(const char* params)
   }
 
   if (!engine->IsInitialized()) {
+    const uint64_t start = Now();
     engine->Initialize();
+    initMsecs = (Now() - start);
   }
   Output(Output::NoPrefix) << "readyok";
+  if (!readyMsecs) {
+    readyMsecs = std::max<uint64_t>(1, (Now() - _startTime));
+  }
 }
 
 //-----------------------------------------------------------------------------
@@ -74,6 +74,9 @@ private:
   void OptsCommand(const char* params);
   void PerftCommand(const char* params, const bool qperft);
   void PrintCommand(const char* params);
+  void StartupCommand(const char* params);
+  void SaveHashCommand(const char* params);
+  void LoadHashCommand(const char* params);
   void TestCommand(const char* params);
   void BTestCommand(const char* params);
 
@@ -93,6 +96,8 @@ private:
   ChessEngine* engine;
   Thread       thread;
   std::string  lastPosition;
+  uint64_t     initMsecs;
+  uint64_t     readyMsecs;
 };
 
 } // namespace senjo